@@ -0,0 +1,346 @@
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <variant>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include "../src/headers/lexer.h"
+#include "../src/headers/error.h"
+#include "../src/headers/parser.h"
+#include "../src/headers/semantic_analysis.h"
+
+/**
+ * turingcomplete_bench: times the interpreter on generated workloads and a few hot helpers.
+ *
+ *   turingcomplete_bench [--scale <f>] [--repetitions <n>] [--filter <substring>] [--output <file.json>]
+ *
+ * Every workload is generated at a few sizes (multiplied by --scale) and each size is lexed, parsed and
+ * executed --repetitions times; the JSON report keeps the minimum and the median of every phase so two
+ * interpreter versions can be compared run against run.
+ */
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr const char USAGE[] = "usage: turingcomplete_bench [--scale <f>] [--repetitions <n>] [--filter <substring>] [--output <file.json>]";
+
+    struct Settings {
+        bool show_help = false;
+        double scale = 1.0;
+        int repetitions = 5;
+        std::string filter;
+        std::string output;
+    };
+
+    struct Workload {
+        std::string name;
+        std::vector<std::size_t> sizes;
+        std::function<std::string(std::size_t)> generate;
+    };
+
+    struct Timing {
+        double min_ms = 0;
+        double median_ms = 0;
+    };
+
+    struct WorkloadResult {
+        std::string name;
+        std::size_t size = 0;
+        std::size_t source_bytes = 0;
+        std::size_t tokens = 0;
+        Timing lex;
+        Timing parse;
+        Timing execute;
+    };
+
+    struct MicroResult {
+        std::string name;
+        std::uint64_t operations = 0;
+        double ns_per_op = 0;
+        std::uint64_t checksum = 0;  // keeps the measured calls from being optimised away
+    };
+
+    double elapsed_ms(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    Timing summarise(std::vector<double> samples) {
+        std::ranges::sort(samples);
+        return Timing{samples.front(), samples[samples.size() / 2]};
+    }
+
+    // #[Workloads]
+
+    /// N values in descending order sorted with N passes of adjacent compare-swaps
+    std::string bubblesort(std::size_t n) {
+        std::ostringstream src;
+        for (std::size_t i = 0; i < n; ++i) {
+            src << "!{" << n - i << "} => v" << i << '\n';
+        }
+        src << "!{" << n << "} => passes\n(:passes ${\n";
+        for (std::size_t i = 0; i + 1 < n; ++i) {
+            src << "    !{v" << i << " > v" << i + 1 << "} => s\n"
+                << "    !{s * v" << i + 1 << " + (1 - s) * v" << i << "} => lo\n"
+                << "    !{s * v" << i << " + (1 - s) * v" << i + 1 << "} => hi\n"
+                << "    !{lo} => v" << i << '\n'
+                << "    !{hi} => v" << i + 1 << '\n';
+        }
+        src << "})\n";
+        for (std::size_t i = 0; i < n; ++i) {
+            src << "<<@ v" << i << '\n';
+        }
+        return src.str();
+    }
+
+    /// The first N Fibonacci numbers collected into an array (wrapping once they outgrow 32 bits)
+    std::string fib(std::size_t n) {
+        std::ostringstream src;
+        src << "!{0} => a\n!{1} => b\n<a, b> => fib\n!{0} => next\n!{" << n << "} => count\n"
+            << "(:count ${\n    !{a + b} => next\n    <next> => fib\n    !{b} => a\n    !{next} => b\n})\n"
+            << "<<@ fib\n";
+        return src.str();
+    }
+
+    /// `depth` loops of 4 iterations nested inside each other around a single increment
+    std::string nested_loops(std::size_t depth) {
+        std::ostringstream src;
+        src << "!{0} => acc\n";
+        for (std::size_t d = 0; d < depth; ++d) {
+            src << std::string(4 * d, ' ') << "!{4} => n" << d << '\n'
+                << std::string(4 * d, ' ') << "(:n" << d << " ${\n";
+        }
+        src << std::string(4 * depth, ' ') << "!{acc + 1} => acc\n";
+        for (std::size_t d = depth; d-- > 0;) {
+            src << std::string(4 * d, ' ') << "})\n";
+        }
+        src << "<<@ acc\n";
+        return src.str();
+    }
+
+    /// One literal N bits wide, printed back
+    std::string huge_literal(std::size_t bits) {
+        std::string literal;
+        for (std::size_t i = 0; i < bits; ++i) {
+            literal += (i % 3 == 0) ? '-' : '+';
+        }
+        return "[" + literal + "] => big\n<< big\n";
+    }
+
+    /// N straight-line statements
+    std::string many_statements(std::size_t n) {
+        std::ostringstream src;
+        src << "!{0} => i\n";
+        for (std::size_t k = 0; k < n; ++k) {
+            src << "!{i + 1} => i\n";
+        }
+        src << "<<@ i\n";
+        return src.str();
+    }
+
+    std::vector<Workload> workloads() {
+        return {
+            {"bubblesort", {8, 16, 24}, bubblesort},
+            {"fib", {100, 500, 2000}, fib},
+            {"nested_loops", {3, 5, 6}, nested_loops},
+            {"huge_literal", {1000, 50000, 250000}, huge_literal},
+            {"many_statements", {100, 1000, 3000}, many_statements},
+        };
+    }
+
+    WorkloadResult run_workload(const std::string &name, std::size_t size, const std::string &source, int repetitions) {
+        WorkloadResult result;
+        result.name = name;
+        result.size = size;
+        result.source_bytes = source.size();
+        std::vector<double> lex, parse, execute;
+
+        for (int r = 0; r < repetitions; ++r) {
+            std::istringstream stream(source);
+
+            auto start = Clock::now();
+            Lexer lexer(stream);
+            auto [tokens, unfilteredTokens, unfilteredLines] = lexer.tokenize();
+            lex.push_back(elapsed_ms(start));
+            result.tokens = tokens.size();
+
+            start = Clock::now();
+            Parser parser(name, tokens, unfilteredTokens, unfilteredLines, ErrorPack{}, 20);
+            parser.S_handle_errors(false);
+            parser.parse();
+            std::shared_ptr<ProgramNode> program = parser.G_program();
+            parse.push_back(elapsed_ms(start));
+
+            if (!parser.G_error_pack().errors.empty()) {
+                throw std::runtime_error("generated workload " + name + " does not parse");
+            }
+
+            std::ostringstream sink;
+            start = Clock::now();
+            {
+                sem_analysis::SemanticAnalyser semantic_analyser(program, name);
+                semantic_analyser.S_output(sink);
+                semantic_analyser.analyze();
+            }
+            execute.push_back(elapsed_ms(start));
+        }
+
+        result.lex = summarise(lex);
+        result.parse = summarise(parse);
+        result.execute = summarise(execute);
+        return result;
+    }
+
+    // #[Microbenchmarks]
+
+    template <typename Body>
+    MicroResult run_micro(const std::string &name, std::uint64_t operations, Body body) {
+        MicroResult result;
+        result.name = name;
+        result.operations = operations;
+        const auto start = Clock::now();
+        for (std::uint64_t i = 0; i < operations; ++i) {
+            result.checksum += body(i);
+        }
+        result.ns_per_op = elapsed_ms(start) * 1e6 / static_cast<double>(operations);
+        return result;
+    }
+
+    std::vector<MicroResult> micro_benchmarks(double scale) {
+        const auto operations = static_cast<std::uint64_t>(200000 * scale) + 1;
+
+        std::vector<std::string> encoded;
+        for (int64_t v = -512; v < 512; ++v) {
+            encoded.push_back(sem_analysis::int_to_binary(v * 4099));
+        }
+
+        return {
+            run_micro("binary_to_int64_t", operations, [&](std::uint64_t i) {
+                return static_cast<std::uint64_t>(sem_analysis::binary_to_int64_t(encoded[i % encoded.size()], true));
+            }),
+            run_micro("int_to_binary", operations, [](std::uint64_t i) {
+                return static_cast<std::uint64_t>(sem_analysis::int_to_binary(static_cast<int64_t>(i * 2654435761u % 4000000000u) - 2000000000).size());
+            }),
+            run_micro("tc_Bitset", operations, [&](std::uint64_t i) {
+                const tc_Bitset bitset(encoded[i % encoded.size()]);
+                return static_cast<std::uint64_t>(bitset.get_bits().size());
+            }),
+        };
+    }
+
+    void write_timing(std::ostream &out, const char *name, const Timing &timing) {
+        out << ",\"" << name << "\":{\"min_ms\":" << timing.min_ms << ",\"median_ms\":" << timing.median_ms << "}";
+    }
+
+    void write_json(std::ostream &out, const Settings &settings, const std::vector<WorkloadResult> &results, const std::vector<MicroResult> &micro) {
+        std::ostringstream json;
+        json << std::setprecision(6);
+        json << "{\"scale\":" << settings.scale << ",\"repetitions\":" << settings.repetitions << ",\n\"workloads\":[";
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const WorkloadResult &r = results[i];
+            json << (i ? ",\n" : "\n") << "{\"name\":\"" << r.name << "\",\"size\":" << r.size
+                 << ",\"source_bytes\":" << r.source_bytes << ",\"tokens\":" << r.tokens;
+            write_timing(json, "lex", r.lex);
+            write_timing(json, "parse", r.parse);
+            write_timing(json, "execute", r.execute);
+            json << "}";
+        }
+        json << "],\n\"micro\":[";
+        for (std::size_t i = 0; i < micro.size(); ++i) {
+            json << (i ? ",\n" : "\n") << "{\"name\":\"" << micro[i].name << "\",\"operations\":" << micro[i].operations
+                 << ",\"ns_per_op\":" << micro[i].ns_per_op << ",\"checksum\":" << micro[i].checksum << "}";
+        }
+        json << "]}\n";
+        out << json.str() << std::flush;
+    }
+
+    Settings parse_settings(int argc, char *argv[]) {
+        Settings settings;
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            const bool has_value = i + 1 < argc;
+            if (arg == "-h" || arg == "--help") {
+                settings.show_help = true;
+            } else if (arg == "--scale" && has_value) {
+                settings.scale = std::stod(argv[++i]);
+            } else if (arg == "--repetitions" && has_value) {
+                settings.repetitions = std::max(std::stoi(argv[++i]), 1);
+            } else if (arg == "--filter" && has_value) {
+                settings.filter = argv[++i];
+            } else if (arg == "--output" && has_value) {
+                settings.output = argv[++i];
+            } else {
+                throw std::invalid_argument("unknown argument: " + arg);
+            }
+        }
+        return settings;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    Settings settings;
+    try {
+        settings = parse_settings(argc, argv);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << '\n' << USAGE << std::endl;
+        return 2;
+    }
+    if (settings.show_help) {
+        std::cout << USAGE << "\n\n"
+                  << "  --scale <f>             multiply every workload size by f (default 1)\n"
+                  << "  --repetitions <n>       runs of each size; the minimum and median are reported (default 5)\n"
+                  << "  --filter <substring>    only run workloads whose name contains it (\"micro\" for the microbenchmarks)\n"
+                  << "  --output <file.json>    write the JSON report there instead of to stdout\n"
+                  << "  -h, --help              print this and exit" << std::endl;
+        return 0;
+    }
+
+    std::vector<WorkloadResult> results;
+    for (const Workload &workload : workloads()) {
+        if (!settings.filter.empty() && workload.name.find(settings.filter) == std::string::npos) {
+            continue;
+        }
+        for (const std::size_t base : workload.sizes) {
+            const auto size = std::max<std::size_t>(1, static_cast<std::size_t>(static_cast<double>(base) * settings.scale));
+            const WorkloadResult result = run_workload(workload.name, size, workload.generate(size), settings.repetitions);
+            std::cerr << std::left << std::setw(16) << result.name << std::right << std::setw(9) << result.size
+                      << std::fixed << std::setprecision(3)
+                      << "  lex " << std::setw(9) << result.lex.median_ms << " ms"
+                      << "  parse " << std::setw(9) << result.parse.median_ms << " ms"
+                      << "  execute " << std::setw(10) << result.execute.median_ms << " ms" << std::endl;
+            results.push_back(result);
+        }
+    }
+
+    std::vector<MicroResult> micro;
+    if (settings.filter.empty() || settings.filter == "micro") {
+        micro = micro_benchmarks(settings.scale);
+        for (const MicroResult &result : micro) {
+            std::cerr << std::left << std::setw(26) << result.name << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(9) << result.ns_per_op << " ns/op" << std::endl;
+        }
+    }
+
+    if (settings.output.empty()) {
+        write_json(std::cout, settings, results, micro);
+    } else {
+        std::ofstream file(settings.output);
+        if (!file.is_open()) {
+            std::cerr << "Could not write " << settings.output << std::endl;
+            return 1;
+        }
+        write_json(file, settings, results, micro);
+    }
+    return 0;
+}
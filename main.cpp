@@ -22,6 +22,7 @@
 #include <memory>
 #include <sstream>
 #include <cctype>
+#include <chrono>
 #include <unordered_set>
 
 #if defined(_WIN32)
@@ -31,10 +32,6 @@
     #include <csignal>
 #endif
 
-#define TURING_COMPLETE_VER "1.0.0"
-
-#define INTERPRETER_NAME "TComplete"
-
 #define PARGS (pos, *tokens);
 
 
@@ -42,49 +39,217 @@
 #include "src/headers/error.h"
 #include "src/headers/parser.h"
 #include "src/headers/semantic_analysis.h"
+#include "src/headers/driver.h"
+#include "src/headers/daemon.h"
+#include "src/headers/batch.h"
+#include "src/headers/bytecode.h"
+#include "src/headers/lanes.h"
+#include "src/headers/stats.h"
+#include "src/headers/profile.h"
+#include "src/headers/sampling.h"
+#include "src/headers/trace.h"
+#include "src/headers/crosscheck.h"
+#include "src/headers/limits.h"
+#include "src/headers/jit.h"
+#include "src/headers/emit.h"
+#include "src/headers/passes.h"
 
 int main(int argc, char *argv[]) {
 
-    std::string input;
-    int max_error_count = 20;
+    const tcomp::Options options = tcomp::parse_options({argv + 1, argv + argc});
 
-    for (int i = 1; i < argc; i++) {
-        std::string arg = argv[i];
-        if (arg == "-h" || arg == "--help")
-            std::cout << INTERPRETER_NAME << std::endl;
+    if (!options.usage_error.empty()) {
+        std::cout << options.usage_error << std::endl;
+        return 1;
+    }
 
+    if (!options.serve_socket.empty()) {
+        tcomp::print_banners(options, std::cout);
+        return tcomp::daemon::serve(options.serve_socket);
+    }
 
-        if (arg == "-v" || arg == "--version")
-            std::cout << TURING_COMPLETE_VER << std::endl;
+    if (options.batch) {
+        tcomp::print_banners(options, std::cout);
+        return tcomp::batch::run_all(options, std::cout);
+    }
 
-        if (arg == "-fmax_error_count")
-            max_error_count = std::stoi(argv[++i]);
+    if (!options.sweeps.empty()) {
+        tcomp::print_banners(options, std::cout);
+        return tcomp::vm::run_sweep(options, std::cout);
+    }
 
+    if (options.cross_check) {
+        tcomp::print_banners(options, std::cout);
+        return tcomp::crosscheck::run(options, std::cout);
+    }
 
-        else
-            input = arg;
+    if (!options.emit_cpp.empty() || !options.emit_asm.empty()) {
+        tcomp::print_banners(options, std::cout);
+        return tcomp::emit::run(options, std::cout);
     }
 
-    std::ifstream file(input);
-    if (!file.is_open()) {
-        std::cout << "File not found" << std::endl;
-        return 1;
+    if (options.dump_ir) {
+        tcomp::print_banners(options, std::cout);
+        return tcomp::ir::dump(options, std::cout);
+    }
+
+    if (!options.client_socket.empty()) {
+        if (auto exit_code = tcomp::daemon::forward(options.client_socket, options.forwarded)) {
+            return *exit_code;
+        }
+        // no daemon is listening, run the script in this process instead
+    }
+
+    tcomp::print_banners(options, std::cout);
+
+    const std::string &input = options.input;
+    const int max_error_count = options.max_error_count;
+
+    // "-" reads the program from stdin
+    std::ifstream file;
+    if (input != "-") {
+        file.open(input);
+        if (!file.is_open()) {
+            std::cout << "File not found" << std::endl;
+            return 1;
+        }
+    }
+
+    tcomp::stats::Report stats;
+    if (options.stats && options.stats_hardware) {
+        stats.enable_hardware_counters();
+    }
+    std::unique_ptr<tcomp::trace::Tracer> tracer;
+    if (!options.trace_file.empty()) {
+        tracer = std::make_unique<tcomp::trace::Tracer>(options.trace_iterations);
     }
 
-    Lexer lexer(file);
+    auto phase_start = std::chrono::steady_clock::now();
+    stats.begin_phase("lex");
+    Lexer lexer(input == "-" ? std::cin : file);
 
     auto [tokens, unfilteredTokens, unfilteredLines] = lexer.tokenize();
+    stats.end_phase();
+    if (tracer) tracer->record("lex", "phase", phase_start);
 
     ErrorPack error_pack;
 
+    phase_start = std::chrono::steady_clock::now();
+    stats.begin_phase("parse");
     Parser parser(input, tokens, unfilteredTokens, unfilteredLines, error_pack, max_error_count);
 
+    // syntax errors are reported and exit with 1, as tcomp::run does for --client and --batch
+    parser.S_handle_errors(false);
     parser.parse();
+    if (ErrorPack errors = parser.G_error_pack(); !errors.errors.empty()) {
+        ErrorHandler(errors, unfilteredTokens, unfilteredLines).report(std::cout);
+        return 1;
+    }
 
     std::shared_ptr<ProgramNode> Pn = parser.G_program();
+    stats.end_phase();
+    if (tracer) tracer->record("parse", "phase", phase_start);
+
+    // optimised runs go through the compiled engine; the tree walker keeps everything that observes a run as it happens
+    if (options.opt_level > 0 && !options.stats && !options.profile && options.sample_frequency == 0 && !tracer &&
+        options.max_steps == 0 && options.timeout_seconds <= 0 && options.max_memory == 0) {
+        tcomp::CompiledScript script;
+        script.program = Pn;
+        if (const auto exit_code = tcomp::ir::run(script, options.opt_level, std::cout)) {
+            return *exit_code;
+        }
+    }
+
+    tcomp::profile::Profiler profiler;
+    std::unique_ptr<tcomp::sampling::Sampler> sampler;
+    if (options.sample_frequency != 0) {
+        sampler = std::make_unique<tcomp::sampling::Sampler>(Pn, options.sample_frequency);
+        if (!sampler->start()) {
+            std::cerr << "Sampling is not available on this platform" << std::endl;
+            sampler.reset();
+        }
+    }
 
-    sem_analysis::SemanticAnalyser semantic_analyser(Pn, input);
-    semantic_analyser.analyze();
+    std::unique_ptr<tcomp::limits::Budget> budget;
+    if (options.max_steps != 0 || options.timeout_seconds > 0) {
+        budget = std::make_unique<tcomp::limits::Budget>(options.max_steps, options.timeout_seconds);
+    }
+    std::unique_ptr<tcomp::limits::MemoryArena> arena;
+    if (options.max_memory != 0) {
+        arena = std::make_unique<tcomp::limits::MemoryArena>(options.max_memory);
+    }
+    std::unique_ptr<tcomp::jit::Cache> native;
+    if (options.jit && tcomp::jit::available()) {
+        native = std::make_unique<tcomp::jit::Cache>();
+    }
+    int exit_code = 0;
+
+    phase_start = std::chrono::steady_clock::now();
+    stats.begin_phase("execute");
+    try {
+        sem_analysis::SemanticAnalyser semantic_analyser(Pn, input);
+        // profiling attributes time along a single statement stack, so it runs everything on this thread
+        semantic_analyser.S_jobs(options.profile ? 1 : options.jobs != 0 ? options.jobs : std::thread::hardware_concurrency());
+        if (options.profile) {
+            semantic_analyser.S_profiler(&profiler);
+        }
+        semantic_analyser.S_sampling(sampler != nullptr);
+        semantic_analyser.S_tracer(tracer.get());
+        semantic_analyser.S_budget(budget.get());
+        semantic_analyser.S_arena(arena.get());
+        semantic_analyser.S_jit(native.get());
+        semantic_analyser.analyze();
+    } catch (const tcomp::limits::LimitExceeded &e) {
+        // everything below still runs, so the statistics of the partial run are reported
+        std::cout << std::flush;
+        tcomp::report_limit(e, input, unfilteredTokens, unfilteredLines, budget.get(), std::cerr);
+        exit_code = tcomp::limits::EXIT_LIMIT_EXCEEDED;
+    } catch (const std::exception &e) {
+        // reported and exited with 1, as tcomp::run does for --client and --batch
+        std::cout << "Runtime Error: " << e.what() << std::endl;
+        exit_code = 1;
+    }
+    stats.end_phase();
+    if (tracer) tracer->record("execute", "phase", phase_start);
+
+    if (sampler) {
+        sampler->stop();
+        std::cout << std::flush;
+        sampler->write_report(std::cerr);
+    }
+
+    if (options.profile) {
+        std::cout << std::flush;
+        profiler.write_hotspots(std::cerr);
+
+        if (!options.profile_output.empty()) {
+            std::ofstream folded(options.profile_output);
+            if (folded.is_open()) {
+                profiler.write_collapsed(folded, input == "-" ? "stdin" : std::filesystem::path(input).filename().string());
+            } else {
+                std::cerr << "Could not write " << options.profile_output << std::endl;
+            }
+        }
+    }
+
+    if (tracer) {
+        std::ofstream trace_file(options.trace_file);
+        if (trace_file.is_open()) {
+            tracer->write(trace_file);
+        } else {
+            std::cerr << "Could not write " << options.trace_file << std::endl;
+        }
+    }
+
+    if (options.stats || exit_code == tcomp::limits::EXIT_LIMIT_EXCEEDED) {
+        stats.set("tokens", tokens.size());
+        stats.set("ast_nodes", tcomp::stats::count_nodes(Pn));
+        if (arena) {
+            stats.set("peak_value_bytes", arena->G_peak_bytes());
+        }
+        std::cout << std::flush;
+        options.stats_json ? stats.write_json(std::cerr) : stats.write_text(std::cerr);
+    }
 
-    return 0;
+    return exit_code;
 }
\ No newline at end of file
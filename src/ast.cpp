@@ -27,6 +27,11 @@ std::string tc_Bitset::get_bits() const {
     return this->bits;
 }
 
+std::size_t tc_Bitset::heap_bytes() const {
+    static const std::size_t inline_capacity = std::string().capacity();
+    return this->bits.capacity() > inline_capacity ? this->bits.capacity() + 1 : 0;
+}
+
 
 // Visitor static method implementations
 void Visitor::visit(ProgramNode* node) {
@@ -254,6 +259,11 @@ void LoopIterationCountGetterVisitor::visit(StmtLoopNode *node) {
     this->_name = node->iteration_count_identifier;
 }
 
+void ParallelLoopGetterVisitor::visit(StmtLoopNode *node) {
+    this->_parallel = node->parallel;
+    this->_reductions = node->reductions;
+}
+
 void EvaluateNodeExpressionGetterVisitor::visit(ExprEvaluateNode *node) {
     this->_expression = node->expression;
     this->_variables = node->variables;
@@ -299,6 +309,14 @@ std::string LoopIterationCountGetterVisitor::getName() const {
     return this->_name;
 }
 
+bool ParallelLoopGetterVisitor::isParallel() const {
+    return this->_parallel;
+}
+
+std::vector<std::pair<std::string, std::string>> ParallelLoopGetterVisitor::getReductions() const {
+    return this->_reductions;
+}
+
 std::string EvaluateNodeExpressionGetterVisitor::getExpression() const {
     return this->_expression;
 }
@@ -0,0 +1,104 @@
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <variant>
+#include <algorithm>
+#include <functional>
+#include <filesystem>
+#include <unordered_map>
+#include <unordered_set>
+#include <stdexcept>
+
+#include "headers/lexer.h"
+#include "headers/error.h"
+#include "headers/parser.h"
+#include "headers/driver.h"
+#include "headers/thread_pool.h"
+#include "headers/batch.h"
+
+std::vector<std::string> tcomp::batch::collect_inputs(const std::vector<std::string> &inputs) {
+    std::vector<std::string> files;
+
+    for (const auto &input : inputs) {
+        std::error_code ec;
+        if (!std::filesystem::is_directory(input, ec)) {
+            files.push_back(input);
+            continue;
+        }
+
+        std::vector<std::string> directory_files;
+        for (const auto &entry : std::filesystem::directory_iterator(input, ec)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".af") {
+                directory_files.push_back(entry.path().string());
+            }
+        }
+        std::ranges::sort(directory_files);
+        files.insert(files.end(), directory_files.begin(), directory_files.end());
+    }
+
+    return files;
+}
+
+int tcomp::batch::run_all(const Options &options, std::ostream &out) {
+    struct Result {
+        std::string output;
+        int exit_code = 1;
+        bool done = false;
+    };
+
+    const std::vector<std::string> files = collect_inputs(options.inputs);
+    std::vector<Result> results(files.size());
+    std::mutex mutex;
+    std::condition_variable finished;
+
+    ThreadPool pool(options.jobs != 0 ? options.jobs : std::thread::hardware_concurrency());
+
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        pool.submit([&, i] {
+            std::ostringstream program_out;
+            int exit_code = 1;
+
+            try {
+                std::ifstream file(files[i]);
+                if (!file.is_open()) {
+                    program_out << "File not found" << std::endl;
+                } else {
+                    auto script = compile(file, files[i], options.max_error_count);
+                    exit_code = run(*script, files[i], program_out, options);
+                }
+            } catch (const std::exception &e) {
+                program_out << "Error: " << e.what() << std::endl;
+            }
+
+            {
+                std::lock_guard lock(mutex);
+                results[i].output = program_out.str();
+                results[i].exit_code = exit_code;
+                results[i].done = true;
+            }
+            finished.notify_one();
+        });
+    }
+
+    // print strictly in input order, streaming each result once it and everything before it is ready
+    int status = 0;
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        std::unique_lock lock(mutex);
+        finished.wait(lock, [&] { return results[i].done; });
+
+        out << "==> " << files[i];
+        if (results[i].exit_code != 0) {
+            out << " (exit " << results[i].exit_code << ")";
+            status = 1;
+        }
+        out << " <==\n" << results[i].output << std::flush;
+    }
+
+    return status;
+}
@@ -0,0 +1,385 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <variant>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <stdexcept>
+#include <cstdint>
+#include <cctype>
+
+#include "headers/ast.h"
+#include "headers/lexer.h"
+#include "headers/error.h"
+#include "headers/semantic_analysis.h"
+#include "headers/tools.h"
+#include "headers/bytecode.h"
+
+
+std::string tcomp::vm::Program::bits(const Value &value) const {
+    return value.literal < 0 ? sem_analysis::int_to_binary(value.produced) : literals[value.literal].bits;
+}
+
+double tcomp::vm::evaluate_text(const Expression &expression, const std::vector<std::string> &values) {
+    return sem_analysis::evaluate_expression(asmfmt::rformat(expression.text, values));
+}
+
+double tcomp::vm::evaluate_native(const Expression &expression, const std::vector<double> &inputs) {
+    std::vector<double> stack;
+    stack.reserve(static_cast<std::size_t>(expression.stack_depth));
+
+    for (const ExprStep &step : expression.code) {
+        switch (step.op) {
+            case ExprOp::Constant: stack.push_back(step.constant); break;
+            case ExprOp::Load:     stack.push_back(inputs[step.index]); break;
+            case ExprOp::Negate:   stack.back() = -stack.back(); break;
+            default: {
+                const double rhs = stack.back();
+                stack.pop_back();
+                stack.back() = apply(step.op, stack.back(), rhs);
+                break;
+            }
+        }
+    }
+    return stack.back();
+}
+
+namespace {
+    using tcomp::vm::ExprOp;
+    using tcomp::vm::ExprStep;
+
+    /**
+     * Parses the subset of exprtk's grammar that `!{...}` bodies use in practice, with exprtk's precedence
+     * levels and associativity, into postfix code. Anything outside the subset (functions, `^`, implicit
+     * multiplication, juxtaposed placeholders whose substituted text would merge, ...) makes `parse` fail
+     * and the expression is left to exprtk.
+     */
+    class ExpressionParser {
+    public:
+        explicit ExpressionParser(const std::string &text) : text(text) {}
+
+        bool parse(std::vector<ExprStep> &code, std::int32_t &stack_depth) {
+            this->advance();
+            if (!this->parse_expression(0) || this->current.kind != Kind::End) {
+                return false;
+            }
+            code = std::move(this->code);
+            stack_depth = this->max_depth;
+            return true;
+        }
+
+    private:
+        enum class Kind { Number, Placeholder, Operator, LeftParen, RightParen, End, Invalid };
+
+        struct Token {
+            Kind kind = Kind::Invalid;
+            ExprOp op = ExprOp::Add;
+            std::string spelling;
+        };
+
+        // exprtk's (left, right) binding powers: or 1/2, and 3/4, comparisons 5/6, additive 7/8, multiplicative 10/11
+        static int left_power(ExprOp op) {
+            switch (op) {
+                case ExprOp::Or: return 1;
+                case ExprOp::And: return 3;
+                case ExprOp::Add: case ExprOp::Sub: return 7;
+                case ExprOp::Mul: case ExprOp::Div: case ExprOp::Mod: return 10;
+                default: return 5;
+            }
+        }
+
+        static constexpr int NEGATION_POWER = 11;
+        static constexpr int UNARY_PLUS_POWER = 13;
+
+        bool parse_expression(int precedence) {
+            if (!this->parse_branch()) {
+                return false;
+            }
+            while (this->current.kind == Kind::Operator) {
+                const ExprOp op = this->current.op;
+                const int left = left_power(op);
+                if (left < precedence) {
+                    break;
+                }
+                this->advance();
+                if (!this->parse_expression(left + 1)) {
+                    return false;
+                }
+                this->emit({op});
+            }
+            return true;
+        }
+
+        bool parse_branch() {
+            switch (this->current.kind) {
+                case Kind::Number: {
+                    const std::string &spelling = this->current.spelling;
+                    const double value = spelling.size() <= 15 && spelling.find('.') == std::string::npos
+                        ? static_cast<double>(std::stoll(spelling))
+                        : sem_analysis::evaluate_expression(spelling);
+                    this->emit({ExprOp::Constant, 0, value});
+                    this->advance();
+                    return this->current.kind != Kind::Number && this->current.kind != Kind::Placeholder && this->current.kind != Kind::LeftParen;
+                }
+                case Kind::Placeholder:
+                    this->emit({ExprOp::Load, this->placeholders++});
+                    this->advance();
+                    return this->current.kind != Kind::Number && this->current.kind != Kind::Placeholder && this->current.kind != Kind::LeftParen;
+                case Kind::LeftParen:
+                    this->advance();
+                    if (!this->parse_expression(0) || this->current.kind != Kind::RightParen) {
+                        return false;
+                    }
+                    this->advance();
+                    return this->current.kind != Kind::Number && this->current.kind != Kind::Placeholder && this->current.kind != Kind::LeftParen;
+                case Kind::Operator:
+                    if (this->current.op == ExprOp::Sub) {
+                        this->advance();
+                        if (!this->parse_expression(NEGATION_POWER)) return false;
+                        this->emit({ExprOp::Negate});
+                        return true;
+                    }
+                    if (this->current.op == ExprOp::Add) {
+                        this->advance();
+                        return this->parse_expression(UNARY_PLUS_POWER);
+                    }
+                    return false;
+                default:
+                    return false;
+            }
+        }
+
+        void emit(const ExprStep &step) {
+            switch (step.op) {
+                case ExprOp::Constant: case ExprOp::Load: ++this->depth; break;
+                case ExprOp::Negate: break;
+                default: --this->depth; break;
+            }
+            this->max_depth = std::max(this->max_depth, this->depth);
+            this->code.push_back(step);
+        }
+
+        void advance() {
+            while (this->pos < this->text.size() && std::isspace(static_cast<unsigned char>(this->text[this->pos]))) {
+                ++this->pos;
+            }
+            this->current = {};
+            if (this->pos >= this->text.size()) {
+                this->current.kind = Kind::End;
+                return;
+            }
+
+            const char c = this->text[this->pos];
+            const char next = this->pos + 1 < this->text.size() ? this->text[this->pos + 1] : '\0';
+
+            if (std::isdigit(static_cast<unsigned char>(c))) {
+                const std::size_t start = this->pos;
+                while (this->pos < this->text.size() && std::isdigit(static_cast<unsigned char>(this->text[this->pos]))) ++this->pos;
+                if (this->pos < this->text.size() && this->text[this->pos] == '.') {
+                    ++this->pos;
+                    const std::size_t fraction = this->pos;
+                    while (this->pos < this->text.size() && std::isdigit(static_cast<unsigned char>(this->text[this->pos]))) ++this->pos;
+                    if (fraction == this->pos) return;  // "1." is left to exprtk
+                }
+                this->current = {Kind::Number, ExprOp::Add, this->text.substr(start, this->pos - start)};
+                return;
+            }
+
+            auto two = [&](ExprOp op) { this->current = {Kind::Operator, op, {}}; this->pos += 2; };
+            auto one = [&](Kind kind, ExprOp op) { this->current = {kind, op, {}}; this->pos += 1; };
+
+            if (c == '{' && next == '}') { this->current.kind = Kind::Placeholder; this->pos += 2; return; }
+            if (c == '<' && next == '=') return two(ExprOp::Le);
+            if (c == '>' && next == '=') return two(ExprOp::Ge);
+            if (c == '=' && next == '=') return two(ExprOp::Eq);
+            if (c == '!' && next == '=') return two(ExprOp::Ne);
+            if (c == '<' && next == '>') return two(ExprOp::Ne);
+
+            switch (c) {
+                case '+': return one(Kind::Operator, ExprOp::Add);
+                case '-': return one(Kind::Operator, ExprOp::Sub);
+                case '*': return one(Kind::Operator, ExprOp::Mul);
+                case '/': return one(Kind::Operator, ExprOp::Div);
+                case '%': return one(Kind::Operator, ExprOp::Mod);
+                case '<': return one(Kind::Operator, ExprOp::Lt);
+                case '>': return one(Kind::Operator, ExprOp::Gt);
+                case '=': return one(Kind::Operator, ExprOp::Eq);
+                case '&': return one(Kind::Operator, ExprOp::And);
+                case '|': return one(Kind::Operator, ExprOp::Or);
+                case '(': return one(Kind::LeftParen, ExprOp::Add);
+                case ')': return one(Kind::RightParen, ExprOp::Add);
+                default: return;  // Invalid
+            }
+        }
+
+        const std::string &text;
+        std::size_t pos = 0;
+        Token current;
+        std::vector<ExprStep> code;
+        std::int32_t placeholders = 0;
+        std::int32_t depth = 0;
+        std::int32_t max_depth = 0;
+    };
+
+    class Compiler {
+    public:
+        Compiler(tcomp::vm::Program &program, const std::vector<std::string> &parameters)
+            : program(program), unbound_parameters(parameters.begin(), parameters.end()) {}
+
+        void compile_block(const std::vector<std::shared_ptr<AST>> &nodes, bool top_level) {
+            using tcomp::vm::Op;
+
+            for (const std::shared_ptr<AST> &node : nodes) {
+                this->origin = node;
+
+                WhichVisitor which_visitor;
+                node->accept(&which_visitor);
+                const std::string &type = which_visitor.getVisitorTypeName();
+
+                if (type == "ExprVariableNode") {
+                    VariableValueGetterVisitor visitor("_DEF_VAL", tc_Bitset("0"));
+                    node->accept(&visitor);
+                    const std::string bits = visitor.getValue().get_bits();
+
+                    if (top_level && this->bind_parameter(visitor.getName())) {
+                        continue;
+                    }
+                    if (bits.empty()) {
+                        // the tree walker only fails once such a value is read; compiled engines refuse it up front
+                        throw std::invalid_argument("Empty bit literal assigned to " + visitor.getName());
+                    }
+
+                    tcomp::vm::Literal literal;
+                    literal.bits = bits;
+                    literal.signed_value = sem_analysis::binary_to_int64_t(bits, true);
+                    literal.unsigned_value = sem_analysis::binary_to_int64_t(bits);
+                    literal.number = sem_analysis::evaluate_expression(std::to_string(literal.signed_value));
+
+                    this->program.literals.push_back(std::move(literal));
+                    this->emit({Op::Literal, this->slot(visitor.getName()), static_cast<std::int32_t>(this->program.literals.size() - 1)});
+                } else if (type == "StmtOutputNode") {
+                    OutputGetterVisitor visitor;
+                    node->accept(&visitor);
+                    this->emit({Op::Output, this->slot(visitor.getName()), -1, visitor.getOutputAsNormal()});
+                } else if (type == "StmtArrayNode") {
+                    ArrayNameManagementVisitor visitor;
+                    node->accept(&visitor);
+
+                    std::vector<std::int32_t> sources;
+                    for (const auto &child : node->getChildren()) {
+                        IdentifierNameGetterVisitor var_visitor;
+                        child->accept(&var_visitor);
+                        sources.push_back(this->slot(var_visitor.getName()));
+                    }
+
+                    this->program.array_sources.push_back(std::move(sources));
+                    this->emit({Op::Array, this->slot(visitor.getName()), static_cast<std::int32_t>(this->program.array_sources.size() - 1)});
+                } else if (type == "StmtLoopNode") {
+                    LoopIterationCountGetterVisitor visitor;
+                    node->accept(&visitor);
+
+                    ParallelLoopGetterVisitor parallel_visitor;
+                    node->accept(&parallel_visitor);
+                    if (parallel_visitor.isParallel()) {
+                        throw std::invalid_argument("Parallel loops are only supported by the interpreter");
+                    }
+
+                    const std::int32_t counter = this->slot(visitor.getName());
+
+                    const std::size_t enter = this->emit({Op::LoopEnter, counter});
+                    const std::size_t head = this->emit({Op::LoopHead, counter});
+                    this->compile_block(node->getChildren(), false);
+                    this->origin = node;
+                    this->emit({Op::LoopBack, counter, static_cast<std::int32_t>(head)});
+
+                    const auto exit = static_cast<std::int32_t>(this->program.code.size());
+                    this->program.code[enter].operand = exit;
+                    this->program.code[head].operand = exit;
+                } else if (type == "ExprEvaluateNode") {
+                    EvaluateNodeExpressionGetterVisitor visitor;
+                    node->accept(&visitor);
+
+                    IdentifierNameGetterVisitor assign_to_visitor;
+                    node->getChildren()[0]->accept(&assign_to_visitor);
+                    const std::string target = assign_to_visitor.getName();
+
+                    if (top_level && visitor.getVariables().empty() && this->bind_parameter(target)) {
+                        continue;
+                    }
+
+                    tcomp::vm::Expression expression;
+                    expression.text = visitor.getExpression();
+                    for (const auto &var : visitor.getVariables()) {
+                        expression.variables.push_back(this->slot(var));
+                    }
+                    tcomp::vm::compile_expression(expression);
+
+                    this->program.expressions.push_back(std::move(expression));
+                    this->emit({Op::Eval, this->slot(target), static_cast<std::int32_t>(this->program.expressions.size() - 1)});
+                }
+            }
+        }
+
+        void finish() const {
+            if (!this->unbound_parameters.empty()) {
+                throw std::invalid_argument("No top-level constant assignment to parameter " + *this->unbound_parameters.begin());
+            }
+        }
+
+    private:
+        std::int32_t slot(const std::string &name) {
+            auto [it, inserted] = this->slot_ids.try_emplace(name, static_cast<std::int32_t>(this->program.slots.size()));
+            if (inserted) {
+                this->program.slots.push_back(name);
+            }
+            return it->second;
+        }
+
+        std::size_t emit(const tcomp::vm::Instr &instr) {
+            this->program.code.push_back(instr);
+            this->program.origins.push_back(this->origin);
+            return this->program.code.size() - 1;
+        }
+
+        bool bind_parameter(const std::string &name) {
+            if (!this->unbound_parameters.erase(name)) {
+                return false;
+            }
+            this->program.parameters.push_back(name);
+            this->emit({tcomp::vm::Op::Param, this->slot(name), static_cast<std::int32_t>(this->program.parameters.size() - 1)});
+            return true;
+        }
+
+        tcomp::vm::Program &program;
+        std::shared_ptr<AST> origin;  // the statement being compiled
+        std::unordered_map<std::string, std::int32_t> slot_ids;
+        std::unordered_set<std::string> unbound_parameters;
+    };
+}
+
+void tcomp::vm::compile_expression(Expression &expression) {
+    ExpressionParser parser(expression.text);
+    if (!parser.parse(expression.code, expression.stack_depth)) {
+        expression.code.clear();
+        expression.stack_depth = 0;
+    }
+}
+
+tcomp::vm::Program tcomp::vm::compile(const std::shared_ptr<ProgramNode> &program, const std::vector<std::string> &parameters) {
+    Program compiled;
+    Compiler compiler(compiled, parameters);
+    compiler.compile_block(program->getChildren(), true);
+    compiler.finish();
+    return compiled;
+}
+
+tcomp::vm::Program tcomp::vm::compile_loop(const std::shared_ptr<AST> &loop) {
+    Program compiled;
+    Compiler compiler(compiled, {});
+    compiler.compile_block({loop}, false);
+    return compiled;
+}
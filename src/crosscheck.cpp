@@ -0,0 +1,618 @@
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <variant>
+#include <random>
+#include <optional>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <stdexcept>
+#include <cstdint>
+#include <cstdlib>
+#include <cerrno>
+#include <filesystem>
+
+#if !defined(_WIN32)
+    #include <fcntl.h>
+    #include <sys/wait.h>
+    #include <unistd.h>
+#endif
+
+#include "headers/ast.h"
+#include "headers/lexer.h"
+#include "headers/error.h"
+#include "headers/parser.h"
+#include "headers/semantic_analysis.h"
+#include "headers/driver.h"
+#include "headers/bytecode.h"
+#include "headers/lanes.h"
+#include "headers/jit.h"
+#include "headers/passes.h"
+#include "headers/emit.h"
+#include "headers/crosscheck.h"
+
+namespace {
+    /// Workers for the parallel tree-walker run; more than one is all it takes to enable the parallel paths
+    constexpr unsigned PARALLEL_JOBS = 4;
+
+    /// Hotness at which the native-loop run compiles a loop, low enough that generated programs switch tiers both
+    /// on entry and at back-edges
+    constexpr std::uint64_t HOT_BACK_EDGES = 5;
+
+    std::map<std::string, std::string> describe(const std::unordered_map<std::string, SymbolInfo> &symbol_table) {
+        std::map<std::string, std::string> symbols;
+        for (const auto &[name, info] : symbol_table) {
+            if (const auto *variable = std::get_if<Variable>(&info)) {
+                symbols[name] = variable->bitset.get_bits();
+            } else if (const auto *array = std::get_if<Array>(&info)) {
+                std::string elements;
+                for (const auto &element : array->variables) {
+                    elements += (elements.empty() ? "" : ",") + element.get_bits();
+                }
+                symbols[name] = "[" + elements + "]";
+            } else {
+                symbols[name] = "<collection>";
+            }
+        }
+        return symbols;
+    }
+
+    tcomp::crosscheck::Outcome run_tree_walker(const tcomp::CompiledScript &script, const std::string &filename, unsigned jobs,
+                                               tcomp::jit::Cache *native = nullptr) {
+        tcomp::crosscheck::Outcome outcome;
+        outcome.backend = jobs == 1 ? "tree walker" : "tree walker --jobs " + std::to_string(jobs);
+        if (native) {
+            outcome.backend += " + jit";
+        }
+
+        std::ostringstream out;
+        try {
+            sem_analysis::SemanticAnalyser semantic_analyser(script.program, filename);
+            semantic_analyser.S_output(out);
+            semantic_analyser.S_jobs(jobs);
+            semantic_analyser.S_jit(native);
+            semantic_analyser.analyze();
+            outcome.symbols = describe(semantic_analyser.G_symbol_table());
+        } catch (const std::exception &e) {
+            out << "Runtime Error: " << e.what() << std::endl;
+            outcome.ok = false;
+        }
+        outcome.output = out.str();
+        return outcome;
+    }
+
+    // #[Ahead-of-time backends]
+    // Emitted programs are built with the tools on PATH and run as executables, which only report their output.
+
+    /// Where `name` is found on PATH, or nothing
+    std::optional<std::filesystem::path> find_program(const std::string &name) {
+        const char *path = std::getenv("PATH");
+        std::istringstream directories(path ? path : "");
+        std::string directory;
+        while (std::getline(directories, directory, ':')) {
+            const std::filesystem::path candidate = std::filesystem::path(directory.empty() ? "." : directory) / name;
+            std::error_code ec;
+            if (std::filesystem::is_regular_file(candidate, ec)) {
+                return candidate;
+            }
+        }
+        return std::nullopt;
+    }
+
+#if !defined(_WIN32)
+    /// Runs `argv` with its stdout written to `output` and its stderr discarded; returns the exit status, or 128 + signal
+    int run_command(const std::vector<std::string> &argv, const std::filesystem::path &output) {
+        const pid_t pid = ::fork();
+        if (pid < 0) {
+            return 127;
+        }
+        if (pid == 0) {
+            const int out_fd = ::open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            const int null_fd = ::open("/dev/null", O_RDWR);
+            ::dup2(null_fd, STDIN_FILENO);
+            ::dup2(out_fd, STDOUT_FILENO);
+            ::dup2(null_fd, STDERR_FILENO);
+            std::vector<char *> args;
+            for (const auto &arg : argv) {
+                args.push_back(const_cast<char *>(arg.c_str()));
+            }
+            args.push_back(nullptr);
+            ::execv(args[0], args.data());
+            ::_exit(127);
+        }
+        int status = 0;
+        while (::waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+        return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    }
+
+    /// Builds an emitted program with the commands in `build` and runs the executable they leave at `executable`
+    tcomp::crosscheck::Outcome run_emitted(const std::string &backend, const std::vector<std::vector<std::string>> &build,
+                                           const std::filesystem::path &executable) {
+        tcomp::crosscheck::Outcome outcome;
+        outcome.backend = backend;
+        outcome.symbols_known = false;
+
+        const std::filesystem::path output = executable.string() + ".out";
+        for (const auto &command : build) {
+            if (const int status = run_command(command, output); status != 0) {
+                outcome.output = "<does not build, " + command[0] + " exited with " + std::to_string(status) + ">\n";
+                outcome.ok = false;
+                return outcome;
+            }
+        }
+        const int status = run_command({executable.string()}, output);
+        std::ifstream file(output, std::ios::binary);
+        std::ostringstream text;
+        text << file.rdbuf();
+        outcome.output = text.str();
+        if (status != 0) {
+            outcome.output += "<exited with " + std::to_string(status) + ">\n";
+            outcome.ok = false;
+        }
+        return outcome;
+    }
+#endif
+
+    /// Emits `program` as C++ and as assembly and runs both, where the tools to build them are installed
+    void run_ahead_of_time(const tcomp::vm::Program &program, const std::string &filename,
+                           std::vector<tcomp::crosscheck::Outcome> &outcomes, std::vector<std::string> &skipped) {
+        try {
+            tcomp::emit::check(program);
+        } catch (const std::invalid_argument &e) {
+            skipped.push_back("emit: " + std::string(e.what()));
+            return;
+        }
+#if defined(_WIN32)
+        (void) filename;
+        (void) outcomes;
+        skipped.push_back("emit-cpp and emit-asm: building and running them needs a POSIX system");
+#else
+        static const std::optional<std::filesystem::path> cxx = find_program("c++");
+        static const std::optional<std::filesystem::path> as = find_program("as");
+        static const std::optional<std::filesystem::path> ld = find_program("ld");
+
+        std::error_code ec;
+        std::string pattern = (std::filesystem::temp_directory_path(ec) / "tcomp-crosscheck-XXXXXX").string();
+        if (ec || ::mkdtemp(pattern.data()) == nullptr) {
+            skipped.push_back("emit-cpp and emit-asm: no temporary directory");
+            return;
+        }
+        const std::filesystem::path directory = pattern;
+
+        if (cxx) {
+            std::ofstream cpp(directory / "program.cpp");
+            tcomp::emit::write_cpp(program, filename, cpp);
+            cpp.close();
+            std::ofstream(directory / tcomp::emit::RUNTIME_HEADER) << tcomp::emit::cpp_runtime();
+            // the flags the README gives; contracting a * b + c into an fma would change results
+            outcomes.push_back(run_emitted("emit-cpp", {{cxx->string(), "-std=c++20", "-O2", "-ffp-contract=off",
+                                                         (directory / "program.cpp").string(), "-o", (directory / "cpp").string()}},
+                                           directory / "cpp"));
+        } else {
+            skipped.push_back("emit-cpp: no c++ on PATH");
+        }
+
+    #if defined(__x86_64__) && defined(__linux__)
+        if (as && ld) {
+            try {
+                std::ostringstream assembly;
+                tcomp::emit::write_asm(program, filename, assembly);
+                std::ofstream(directory / "program.s") << assembly.str();
+                const std::string object = (directory / "program.o").string();
+                outcomes.push_back(run_emitted("emit-asm", {{as->string(), (directory / "program.s").string(), "-o", object},
+                                                            {ld->string(), object, "-o", (directory / "asm").string()}},
+                                               directory / "asm"));
+            } catch (const std::invalid_argument &e) {
+                skipped.push_back("emit-asm: " + std::string(e.what()));
+            }
+        } else {
+            skipped.push_back("emit-asm: no as and ld on PATH");
+        }
+    #else
+        skipped.push_back("emit-asm: needs x86-64 Linux");
+    #endif
+
+        std::filesystem::remove_all(directory, ec);
+#endif
+    }
+
+    /// The lines of a multi-line string, for pointing at the first difference
+    std::vector<std::string> lines_of(const std::string &text) {
+        std::istringstream stream(text);
+        std::vector<std::string> lines;
+        for (std::string line; std::getline(stream, line);) {
+            lines.push_back(std::move(line));
+        }
+        return lines;
+    }
+
+    // #[Generator]
+
+    class Generator {
+    public:
+        explicit Generator(std::mt19937_64 &rng) : rng(rng) {}
+
+        std::string program() {
+            // a few defined variables up front so expressions have something to read
+            for (int i = 0; i < 3; ++i) {
+                this->src << "!{" << (this->chance(20) ? this->edge() : std::to_string(this->number(0, 20))) << "} => " << this->assign_variable() << '\n';
+            }
+            const int statements = this->number(6, 16);
+            for (int i = 0; i < statements; ++i) {
+                this->statement(0);
+            }
+            for (const auto &name : this->variables) {
+                this->src << "<<@ " << name << '\n';
+            }
+            return this->src.str();
+        }
+
+    private:
+        static constexpr int MAX_DEPTH = 2;
+        static constexpr int MODULUS = 100003;
+
+        int number(int low, int high) {
+            return std::uniform_int_distribution<int>(low, high)(this->rng);
+        }
+
+        bool chance(int percent) {
+            return this->number(1, 100) <= percent;
+        }
+
+        /// A constant where conversions change behaviour: the 32-bit magnitude int_to_binary keeps, the sign it
+        /// encodes separately and the 2^53 up to which doubles are exact
+        std::string edge() {
+            static constexpr const char *EDGES[] = {
+                "2147483647", "2147483648", "4294967295", "4294967296", "4294967297",
+                "9007199254740992", "9007199254740993", "(0 - 1)", "(0 - 2147483648)", "(0 - 4294967295)"
+            };
+            return EDGES[this->number(0, static_cast<int>(std::size(EDGES)) - 1)];
+        }
+
+        std::string indent(int depth) const {
+            return std::string(4 * static_cast<std::size_t>(depth), ' ');
+        }
+
+        std::string assign_variable() {
+            // mostly reuse names so statements interact, sometimes introduce a new one
+            if (this->variables.empty() || (this->variables.size() < 6 && this->chance(30))) {
+                this->variables.push_back("v" + std::to_string(this->variables.size()));
+                return this->variables.back();
+            }
+            return this->variables[static_cast<std::size_t>(this->number(0, static_cast<int>(this->variables.size()) - 1))];
+        }
+
+        std::string array_name() {
+            if (this->arrays.empty() || (this->arrays.size() < 3 && this->chance(30))) {
+                this->arrays.push_back("a" + std::to_string(this->arrays.size()));
+            }
+            return this->arrays[static_cast<std::size_t>(this->number(0, static_cast<int>(this->arrays.size()) - 1))];
+        }
+
+        /// A readable scalar: a variable, a counter of an enclosing loop, a small constant or an edge()
+        std::string operand() {
+            if (!this->counters.empty() && this->chance(20)) {
+                return this->counters[static_cast<std::size_t>(this->number(0, static_cast<int>(this->counters.size()) - 1))];
+            }
+            if (this->chance(70)) {
+                return this->variables[static_cast<std::size_t>(this->number(0, static_cast<int>(this->variables.size()) - 1))];
+            }
+            return this->chance(25) ? this->edge() : std::to_string(this->number(0, 12));
+        }
+
+        std::string expression() {
+            const std::string a = this->operand();
+            const std::string b = this->operand();
+            const std::string m = std::to_string(MODULUS);
+            switch (this->number(0, 12)) {
+                case 0: return "(" + a + " + " + b + ") % " + m;
+                case 1: return "(" + a + " - " + b + ") % " + m;
+                case 2: return "(" + a + " * " + b + ") % " + m;
+                case 3: return a + " % " + std::to_string(this->number(1, 13));
+                case 4: return a + " > " + b;
+                case 5: return a + " <= " + b;
+                case 6: return a + " == " + b;
+                case 7: return "(" + a + " > " + b + ") * " + a + " + (" + a + " <= " + b + ") * " + b;
+                case 8: return "-" + a + " % " + m;
+                case 9: return "(" + a + " + " + b + " * " + std::to_string(this->number(1, 5)) + ") % " + m;
+                // unreduced, so values cross 2^32 and go negative
+                case 10: return a + " + " + b;
+                case 11: return a + " - " + b;
+                default: return a + " * " + b;
+            }
+        }
+
+        void statement(int depth) {
+            const int kind = this->number(0, 99);
+            const std::string pad = this->indent(depth);
+
+            if (kind < 12) {
+                std::string bits;
+                const int width = this->number(1, 9);
+                for (int i = 0; i < width; ++i) {
+                    bits += this->chance(50) ? '+' : '-';
+                }
+                this->src << pad << "[" << bits << "] => " << this->assign_variable() << '\n';
+            } else if (kind < 55) {
+                const std::string text = this->expression();
+                this->src << pad << "!{" << text << "} => " << this->assign_variable() << '\n';
+            } else if (kind < 67) {
+                std::string sources;
+                const int count = this->number(0, 2);
+                for (int i = 0; i < count; ++i) {
+                    sources += (i ? ", " : "") + this->variables[static_cast<std::size_t>(this->number(0, static_cast<int>(this->variables.size()) - 1))];
+                }
+                this->src << pad << "<" << sources << "> => " << this->array_name() << '\n';
+            } else if (kind < 80) {
+                if (!this->arrays.empty() && this->chance(25)) {
+                    this->src << pad << "<<@ " << this->arrays[static_cast<std::size_t>(this->number(0, static_cast<int>(this->arrays.size()) - 1))] << '\n';
+                } else {
+                    this->src << pad << (this->chance(50) ? "<<@ " : "<< ") << this->operand_variable() << '\n';
+                }
+            } else if (depth == 0 && this->chance(25)) {
+                this->parallel_loop();
+            } else if (depth < MAX_DEPTH) {
+                this->loop(depth);
+            } else {
+                this->src << pad << "!{" << this->expression() << "} => " << this->assign_variable() << '\n';
+            }
+        }
+
+        std::string operand_variable() {
+            return this->variables[static_cast<std::size_t>(this->number(0, static_cast<int>(this->variables.size()) - 1))];
+        }
+
+        void loop(int depth) {
+            const std::string pad = this->indent(depth);
+            const std::string counter = "c" + std::to_string(depth);
+
+            // top-level loops are sometimes long enough for the parallel loop splitter to take them, and sometimes
+            // accumulate for long enough that the closed forms of -O3 have to check their ranges
+            const bool accumulating = depth == 0 && this->chance(10);
+            const int iterations = accumulating ? this->number(1000, 3000)
+                                 : depth == 0 && this->chance(20) ? this->number(64, 100) : this->number(0, 5);
+            this->src << pad << "!{" << iterations << "} => " << counter << '\n';
+            this->src << pad << "(:" << counter << " ${\n";
+
+            this->counters.push_back(counter);
+            const int statements = this->number(1, iterations > 5 ? 3 : 5);
+            for (int i = 0; i < statements; ++i) {
+                // long loops only get straight-line bodies so generated programs stay quick
+                if (accumulating) {
+                    const std::string name = this->operand_variable();
+                    const std::string step = this->chance(50) ? this->operand() : this->operand() + " * " + this->operand();
+                    this->src << this->indent(depth + 1) << "!{" << name << " + " << step << "} => " << name << '\n';
+                } else if (iterations > 5) {
+                    this->src << this->indent(depth + 1) << "!{" << this->expression() << "} => " << this->assign_variable() << '\n';
+                } else {
+                    this->statement(depth + 1);
+                }
+            }
+            this->counters.pop_back();
+
+            this->src << pad << "})\n";
+        }
+
+        /// A top-level `(:n | op name, ... ${...})` loop; only the tree walker runs these, with one job and with several
+        void parallel_loop() {
+            static constexpr const char *REDUCTIONS[] = {"sum", "product", "min", "max", "xor"};
+            const std::string counter = "c0";
+
+            // reductions need distinct variables, defined before the loop
+            std::vector<std::pair<std::string, std::string>> reductions;
+            const int wanted = this->number(1, 2);
+            for (int i = 0; i < wanted; ++i) {
+                const std::string name = this->operand_variable();
+                if (std::ranges::none_of(reductions, [&](const auto &reduction) { return reduction.second == name; })) {
+                    reductions.emplace_back(REDUCTIONS[this->number(0, static_cast<int>(std::size(REDUCTIONS)) - 1)], name);
+                }
+            }
+
+            // enough iterations that --jobs splits them into several chunks
+            const int iterations = this->chance(50) ? this->number(16, 100) : this->number(0, 5);
+            this->src << "!{" << iterations << "} => " << counter << '\n';
+            this->src << "(:" << counter << " | ";
+            for (std::size_t i = 0; i < reductions.size(); ++i) {
+                this->src << (i ? ", " : "") << reductions[i].first << ' ' << reductions[i].second;
+            }
+            this->src << " ${\n";
+
+            this->counters.push_back(counter);
+            const std::string pad = this->indent(1);
+            const int statements = this->number(0, 2);
+            for (int i = 0; i < statements; ++i) {
+                if (this->chance(60)) {
+                    this->src << pad << "!{" << this->expression() << "} => " << this->assign_variable() << '\n';
+                } else if (this->chance(50)) {
+                    this->src << pad << "<<@ " << this->operand_variable() << '\n';
+                } else {
+                    this->src << pad << "<" << this->operand_variable() << "> => " << this->array_name() << '\n';
+                }
+            }
+            for (const auto &[op, name] : reductions) {
+                const std::string value = this->operand();
+                if (op == "sum") {
+                    this->src << pad << "!{" << name << " + " << value << "} => " << name << '\n';
+                } else if (op == "product") {
+                    this->src << pad << "!{" << name << " * (" << value << " % 7 + 1)} => " << name << '\n';
+                } else if (op == "min") {
+                    this->src << pad << "!{(" << value << " < " << name << ") * " << value << " + (" << value << " >= " << name << ") * "
+                              << name << "} => " << name << '\n';
+                } else if (op == "max") {
+                    this->src << pad << "!{(" << value << " > " << name << ") * " << value << " + (" << value << " <= " << name << ") * "
+                              << name << "} => " << name << '\n';
+                } else {
+                    this->src << pad << "!{" << value << " % " << MODULUS << "} => " << name << '\n';
+                }
+            }
+            this->counters.pop_back();
+
+            this->src << "})\n";
+        }
+
+        std::mt19937_64 &rng;
+        std::ostringstream src;
+        std::vector<std::string> variables;
+        std::vector<std::string> arrays;
+        std::vector<std::string> counters;
+    };
+
+    /// Cross-checks one program; prints a report and returns whether the backends agreed
+    bool check(const std::string &source, const std::string &filename, int max_error_count, bool verbose, std::ostream &out) {
+        std::istringstream stream(source);
+        auto script = tcomp::compile(stream, filename, max_error_count);
+        if (!script->error_pack.errors.empty()) {
+            out << filename << ": does not parse" << std::endl;
+            tcomp::run(*script, filename, out);
+            return false;
+        }
+
+        std::vector<std::string> skipped;
+        const std::vector<tcomp::crosscheck::Outcome> outcomes = tcomp::crosscheck::run_backends(*script, filename, skipped);
+        const std::string difference = tcomp::crosscheck::compare(outcomes);
+
+        if (verbose || !difference.empty()) {
+            out << filename << ": ";
+            for (std::size_t i = 0; i < outcomes.size(); ++i) {
+                out << (i ? ", " : "") << outcomes[i].backend;
+            }
+            for (const auto &reason : skipped) {
+                out << " (skipped " << reason << ")";
+            }
+            out << (difference.empty() ? " agree" : "") << std::endl;
+        }
+        if (!difference.empty()) {
+            out << "  " << difference << std::endl;
+        }
+        return difference.empty();
+    }
+}
+
+std::vector<tcomp::crosscheck::Outcome> tcomp::crosscheck::run_backends(const CompiledScript &script, const std::string &filename, std::vector<std::string> &skipped) {
+    std::vector<Outcome> outcomes;
+    outcomes.push_back(run_tree_walker(script, filename, 1));
+    outcomes.push_back(run_tree_walker(script, filename, PARALLEL_JOBS));
+    if (jit::available()) {
+        jit::Cache native(HOT_BACK_EDGES);
+        outcomes.push_back(run_tree_walker(script, filename, 1, &native));
+    }
+
+    try {
+        const vm::Program compiled = vm::compile(script.program);
+        // the compiled engine as it is and after each level's passes, so a mismatch points at the level that introduced it
+        for (int level = 0; level <= ir::MAX_LEVEL; ++level) {
+            const vm::Program program = ir::optimize(compiled, level);
+            vm::LaneMachine machine(program, 1, {});
+            const std::vector<vm::LaneResult> results = machine.run();
+
+            Outcome outcome;
+            outcome.backend = level == 0 ? "vm" : "vm -O" + std::to_string(level);
+            outcome.output = results[0].output;
+            outcome.ok = results[0].ok;
+            if (outcome.ok) {
+                outcome.symbols = machine.symbols(0);
+            }
+            outcomes.push_back(std::move(outcome));
+        }
+    } catch (const std::invalid_argument &e) {
+        skipped.push_back("vm: " + std::string(e.what()));
+    }
+
+    // the ahead-of-time backends take the program as compiled, as `--emit-cpp` and `--emit-asm` do without -O
+    try {
+        run_ahead_of_time(vm::compile(script.program), filename, outcomes, skipped);
+    } catch (const std::invalid_argument &) {
+        // already reported for the vm
+    }
+
+    return outcomes;
+}
+
+std::string tcomp::crosscheck::compare(const std::vector<Outcome> &outcomes) {
+    const Outcome &reference = outcomes.front();
+
+    for (std::size_t i = 1; i < outcomes.size(); ++i) {
+        const Outcome &other = outcomes[i];
+
+        if (other.output != reference.output) {
+            const std::vector<std::string> lines = lines_of(other.output);
+            const std::vector<std::string> reference_lines = lines_of(reference.output);
+            for (std::size_t line = 0; line < std::max(lines.size(), reference_lines.size()); ++line) {
+                const std::string ours = line < lines.size() ? lines[line] : "<end of output>";
+                const std::string theirs = line < reference_lines.size() ? reference_lines[line] : "<end of output>";
+                if (ours != theirs) {
+                    return other.backend + " output differs at line " + std::to_string(line + 1) + ": \""
+                         + ours + "\" vs \"" + theirs + "\" from " + reference.backend;
+                }
+            }
+            // getline reads "a" and "a\n" alike, so equal lines leave only the final newline
+            return other.backend + " output differs in its trailing newline (" + std::to_string(other.output.size()) + " vs "
+                 + std::to_string(reference.output.size()) + " bytes) from " + reference.backend;
+        }
+
+        // after a runtime error the engines may legitimately have got different amounts of work done
+        if (!reference.ok || !other.ok || !other.symbols_known) {
+            continue;
+        }
+
+        for (const auto &[name, value] : reference.symbols) {
+            auto it = other.symbols.find(name);
+            if (it == other.symbols.end()) {
+                return other.backend + " has no symbol " + name + " (" + reference.backend + ": " + value + ")";
+            }
+            if (it->second != value) {
+                return other.backend + " ends with " + name + " = " + it->second + ", " + reference.backend + " with " + value;
+            }
+        }
+        for (const auto &[name, value] : other.symbols) {
+            if (!reference.symbols.contains(name)) {
+                return other.backend + " defines " + name + " = " + value + ", which " + reference.backend + " does not";
+            }
+        }
+    }
+
+    return "";
+}
+
+std::string tcomp::crosscheck::generate_program(std::mt19937_64 &rng) {
+    return Generator(rng).program();
+}
+
+int tcomp::crosscheck::run(const Options &options, std::ostream &out) {
+    if (options.generate == 0) {
+        std::ifstream file;
+        if (options.input != "-") {
+            file.open(options.input);
+            if (!file.is_open()) {
+                out << "File not found" << std::endl;
+                return 1;
+            }
+        }
+        std::ostringstream source;
+        source << (options.input == "-" ? std::cin : file).rdbuf();
+        return check(source.str(), options.input, options.max_error_count, true, out) ? 0 : 1;
+    }
+
+    const std::uint64_t seed = options.seed != 0 ? options.seed : std::random_device{}();
+    out << "seed " << seed << std::endl;
+
+    unsigned failures = 0;
+    for (unsigned i = 0; i < options.generate; ++i) {
+        // every program gets its own generator, so a failure can be reproduced on its own
+        std::mt19937_64 rng(seed + i);
+        const std::string source = generate_program(rng);
+        if (!check(source, "generated-" + std::to_string(i) + ".af", options.max_error_count, false, out)) {
+            out << "  (program " << i << ", --seed " << seed + i << " --generate 1)\n" << source << std::endl;
+            ++failures;
+        }
+    }
+
+    out << options.generate - failures << "/" << options.generate << " generated programs agree" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,387 @@
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <variant>
+#include <algorithm>
+#include <functional>
+#include <filesystem>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+#include <csignal>
+#include <cerrno>
+#include <stdexcept>
+
+#if !defined(_WIN32)
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+#endif
+
+#include "headers/lexer.h"
+#include "headers/error.h"
+#include "headers/parser.h"
+#include "headers/driver.h"
+#include "headers/thread_pool.h"
+#include "headers/daemon.h"
+
+#if !defined(_WIN32)
+
+namespace {
+    /// Upper bound for any single string on the wire, so a confused peer cannot make us allocate without limit
+    constexpr std::uint32_t MAX_FRAME_SIZE = 64u << 20;
+
+    volatile std::sig_atomic_t stop_requested = 0;
+
+    void request_stop(int) {
+        stop_requested = 1;
+    }
+
+    bool write_all(int fd, const char *data, std::size_t size) {
+        while (size > 0) {
+            const ssize_t written = ::write(fd, data, size);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data += written;
+            size -= static_cast<std::size_t>(written);
+        }
+        return true;
+    }
+
+    bool read_all(int fd, char *data, std::size_t size) {
+        while (size > 0) {
+            const ssize_t got = ::read(fd, data, size);
+            if (got < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            if (got == 0) {
+                return false;
+            }
+            data += got;
+            size -= static_cast<std::size_t>(got);
+        }
+        return true;
+    }
+
+    bool write_u32(int fd, std::uint32_t value) {
+        const char bytes[4] = {
+            static_cast<char>(value & 0xff), static_cast<char>((value >> 8) & 0xff),
+            static_cast<char>((value >> 16) & 0xff), static_cast<char>((value >> 24) & 0xff)
+        };
+        return write_all(fd, bytes, sizeof(bytes));
+    }
+
+    bool read_u32(int fd, std::uint32_t &value) {
+        unsigned char bytes[4];
+        if (!read_all(fd, reinterpret_cast<char *>(bytes), sizeof(bytes))) {
+            return false;
+        }
+        value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<std::uint32_t>(bytes[3]) << 24);
+        return true;
+    }
+
+    bool write_string(int fd, const std::string &str) {
+        return str.size() <= MAX_FRAME_SIZE
+            && write_u32(fd, static_cast<std::uint32_t>(str.size()))
+            && write_all(fd, str.data(), str.size());
+    }
+
+    bool read_string(int fd, std::string &str) {
+        std::uint32_t size = 0;
+        if (!read_u32(fd, size) || size > MAX_FRAME_SIZE) {
+            return false;
+        }
+        str.resize(size);
+        return read_all(fd, str.data(), size);
+    }
+
+    struct Request {
+        std::vector<std::string> args;
+        std::string cwd;
+        std::string stdin_data;
+    };
+
+    bool read_request(int fd, Request &request) {
+        std::uint32_t argc = 0;
+        if (!read_u32(fd, argc) || argc > 4096) {
+            return false;
+        }
+        request.args.resize(argc);
+        for (auto &arg : request.args) {
+            if (!read_string(fd, arg)) return false;
+        }
+        return read_string(fd, request.cwd) && read_string(fd, request.stdin_data);
+    }
+
+    bool write_request(int fd, const Request &request) {
+        if (!write_u32(fd, static_cast<std::uint32_t>(request.args.size()))) {
+            return false;
+        }
+        for (const auto &arg : request.args) {
+            if (!write_string(fd, arg)) return false;
+        }
+        return write_string(fd, request.cwd) && write_string(fd, request.stdin_data);
+    }
+
+    /**
+     * @brief Compiled scripts kept warm between requests.
+     *
+     * File entries are revalidated against the file's mtime and size on every lookup; source-text
+     * entries are keyed by the text itself. The cache is simply dropped when it grows past its cap.
+     */
+    class ScriptCache {
+    public:
+        std::shared_ptr<const tcomp::CompiledScript> get_file(const std::filesystem::path &path, const std::string &filename, int max_error_count) {
+            std::error_code ec;
+            const auto mtime = std::filesystem::last_write_time(path, ec);
+            const auto size = ec ? 0 : std::filesystem::file_size(path, ec);
+            if (ec) {
+                return nullptr;
+            }
+
+            const std::string key = "file:" + std::to_string(max_error_count) + ":" + filename + ":" + path.string();
+            {
+                std::lock_guard lock(this->mutex);
+                if (auto it = this->entries.find(key); it != this->entries.end() && it->second.mtime == mtime && it->second.size == size) {
+                    return it->second.script;
+                }
+            }
+
+            std::ifstream file(path);
+            if (!file.is_open()) {
+                return nullptr;
+            }
+            auto script = tcomp::compile(file, filename, max_error_count);
+            this->insert(key, Entry{script, mtime, size});
+            return script;
+        }
+
+        std::shared_ptr<const tcomp::CompiledScript> get_source(const std::string &source, const std::string &filename, int max_error_count) {
+            const std::string key = "src:" + std::to_string(max_error_count) + ":" + filename + ":" + source;
+            {
+                std::lock_guard lock(this->mutex);
+                if (auto it = this->entries.find(key); it != this->entries.end()) {
+                    return it->second.script;
+                }
+            }
+
+            std::istringstream stream(source);
+            auto script = tcomp::compile(stream, filename, max_error_count);
+            this->insert(key, Entry{script, {}, 0});
+            return script;
+        }
+
+    private:
+        struct Entry {
+            std::shared_ptr<const tcomp::CompiledScript> script;
+            std::filesystem::file_time_type mtime;
+            std::uintmax_t size;
+        };
+
+        static constexpr std::size_t MAX_ENTRIES = 256;
+
+        void insert(const std::string &key, Entry entry) {
+            std::lock_guard lock(this->mutex);
+            if (this->entries.size() >= MAX_ENTRIES) {
+                this->entries.clear();
+            }
+            this->entries.insert_or_assign(key, std::move(entry));
+        }
+
+        std::mutex mutex;
+        std::unordered_map<std::string, Entry> entries;
+    };
+
+    int execute_request(const Request &request, ScriptCache &cache, std::ostream &out) {
+        const tcomp::Options options = tcomp::parse_options(request.args);
+        if (!options.usage_error.empty()) {
+            out << options.usage_error << std::endl;
+            return 1;
+        }
+        tcomp::print_banners(options, out);
+
+        if (!options.serve_socket.empty() || !options.client_socket.empty() || options.batch || !options.sweeps.empty() || options.cross_check ||
+            !options.emit_cpp.empty() || !options.emit_asm.empty() || options.dump_ir) {
+            out << "--serve, --client, --batch, --sweep, --cross-check, --emit-cpp, --emit-asm and --dump-ir cannot be forwarded to a daemon"
+                << std::endl;
+            return 1;
+        }
+
+        // these report on stderr or into files on the local side, and the daemon runs every script on one thread
+        if (options.stats || options.profile || options.sample_frequency != 0 || !options.trace_file.empty() || options.jobs != 0) {
+            out << "--stats, --profile, --sample, --trace and --jobs only work locally, run the script without --client to use them"
+                << std::endl;
+            return 1;
+        }
+
+        std::shared_ptr<const tcomp::CompiledScript> script;
+        if (options.input == "-") {
+            script = cache.get_source(request.stdin_data, options.input, options.max_error_count);
+        } else {
+            std::filesystem::path path(options.input);
+            if (path.is_relative()) {
+                path = std::filesystem::path(request.cwd) / path;
+            }
+            script = cache.get_file(path, options.input, options.max_error_count);
+        }
+
+        if (!script) {
+            out << "File not found" << std::endl;
+            return 1;
+        }
+
+        return tcomp::run(*script, options.input, out, options);
+    }
+
+    void handle_connection(int fd, ScriptCache &cache) {
+        Request request;
+        if (read_request(fd, request)) {
+            std::ostringstream out;
+            int exit_code = 1;
+            try {
+                exit_code = execute_request(request, cache, out);
+            } catch (const std::exception &e) {
+                // the front end still throws on some malformed input; that must not take the daemon down
+                out << "Error: " << e.what() << std::endl;
+            }
+            (void)(write_u32(fd, static_cast<std::uint32_t>(exit_code)) && write_string(fd, out.str()));
+        }
+        ::close(fd);
+    }
+
+    bool fill_address(const std::string &socket_path, sockaddr_un &address) {
+        address = {};
+        address.sun_family = AF_UNIX;
+        if (socket_path.empty() || socket_path.size() >= sizeof(address.sun_path)) {
+            return false;
+        }
+        std::copy(socket_path.begin(), socket_path.end(), address.sun_path);
+        return true;
+    }
+
+    int connect_to(const std::string &socket_path) {
+        sockaddr_un address{};
+        if (!fill_address(socket_path, address)) {
+            return -1;
+        }
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+}
+
+int tcomp::daemon::serve(const std::string &socket_path, unsigned workers) {
+    sockaddr_un address{};
+    if (!fill_address(socket_path, address)) {
+        std::cerr << "Invalid socket path: " << socket_path << std::endl;
+        return 1;
+    }
+
+    if (std::filesystem::exists(socket_path)) {
+        if (const int fd = connect_to(socket_path); fd >= 0) {
+            ::close(fd);
+            std::cerr << "A daemon is already serving " << socket_path << std::endl;
+            return 1;
+        }
+        // stale socket left behind by a daemon that did not shut down cleanly
+        ::unlink(socket_path.c_str());
+    }
+
+    const int listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0
+        || ::bind(listen_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0
+        || ::listen(listen_fd, SOMAXCONN) != 0) {
+        std::cerr << "Could not listen on " << socket_path << ": " << std::strerror(errno) << std::endl;
+        if (listen_fd >= 0) ::close(listen_fd);
+        return 1;
+    }
+
+    std::signal(SIGPIPE, SIG_IGN);
+    std::signal(SIGINT, request_stop);
+    std::signal(SIGTERM, request_stop);
+
+    {
+        ScriptCache cache;
+        ThreadPool pool(workers);
+
+        while (!stop_requested) {
+            pollfd listener{listen_fd, POLLIN, 0};
+            if (::poll(&listener, 1, 200) <= 0) {
+                continue;
+            }
+            const int fd = ::accept(listen_fd, nullptr, nullptr);
+            if (fd < 0) {
+                continue;
+            }
+            pool.submit([fd, &cache] { handle_connection(fd, cache); });
+        }
+    }
+
+    ::close(listen_fd);
+    ::unlink(socket_path.c_str());
+    return 0;
+}
+
+std::optional<int> tcomp::daemon::forward(const std::string &socket_path, const std::vector<std::string> &args) {
+    const int fd = connect_to(socket_path);
+    if (fd < 0) {
+        return std::nullopt;
+    }
+
+    Request request;
+    request.args = args;
+    std::error_code ec;
+    request.cwd = std::filesystem::current_path(ec).string();
+    if (parse_options(args).input == "-") {
+        request.stdin_data.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+    }
+
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::uint32_t exit_code = 1;
+    std::string output;
+    const bool ok = write_request(fd, request) && read_u32(fd, exit_code) && read_string(fd, output);
+    ::close(fd);
+
+    if (!ok) {
+        std::cerr << "Lost connection to daemon at " << socket_path << std::endl;
+        return 1;
+    }
+
+    std::cout << output << std::flush;
+    return static_cast<int>(exit_code);
+}
+
+#else
+
+int tcomp::daemon::serve(const std::string &socket_path, unsigned workers) {
+    (void)socket_path;
+    (void)workers;
+    std::cerr << "--serve is only supported on POSIX systems" << std::endl;
+    return 1;
+}
+
+std::optional<int> tcomp::daemon::forward(const std::string &socket_path, const std::vector<std::string> &args) {
+    (void)socket_path;
+    (void)args;
+    return std::nullopt;
+}
+
+#endif
@@ -0,0 +1,303 @@
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <variant>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "headers/ast.h"
+#include "headers/lexer.h"
+#include "headers/error.h"
+#include "headers/bytecode.h"
+#include "headers/dataflow.h"
+
+void sem_analysis::Effects::merge(const Effects &other) {
+    this->reads.insert(other.reads.begin(), other.reads.end());
+    this->writes.insert(other.writes.begin(), other.writes.end());
+    this->has_loop = this->has_loop || other.has_loop;
+}
+
+bool sem_analysis::Effects::conflicts_with(const Effects &other) const {
+    auto intersects = [](const std::unordered_set<std::string> &a, const std::unordered_set<std::string> &b) {
+        const auto &smaller = a.size() <= b.size() ? a : b;
+        const auto &larger = a.size() <= b.size() ? b : a;
+        return std::ranges::any_of(smaller, [&](const std::string &name) { return larger.contains(name); });
+    };
+
+    return intersects(this->writes, other.writes)
+        || intersects(this->writes, other.reads)
+        || intersects(this->reads, other.writes);
+}
+
+sem_analysis::Effects sem_analysis::statement_effects(const std::shared_ptr<AST> &node, std::unordered_set<std::string> &defined) {
+    Effects effects;
+
+    WhichVisitor which_visitor;
+    node->accept(&which_visitor);
+    const std::string &type = which_visitor.getVisitorTypeName();
+
+    if (type == "ExprVariableNode") {
+        VariableValueGetterVisitor visitor("_DEF_VAL", tc_Bitset("0"));
+        node->accept(&visitor);
+
+        // a literal never overwrites, so it is a no-op once the name certainly exists
+        if (defined.insert(visitor.getName()).second) {
+            effects.reads.insert(visitor.getName());
+            effects.writes.insert(visitor.getName());
+        }
+    } else if (type == "StmtOutputNode") {
+        OutputGetterVisitor visitor;
+        node->accept(&visitor);
+
+        effects.reads.insert(visitor.getName());
+        if (defined.insert(visitor.getName()).second) {
+            effects.writes.insert(visitor.getName());
+        }
+    } else if (type == "StmtArrayNode") {
+        ArrayNameManagementVisitor visitor;
+        node->accept(&visitor);
+
+        for (const auto &child : node->getChildren()) {
+            IdentifierNameGetterVisitor var_visitor;
+            child->accept(&var_visitor);
+
+            effects.reads.insert(var_visitor.getName());
+            if (!defined.contains(var_visitor.getName())) {
+                effects.writes.insert(var_visitor.getName());
+            }
+        }
+        for (const auto &child : node->getChildren()) {
+            IdentifierNameGetterVisitor var_visitor;
+            child->accept(&var_visitor);
+            defined.insert(var_visitor.getName());
+        }
+
+        effects.reads.insert(visitor.getName());
+        effects.writes.insert(visitor.getName());
+        defined.insert(visitor.getName());
+    } else if (type == "StmtLoopNode") {
+        LoopIterationCountGetterVisitor visitor;
+        node->accept(&visitor);
+
+        std::unordered_set<std::string> body_defined = defined;
+        effects = block_effects(node->getChildren(), body_defined);
+        effects.reads.insert(visitor.getName());
+        effects.writes.insert(visitor.getName());
+        effects.has_loop = true;
+    } else if (type == "ExprEvaluateNode") {
+        EvaluateNodeExpressionGetterVisitor visitor;
+        node->accept(&visitor);
+
+        IdentifierNameGetterVisitor assign_to_visitor;
+        node->getChildren()[0]->accept(&assign_to_visitor);
+
+        for (const auto &var : visitor.getVariables()) {
+            effects.reads.insert(var);
+        }
+        effects.reads.insert(assign_to_visitor.getName());
+        effects.writes.insert(assign_to_visitor.getName());
+        defined.insert(assign_to_visitor.getName());
+    }
+
+    return effects;
+}
+
+std::unordered_set<std::string> sem_analysis::array_targets(const std::vector<std::shared_ptr<AST>> &nodes) {
+    std::unordered_set<std::string> targets;
+    for (const auto &node : nodes) {
+        WhichVisitor which_visitor;
+        node->accept(&which_visitor);
+
+        if (which_visitor.getVisitorTypeName() == "StmtArrayNode") {
+            ArrayNameManagementVisitor visitor;
+            node->accept(&visitor);
+            targets.insert(visitor.getName());
+        } else if (which_visitor.getVisitorTypeName() == "StmtLoopNode") {
+            targets.merge(array_targets(node->getChildren()));
+        }
+    }
+    return targets;
+}
+
+sem_analysis::Effects sem_analysis::block_effects(const std::vector<std::shared_ptr<AST>> &nodes, std::unordered_set<std::string> &defined) {
+    Effects effects;
+    for (const auto &node : nodes) {
+        effects.merge(statement_effects(node, defined));
+    }
+    return effects;
+}
+
+std::vector<sem_analysis::Region> sem_analysis::build_regions(const std::vector<std::shared_ptr<AST>> &nodes) {
+    std::vector<Region> regions;
+    std::unordered_set<std::string> defined;
+
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        Effects effects = statement_effects(nodes[i], defined);
+
+        if (effects.has_loop || regions.empty() || regions.back().effects.has_loop) {
+            regions.push_back(Region{i, i + 1, std::move(effects), {}});
+        } else {
+            regions.back().end = i + 1;
+            regions.back().effects.merge(effects);
+        }
+    }
+
+    for (std::size_t j = 0; j < regions.size(); ++j) {
+        for (std::size_t i = 0; i < j; ++i) {
+            if (regions[i].effects.conflicts_with(regions[j].effects)) {
+                regions[j].dependencies.push_back(i);
+            }
+        }
+    }
+
+    return regions;
+}
+
+bool sem_analysis::has_parallel_loops(const std::vector<Region> &regions) {
+    // regions at the same depth of the DAG cannot depend on each other
+    std::vector<std::size_t> depth(regions.size(), 0);
+    std::unordered_map<std::size_t, std::size_t> loops_at_depth;
+
+    for (std::size_t j = 0; j < regions.size(); ++j) {
+        for (const std::size_t i : regions[j].dependencies) {
+            depth[j] = std::max(depth[j], depth[i] + 1);
+        }
+        if (regions[j].effects.has_loop && ++loops_at_depth[depth[j]] >= 2) {
+            return true;
+        }
+    }
+    return false;
+}
+
+namespace {
+    /// Effects of every statement reachable from `nodes`, nested loop headers included, in program order
+    void collect_leaves(const std::vector<std::shared_ptr<AST>> &nodes, std::unordered_set<std::string> defined,
+                        std::vector<std::pair<AST *, sem_analysis::Effects>> &leaves) {
+        for (const auto &node : nodes) {
+            WhichVisitor which_visitor;
+            node->accept(&which_visitor);
+
+            if (which_visitor.getVisitorTypeName() == "StmtLoopNode") {
+                LoopIterationCountGetterVisitor visitor;
+                node->accept(&visitor);
+
+                sem_analysis::Effects header;
+                header.reads.insert(visitor.getName());
+                header.writes.insert(visitor.getName());
+                header.has_loop = true;
+                leaves.emplace_back(node.get(), std::move(header));
+
+                collect_leaves(node->getChildren(), defined, leaves);
+            } else {
+                leaves.emplace_back(node.get(), sem_analysis::statement_effects(node, defined));
+            }
+        }
+    }
+
+    bool touches(const sem_analysis::Effects &effects, const std::string &name) {
+        return effects.reads.contains(name) || effects.writes.contains(name);
+    }
+}
+
+std::optional<sem_analysis::LoopPlan> sem_analysis::plan_parallel_loop(const std::shared_ptr<AST> &loop, const std::unordered_set<std::string> &defined) {
+    LoopPlan plan;
+
+    LoopIterationCountGetterVisitor loop_visitor;
+    loop->accept(&loop_visitor);
+    plan.counter = loop_visitor.getName();
+
+    const std::vector<std::shared_ptr<AST>> &body = loop->getChildren();
+
+    std::vector<std::pair<AST *, Effects>> leaves;
+    collect_leaves(body, defined, leaves);
+
+    std::unordered_set<std::string> written;
+    for (const auto &[statement, effects] : leaves) {
+        plan.touched.insert(effects.reads.begin(), effects.reads.end());
+        plan.touched.insert(effects.writes.begin(), effects.writes.end());
+        written.insert(effects.writes.begin(), effects.writes.end());
+    }
+    plan.touched.insert(plan.counter);
+
+    if (written.contains(plan.counter)) {
+        return std::nullopt;
+    }
+
+    // top-level body statements with everything they touch, to find which statement touches a name first
+    std::vector<std::pair<const std::shared_ptr<AST> *, Effects>> top_level;
+    {
+        std::unordered_set<std::string> body_defined = defined;
+        for (const auto &node : body) {
+            top_level.emplace_back(&node, statement_effects(node, body_defined));
+        }
+    }
+
+    for (const std::string &name : written) {
+        std::vector<AST *> touching;
+        for (const auto &[statement, effects] : leaves) {
+            if (touches(effects, name)) touching.push_back(statement);
+        }
+
+        // a reduction: the only statement touching the name is `!{f(name, ...)} => name` with native code
+        if (touching.size() == 1) {
+            EvaluateNodeExpressionGetterVisitor visitor;
+            IdentifierNameGetterVisitor assign_to_visitor;
+            WhichVisitor which_visitor;
+            touching[0]->accept(&which_visitor);
+
+            if (which_visitor.getVisitorTypeName() == "ExprEvaluateNode") {
+                touching[0]->accept(&visitor);
+                touching[0]->getChildren()[0]->accept(&assign_to_visitor);
+
+                const std::vector<std::string> variables = visitor.getVariables();
+                if (assign_to_visitor.getName() == name && std::ranges::count(variables, name) >= 1) {
+                    tcomp::vm::Expression expression;
+                    expression.text = visitor.getExpression();
+                    tcomp::vm::compile_expression(expression);
+
+                    if (expression.native() && defined.contains(name)) {
+                        plan.reductions.push_back(LoopPlan::Reduction{touching[0], name, variables});
+                        continue;
+                    }
+                }
+            }
+        }
+
+        // a private: the first top-level statement touching the name assigns it without reading it
+        bool is_private = false;
+        for (const auto &[statement, effects] : top_level) {
+            if (!touches(effects, name)) continue;
+
+            WhichVisitor which_visitor;
+            (*statement)->accept(&which_visitor);
+            if (which_visitor.getVisitorTypeName() == "ExprEvaluateNode") {
+                EvaluateNodeExpressionGetterVisitor visitor;
+                (*statement)->accept(&visitor);
+                IdentifierNameGetterVisitor assign_to_visitor;
+                (*statement)->getChildren()[0]->accept(&assign_to_visitor);
+
+                is_private = assign_to_visitor.getName() == name && std::ranges::count(visitor.getVariables(), name) == 0;
+            }
+            break;
+        }
+
+        if (!is_private) {
+            return std::nullopt;
+        }
+        plan.privates.insert(name);
+    }
+
+    // reduction inputs may only be values every iteration computes for itself or that never change
+    for (const auto &reduction : plan.reductions) {
+        for (const auto &input : reduction.inputs) {
+            if (input != reduction.accumulator && written.contains(input) && !plan.privates.contains(input)) {
+                return std::nullopt;
+            }
+        }
+    }
+
+    return plan;
+}
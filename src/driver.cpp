@@ -0,0 +1,219 @@
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <memory>
+#include <variant>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <stdexcept>
+#include <charconv>
+
+#include "headers/lexer.h"
+#include "headers/error.h"
+#include "headers/parser.h"
+#include "headers/semantic_analysis.h"
+#include "headers/driver.h"
+#include "headers/limits.h"
+#include "headers/jit.h"
+#include "headers/passes.h"
+
+#define TURING_COMPLETE_VER "1.0.0"
+
+#define INTERPRETER_NAME "TComplete"
+
+namespace {
+    /**
+     * Parses all of `text` as the value of `flag`. Trailing characters, a sign an unsigned `T` cannot hold and overflow
+     * leave `value` alone and record a usage error in `options` instead.
+     */
+    template <typename T>
+    void parse_number(const std::string &flag, const std::string &text, T &value, tcomp::Options &options) {
+        const char *end = text.data() + text.size();
+        const auto [stopped, error] = std::from_chars(text.data(), end, value);
+        if ((error != std::errc{} || stopped != end) && options.usage_error.empty()) {
+            options.usage_error = flag + " expects a number, got '" + text + "'";
+        }
+    }
+}
+
+tcomp::Options tcomp::parse_options(const std::vector<std::string> &args) {
+    Options options;
+
+    for (std::size_t i = 0; i < args.size(); i++) {
+        const std::size_t first = i;
+        const std::string &arg = args[i];
+        const bool has_value = i + 1 < args.size();
+
+        if (arg == "-h" || arg == "--help") {
+            options.show_help = true;
+        } else if (arg == "-v" || arg == "--version") {
+            options.show_version = true;
+        } else if (arg == "-fmax_error_count" && has_value) {
+            parse_number(arg, args[++i], options.max_error_count, options);
+        } else if (arg == "--serve" && has_value) {
+            options.serve_socket = args[++i];
+            continue;
+        } else if (arg == "--client" && has_value) {
+            options.client_socket = args[++i];
+            continue;
+        } else if (arg == "--batch") {
+            options.batch = true;
+        } else if (arg == "--jobs" && has_value) {
+            parse_number(arg, args[++i], options.jobs, options);
+        } else if (arg == "--sweep" && has_value) {
+            options.sweeps.push_back(args[++i]);
+        } else if (arg == "--stats" || arg.starts_with("--stats=")) {
+            options.stats = true;
+            std::istringstream modes(arg.size() > std::string("--stats=").size() ? arg.substr(std::string("--stats=").size()) : "");
+            for (std::string mode; std::getline(modes, mode, ',');) {
+                options.stats_json |= mode == "json";
+                options.stats_hardware |= mode == "hw";
+            }
+        } else if (arg == "--profile" || arg.starts_with("--profile=")) {
+            options.profile = true;
+            if (arg.size() > std::string("--profile=").size()) {
+                options.profile_output = arg.substr(std::string("--profile=").size());
+            }
+        } else if (arg == "--sample") {
+            options.sample_frequency = 1000;
+        } else if (arg.starts_with("--sample=")) {
+            parse_number("--sample", arg.substr(std::string("--sample=").size()), options.sample_frequency, options);
+        } else if (arg == "--trace" && has_value) {
+            options.trace_file = args[++i];
+        } else if (arg == "--trace-iterations" && has_value) {
+            parse_number(arg, args[++i], options.trace_iterations, options);
+        } else if (arg == "--max-steps" && has_value) {
+            parse_number(arg, args[++i], options.max_steps, options);
+        } else if (arg == "--timeout" && has_value) {
+            parse_number(arg, args[++i], options.timeout_seconds, options);
+        } else if (arg == "--max-memory" && has_value) {
+            try {
+                options.max_memory = limits::parse_size(args[++i]);
+            } catch (const std::invalid_argument &e) {
+                if (options.usage_error.empty()) {
+                    options.usage_error = arg + ": " + e.what();
+                }
+            }
+        } else if (arg == "--no-jit") {
+            options.jit = false;
+        } else if (arg == "--cross-check") {
+            options.cross_check = true;
+        } else if (arg == "--generate" && has_value) {
+            parse_number(arg, args[++i], options.generate, options);
+        } else if (arg == "--seed" && has_value) {
+            parse_number(arg, args[++i], options.seed, options);
+        } else if (arg == "--emit-cpp" && has_value) {
+            options.emit_cpp = args[++i];
+        } else if (arg == "--emit-asm" && has_value) {
+            options.emit_asm = args[++i];
+        } else if (arg == "-O") {
+            options.opt_level = 2;
+        } else if (arg.size() == 3 && arg.starts_with("-O") && arg[2] >= '0' && arg[2] <= '0' + ir::MAX_LEVEL) {
+            options.opt_level = arg[2] - '0';
+        } else if (arg == "--dump-ir") {
+            options.dump_ir = true;
+        } else {
+            options.input = arg;
+            options.inputs.push_back(arg);
+        }
+
+        options.forwarded.insert(options.forwarded.end(), args.begin() + first, args.begin() + i + 1);
+    }
+
+    return options;
+}
+
+void tcomp::print_banners(const Options &options, std::ostream &out) {
+    if (options.show_help)
+        out << INTERPRETER_NAME << std::endl;
+
+    if (options.show_version)
+        out << TURING_COMPLETE_VER << std::endl;
+}
+
+void tcomp::report_limit(const limits::LimitExceeded &error, const std::string &filename, const std::vector<Token> &unfilteredTokens,
+                         const std::map<int, std::string> &unfilteredLines, const limits::Budget *budget, std::ostream &out) {
+    if (error.G_reason() != limits::Reason::Memory) {
+        out << "Stopped after " << (budget ? budget->G_steps() : 0) << " loop iterations: " << error.what() << std::endl;
+        return;
+    }
+
+    // running out of memory is a runtime error of the statement that asked for it
+    ErrorPack errors;
+    errors.augment(Error{
+        .filepath = filename,
+        .type = ErrorType::RUNTIME_ERROR,
+        .Xmessage = error.what(),
+        .line = error.G_line(),
+        .column = error.G_column()
+    });
+    ErrorHandler(errors, unfilteredTokens, unfilteredLines).report(out);
+}
+
+std::shared_ptr<const tcomp::CompiledScript> tcomp::compile(std::istream &source, const std::string &filename, int max_error_count) {
+    Lexer lexer(source);
+
+    auto [tokens, unfilteredTokens, unfilteredLines] = lexer.tokenize();
+
+    auto script = std::make_shared<CompiledScript>();
+
+    Parser parser(filename, tokens, unfilteredTokens, unfilteredLines, ErrorPack{}, max_error_count);
+    parser.S_handle_errors(false);
+    parser.parse();
+
+    script->program = parser.G_program();
+    script->error_pack = parser.G_error_pack();
+    script->unfilteredTokens = std::move(unfilteredTokens);
+    script->unfilteredLines = std::move(unfilteredLines);
+
+    return script;
+}
+
+int tcomp::run(const CompiledScript &script, const std::string &filename, std::ostream &out, const Options &options) {
+    if (!script.error_pack.errors.empty()) {
+        ErrorPack errors = script.error_pack;
+        ErrorHandler E_handler(errors, script.unfilteredTokens, script.unfilteredLines);
+        E_handler.report(out);
+        return 1;
+    }
+
+    std::unique_ptr<limits::Budget> budget;
+    if (options.max_steps != 0 || options.timeout_seconds > 0) {
+        budget = std::make_unique<limits::Budget>(options.max_steps, options.timeout_seconds);
+    }
+    std::unique_ptr<limits::MemoryArena> arena;
+    if (options.max_memory != 0) {
+        arena = std::make_unique<limits::MemoryArena>(options.max_memory);
+    }
+    std::unique_ptr<jit::Cache> native;
+    if (options.jit && jit::available()) {
+        native = std::make_unique<jit::Cache>();
+    }
+
+    if (options.opt_level > 0 && !budget && !arena) {
+        if (const auto exit_code = ir::run(script, options.opt_level, out)) {
+            return *exit_code;
+        }
+    }
+
+    try {
+        sem_analysis::SemanticAnalyser semantic_analyser(script.program, filename);
+        semantic_analyser.S_output(out);
+        semantic_analyser.S_budget(budget.get());
+        semantic_analyser.S_arena(arena.get());
+        semantic_analyser.S_jit(native.get());
+        semantic_analyser.analyze();
+    } catch (const limits::LimitExceeded &e) {
+        report_limit(e, filename, script.unfilteredTokens, script.unfilteredLines, budget.get(), out);
+        return limits::EXIT_LIMIT_EXCEEDED;
+    } catch (const std::exception &e) {
+        out << "Runtime Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,505 @@
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <variant>
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <stdexcept>
+#include <cstdint>
+#include <cmath>
+#include <cctype>
+
+#include "headers/ast.h"
+#include "headers/lexer.h"
+#include "headers/error.h"
+#include "headers/parser.h"
+#include "headers/semantic_analysis.h"
+#include "headers/driver.h"
+#include "headers/bytecode.h"
+#include "headers/profile.h"
+#include "headers/emit.h"
+#include "headers/passes.h"
+
+namespace {
+    using tcomp::vm::ExprOp;
+    using tcomp::vm::Op;
+
+    /// Walks a block with the set of names assigned on every path to it, failing on the first unsafe statement
+    std::size_t check_block(const tcomp::vm::Program &program, const std::vector<bool> &arrays, std::size_t pc, std::size_t end,
+                            std::vector<bool> defined) {
+        auto fail = [&](const std::string &reason) {
+            throw std::invalid_argument(tcomp::emit::describe(program, pc) + ": " + reason);
+        };
+        auto number = [&](std::int32_t slot) {
+            if (arrays[slot]) fail("`" + program.slots[slot] + "` is used both as a number and as an array");
+        };
+
+        while (pc < end) {
+            const tcomp::vm::Instr &instr = program.code[pc];
+            switch (instr.op) {
+                case Op::Literal:
+                    number(instr.slot);
+                    defined[instr.slot] = true;
+                    break;
+                case Op::Eval: {
+                    const tcomp::vm::Expression &expression = program.expressions[instr.operand];
+                    if (!expression.native()) {
+                        fail("only exprtk can evaluate this expression");
+                    }
+                    for (const std::int32_t slot : expression.variables) {
+                        number(slot);
+                        if (!defined[slot]) fail("reads `" + program.slots[slot] + "` before it is assigned");
+                    }
+                    number(instr.slot);
+                    defined[instr.slot] = true;
+                    break;
+                }
+                case Op::Output:
+                    if (arrays[instr.slot] && !defined[instr.slot]) {
+                        fail("prints `" + program.slots[instr.slot] + "` before anything is appended to it");
+                    }
+                    defined[instr.slot] = true;
+                    break;
+                case Op::Array:
+                    for (const std::int32_t slot : program.array_sources[instr.operand]) {
+                        number(slot);
+                        defined[slot] = true;
+                    }
+                    defined[instr.slot] = true;
+                    break;
+                case Op::Copy:
+                    if (arrays[instr.slot] != arrays[instr.operand]) {
+                        fail("`" + program.slots[instr.slot] + "` is used both as a number and as an array");
+                    }
+                    defined[instr.slot] = defined[instr.operand];
+                    break;
+                case Op::LoopEnter: {
+                    number(instr.slot);
+                    if (!defined[instr.slot]) fail("loops over `" + program.slots[instr.slot] + "` before it is assigned");
+                    // the body may not run at all, so what it assigns does not count after the loop
+                    const auto exit = static_cast<std::size_t>(instr.operand);
+                    check_block(program, arrays, pc + 2, exit - 1, defined);
+                    pc = exit;
+                    continue;
+                }
+                default:
+                    fail("cannot be emitted");
+            }
+            ++pc;
+        }
+        return pc;
+    }
+
+    std::string double_literal(double value) {
+        if (std::isnan(value)) return "std::numeric_limits<double>::quiet_NaN()";
+        if (std::isinf(value)) return value > 0 ? "std::numeric_limits<double>::infinity()" : "-std::numeric_limits<double>::infinity()";
+        std::ostringstream text;
+        text << std::hexfloat << value;
+        return text.str();
+    }
+
+    std::string string_literal(const std::string &bits) {
+        return "\"" + bits + "\"";  // only ever 0s and 1s
+    }
+
+    class CppWriter {
+    public:
+        CppWriter(const tcomp::vm::Program &program, std::ostream &out)
+            : program(program), out(out), arrays(tcomp::emit::array_slots(program)) {
+            for (std::size_t slot = 0; slot < program.slots.size(); ++slot) {
+                this->names.push_back(tcomp::emit::symbol(program, slot));
+            }
+        }
+
+        void write(const std::string &source) {
+            this->out << "// " << source << ", translated by turingcomplete --emit-cpp. Build with\n"
+                      << "//     c++ -std=c++20 -O2 -ffp-contract=off <this file>\n"
+                      << "#include \"" << tcomp::emit::RUNTIME_HEADER << "\"\n\n";
+
+            if (!this->program.literals.empty()) {
+                this->out << "static const tc::Literal literals[] = {\n";
+                for (const auto &literal : this->program.literals) {
+                    this->out << "    {" << string_literal(literal.bits) << ", " << literal.bits.size() << ", "
+                              << integer(literal.signed_value) << ", " << integer(literal.unsigned_value) << ", "
+                              << double_literal(literal.number) << "},\n";
+                }
+                this->out << "};\n\n";
+            }
+
+            this->out << "int main() {\n";
+            for (std::size_t slot = 0; slot < this->program.slots.size(); ++slot) {
+                this->out << "    " << (this->arrays[slot] ? "tc::Array " : "tc::Var ") << this->names[slot] << ";  // "
+                          << this->program.slots[slot] << '\n';
+            }
+            this->out << '\n';
+            this->block(0, this->program.code.size(), 1);
+            this->out << "    return tc::finish();\n}\n";
+        }
+
+    private:
+        static std::string integer(std::int64_t value) {
+            // the most negative value has no literal of its own
+            return value == INT64_MIN ? "INT64_MIN" : std::to_string(value) + "LL";
+        }
+
+        void block(std::size_t pc, std::size_t end, int depth) {
+            const std::string indent(4 * static_cast<std::size_t>(depth), ' ');
+
+            while (pc < end) {
+                const tcomp::vm::Instr &instr = this->program.code[pc];
+                const std::string &target = this->names[instr.slot];
+                this->out << indent << "// " << tcomp::emit::describe(this->program, pc) << '\n';
+
+                switch (instr.op) {
+                    case Op::Literal:
+                        this->out << indent << target << ".assign(literals[" << instr.operand << "]);\n";
+                        break;
+                    case Op::Eval:
+                        this->out << indent << target << ".store(" << this->expression(this->program.expressions[instr.operand]) << ");\n";
+                        break;
+                    case Op::Output:
+                        this->out << indent << "tc::print_" << (this->arrays[instr.slot] ? (instr.as_number ? "numbers" : "chars")
+                                                                                           : (instr.as_number ? "number" : "bits"))
+                                  << "(" << target << ");\n";
+                        break;
+                    case Op::Array:
+                        for (const std::int32_t source : this->program.array_sources[instr.operand]) {
+                            this->out << indent << target << ".append(" << this->names[source] << ");\n";
+                        }
+                        break;
+                    case Op::Copy:
+                        this->out << indent << target << " = " << this->names[instr.operand] << ";\n";
+                        break;
+                    case Op::LoopEnter: {
+                        // the counter is read back from the variable every iteration, since the body may assign it
+                        const std::string count = "count" + std::to_string(depth);
+                        const auto exit = static_cast<std::size_t>(instr.operand);
+                        this->out << indent << "for (std::int64_t " << count << "; (" << count << " = " << target << ".count()) > 0;) {\n"
+                                  << indent << "    " << target << ".set(" << count << " - 1);\n";
+                        this->block(pc + 2, exit - 1, depth + 1);
+                        this->out << indent << "}\n";
+                        pc = exit;
+                        continue;
+                    }
+                    default:
+                        break;
+                }
+                ++pc;
+            }
+        }
+
+        std::string expression(const tcomp::vm::Expression &expression) const {
+            std::vector<std::string> stack;
+            for (const tcomp::vm::ExprStep &step : expression.code) {
+                switch (step.op) {
+                    case ExprOp::Constant:
+                        stack.push_back(double_literal(step.constant));
+                        continue;
+                    case ExprOp::Load:
+                        stack.push_back(this->names[expression.variables[step.index]] + ".number");
+                        continue;
+                    case ExprOp::Negate:
+                        stack.back() = "(-" + stack.back() + ")";
+                        continue;
+                    default:
+                        break;
+                }
+
+                const std::string rhs = std::move(stack.back());
+                stack.pop_back();
+                std::string &lhs = stack.back();
+                switch (step.op) {
+                    case ExprOp::Add: lhs = "(" + lhs + " + " + rhs + ")"; break;
+                    case ExprOp::Sub: lhs = "(" + lhs + " - " + rhs + ")"; break;
+                    case ExprOp::Mul: lhs = "(" + lhs + " * " + rhs + ")"; break;
+                    case ExprOp::Div: lhs = "(" + lhs + " / " + rhs + ")"; break;
+                    case ExprOp::Mod: lhs = "std::fmod(" + lhs + ", " + rhs + ")"; break;
+                    case ExprOp::Lt:  lhs = "tc::truth(" + lhs + " < " + rhs + ")"; break;
+                    case ExprOp::Le:  lhs = "tc::truth(" + lhs + " <= " + rhs + ")"; break;
+                    case ExprOp::Gt:  lhs = "tc::truth(" + lhs + " > " + rhs + ")"; break;
+                    case ExprOp::Ge:  lhs = "tc::truth(" + lhs + " >= " + rhs + ")"; break;
+                    case ExprOp::Eq:  lhs = "tc::truth(" + lhs + " == " + rhs + ")"; break;
+                    case ExprOp::Ne:  lhs = "tc::truth(" + lhs + " != " + rhs + ")"; break;
+                    case ExprOp::And: lhs = "tc::truth(" + lhs + " != 0.0 && " + rhs + " != 0.0)"; break;
+                    case ExprOp::Or:  lhs = "tc::truth(" + lhs + " != 0.0 || " + rhs + " != 0.0)"; break;
+                    default: break;
+                }
+            }
+            return stack.back();
+        }
+
+        const tcomp::vm::Program &program;
+        std::ostream &out;
+        std::vector<bool> arrays;
+        std::vector<std::string> names;  // C++ name of each slot
+    };
+}
+
+std::vector<bool> tcomp::emit::array_slots(const vm::Program &program) {
+    std::vector<bool> arrays(program.slots.size(), false);
+    for (const auto &instr : program.code) {
+        if (instr.op == vm::Op::Array) {
+            arrays[instr.slot] = true;
+        }
+    }
+    // the optimiser's temporaries are whatever they are copied from, which a loop may append to further down
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (const auto &instr : program.code) {
+            if (instr.op == vm::Op::Copy && arrays[instr.operand] && !arrays[instr.slot]) {
+                arrays[instr.slot] = changed = true;
+            }
+        }
+    }
+    return arrays;
+}
+
+std::string tcomp::emit::describe(const vm::Program &program, std::size_t pc) {
+    AST *node = program.origins[pc].get();
+    return std::to_string(node->getLine()) + ":" + std::to_string(node->getColumn()) + " " + profile::describe(node);
+}
+
+std::string tcomp::emit::symbol(const vm::Program &program, std::size_t slot) {
+    const std::string &name = program.slots[slot];
+    const bool identifier = !name.empty() && std::ranges::all_of(name, [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    });
+    return identifier ? "v_" + name : "v" + std::to_string(slot);
+}
+
+void tcomp::emit::check(const vm::Program &program) {
+    check_block(program, tcomp::emit::array_slots(program), 0, program.code.size(), std::vector<bool>(program.slots.size(), false));
+}
+
+void tcomp::emit::write_cpp(const vm::Program &program, const std::string &source, std::ostream &out) {
+    CppWriter(program, out).write(source);
+}
+
+const std::string &tcomp::emit::cpp_runtime() {
+    static const std::string header = R"runtime(// Runtime of the programs turingcomplete --emit-cpp writes. Values behave exactly as in the interpreter:
+// `!{...}` is computed on doubles and stored as int_to_binary(static_cast<int64_t>(value)), a sign bit and
+// a 32-bit magnitude, which is what reading the variable back sees.
+#pragma once
+
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <vector>
+
+// a * b + c has to be rounded twice, as the interpreter does; -ffp-contract=off says the same to the compiler
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace tc {
+    struct Literal {
+        const char *bits;
+        int width;
+        std::int64_t signed_value;
+        std::int64_t unsigned_value;
+        double number;  // the signed value as the interpreter's expressions read it
+    };
+
+    inline double truth(bool value) { return value ? 1.0 : 0.0; }
+
+    inline std::uint32_t magnitude(std::int64_t produced) {
+        const auto bits = static_cast<std::uint64_t>(produced);
+        return static_cast<std::uint32_t>(produced < 0 ? 0 - bits : bits);
+    }
+
+    struct Var {
+        const Literal *literal = nullptr;  // set while the variable holds a `[+-...]` literal
+        std::int64_t produced = 0;
+        double number = 0;
+        bool defined = false;
+
+        /// `!{...} => name`; out-of-range values and NaN become INT64_MIN, as the x86-64 conversion does
+        void store(double value) {
+            this->set(value >= -0x1p63 && value < 0x1p63 ? static_cast<std::int64_t>(value) : INT64_MIN);
+        }
+
+        void set(std::int64_t produced) {
+            this->literal = nullptr;
+            this->produced = produced;
+            this->defined = true;
+            this->number = static_cast<double>(this->signed_value());
+        }
+
+        /// A literal only defines a name that is still undefined
+        void assign(const Literal &literal) {
+            if (!this->defined) {
+                this->literal = &literal;
+                this->defined = true;
+                this->number = literal.number;
+            }
+        }
+
+        /// Printing or appending an undefined name defines it as 0
+        void define() {
+            if (!this->defined) this->set(0);
+        }
+
+        std::int64_t signed_value() const {
+            if (this->literal) return this->literal->signed_value;
+            const std::uint32_t m = magnitude(this->produced);
+            return this->produced >= 0 ? m : static_cast<std::int64_t>(m) - (std::int64_t{1} << std::bit_width(m));
+        }
+
+        /// What a loop over this variable counts down from
+        std::int64_t count() const {
+            if (this->literal) return this->literal->unsigned_value;
+            const std::uint32_t m = magnitude(this->produced);
+            return this->produced >= 0 ? m : (std::int64_t{1} << std::bit_width(m)) | m;
+        }
+
+        int width() const {
+            if (this->literal) return this->literal->width;
+            return this->produced == 0 ? 1 : std::bit_width(magnitude(this->produced)) + 1;
+        }
+
+        std::string bits() const {
+            if (this->literal) return this->literal->bits;
+            if (this->produced == 0) return "0";
+            char bits[33];
+            const std::uint32_t m = magnitude(this->produced);
+            const int width = std::bit_width(m);
+            bits[0] = this->produced < 0 ? '1' : '0';
+            for (int bit = 0; bit < width; ++bit) bits[width - bit] = ((m >> bit) & 1) ? '1' : '0';
+            return std::string(bits, static_cast<std::size_t>(width) + 1);
+        }
+    };
+
+    struct Array {
+        std::vector<Var> elements;
+
+        void append(Var &value) {
+            value.define();
+            this->elements.push_back(value);
+        }
+    };
+
+    // #[Output], buffered and written out by finish()
+    inline std::string &output() {
+        static std::string buffer;
+        return buffer;
+    }
+
+    inline void flush() {
+        std::fwrite(output().data(), 1, output().size(), stdout);
+        std::fflush(stdout);
+        output().clear();
+    }
+
+    inline void append_integer(std::int64_t value) {
+        char digits[24];
+        const char *end = std::to_chars(digits, digits + sizeof digits, value).ptr;
+        output().append(digits, static_cast<std::size_t>(end - digits));
+    }
+
+    inline void end_line() {
+        output() += '\n';
+        if (output().size() >= 1 << 16) flush();
+    }
+
+    inline void print_number(Var &value) {
+        value.define();
+        append_integer(value.signed_value());
+        end_line();
+    }
+
+    inline void print_bits(Var &value) {
+        value.define();
+        output() += value.bits();
+        end_line();
+    }
+
+    inline void print_numbers(const Array &array) {
+        for (const Var &element : array.elements) {
+            append_integer(element.signed_value());
+            output() += ' ';
+        }
+        end_line();
+    }
+
+    /// Elements that are not exactly 8 bits wide are skipped
+    inline void print_chars(const Array &array) {
+        for (const Var &element : array.elements) {
+            if (element.width() == 8) output() += static_cast<char>(element.count());
+        }
+        end_line();
+    }
+
+    inline int finish() {
+        flush();
+        return 0;
+    }
+}
+)runtime";
+    return header;
+}
+
+int tcomp::emit::run(const Options &options, std::ostream &out) {
+    std::ifstream file;
+    if (options.input != "-") {
+        file.open(options.input);
+        if (!file.is_open()) {
+            out << "File not found" << std::endl;
+            return 1;
+        }
+    }
+
+    auto script = tcomp::compile(options.input == "-" ? std::cin : file, options.input, options.max_error_count);
+    if (!script->error_pack.errors.empty()) {
+        return tcomp::run(*script, options.input, out);
+    }
+
+    vm::Program program;
+    std::ostringstream cpp, assembly;
+    try {
+        program = ir::optimize(vm::compile(script->program), options.opt_level);
+        check(program);
+        if (!options.emit_cpp.empty()) {
+            write_cpp(program, options.input, cpp);
+        }
+        if (!options.emit_asm.empty()) {
+            write_asm(program, options.input, assembly);
+        }
+    } catch (const std::invalid_argument &e) {
+        out << "Cannot emit " << options.input << ": " << e.what() << std::endl;
+        return 1;
+    }
+
+    auto save = [&](const std::filesystem::path &path, const std::string &text) {
+        std::ofstream file(path);
+        file << text;
+        if (!file) {
+            out << "Could not write " << path.string() << std::endl;
+            return false;
+        }
+        return true;
+    };
+
+    if (!options.emit_cpp.empty()) {
+        const std::filesystem::path target(options.emit_cpp);
+        if (!save(target, cpp.str()) || !save(target.parent_path() / RUNTIME_HEADER, cpp_runtime())) {
+            return 1;
+        }
+    }
+    if (!options.emit_asm.empty() && !save(options.emit_asm, assembly.str())) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,622 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <bit>
+#include <stdexcept>
+#include <cstdint>
+
+#include "headers/bytecode.h"
+#include "headers/emit.h"
+
+namespace {
+    using tcomp::vm::ExprOp;
+    using tcomp::vm::Op;
+
+    /// Expression stack entries live in xmm0..xmm13; xmm14 and xmm15 are scratch
+    constexpr std::int32_t EXPRESSION_REGISTERS = 14;
+
+    /**
+     * The runtime every emitted program carries. A variable is 32 bytes: the number expressions read, the
+     * produced int64, the address of its literal record (0 unless it holds a literal) and whether it is defined.
+     * A literal record holds its signed and unsigned values, number and width, followed by its bits. An array is
+     * its element buffer (mmap'd, grown with mremap), length and capacity; an element is its signed value and
+     * the character `<<` prints for it, or -1 when it is not 8 bits wide.
+     */
+    constexpr const char *RUNTIME = R"runtime(
+# #[Runtime] rdi and rsi are preserved, rax, rcx, rdx, r8-r11 and xmm0 are not (tc_putc and tc_flush preserve everything)
+
+# rax = produced value -> rdx = its 32-bit magnitude
+tc_magnitude:
+    movq %rax, %rdx
+    negq %rdx
+    cmovsq %rax, %rdx
+    movl %edx, %edx
+    ret
+
+# rax = produced value -> rdx = magnitude, rcx = 1 << bit_width(magnitude)
+tc_split:
+    call tc_magnitude
+    movl $1, %r8d
+    testq %rdx, %rdx
+    jz 1f
+    bsrq %rdx, %rcx
+    incl %ecx
+    shlq %cl, %r8
+1:  movq %r8, %rcx
+    ret
+
+# rax = produced value -> rax = what expressions and <<@ read
+tc_produced_signed:
+    testq %rax, %rax
+    js 1f
+    call tc_magnitude
+    movq %rdx, %rax
+    ret
+1:  call tc_split
+    movq %rdx, %rax
+    subq %rcx, %rax
+    ret
+
+# rax = produced value -> rax = what a loop head reads
+tc_produced_unsigned:
+    testq %rax, %rax
+    js 1f
+    call tc_magnitude
+    movq %rdx, %rax
+    ret
+1:  call tc_split
+    movq %rdx, %rax
+    orq %rcx, %rax
+    ret
+
+# rax = produced value -> rax = number of bits it is stored with
+tc_produced_width:
+    testq %rax, %rax
+    jnz 1f
+    movl $1, %eax
+    ret
+1:  call tc_split
+    bsrq %rcx, %rax
+    incq %rax
+    ret
+
+# rdi = variable, rax = produced value: `!{...} => name` and loop heads
+tc_set:
+    movq %rax, 8(%rdi)
+    movq $0, 16(%rdi)
+    movq $1, 24(%rdi)
+    call tc_produced_signed
+    cvtsi2sdq %rax, %xmm0
+    movsd %xmm0, (%rdi)
+    ret
+
+# rdi = variable, rsi = literal record: a literal only defines a name that is still undefined
+tc_assign:
+    cmpq $0, 24(%rdi)
+    jne 1f
+    movq %rsi, 16(%rdi)
+    movq 16(%rsi), %rax
+    movq %rax, (%rdi)
+    movq $1, 24(%rdi)
+1:  ret
+
+# rdi = variable: printing or appending an undefined name defines it as 0
+tc_define:
+    cmpq $0, 24(%rdi)
+    jne 1f
+    xorl %eax, %eax
+    jmp tc_set
+1:  ret
+
+# rdi = variable -> rax
+tc_signed:
+    movq 16(%rdi), %rax
+    testq %rax, %rax
+    jz 1f
+    movq (%rax), %rax
+    ret
+1:  movq 8(%rdi), %rax
+    jmp tc_produced_signed
+
+tc_count:
+    movq 16(%rdi), %rax
+    testq %rax, %rax
+    jz 1f
+    movq 8(%rax), %rax
+    ret
+1:  movq 8(%rdi), %rax
+    jmp tc_produced_unsigned
+
+tc_width:
+    movq 16(%rdi), %rax
+    testq %rax, %rax
+    jz 1f
+    movq 24(%rax), %rax
+    ret
+1:  movq 8(%rdi), %rax
+    jmp tc_produced_width
+
+# rdi = variable, rsi = array
+tc_append:
+    call tc_define
+    movq 8(%rsi), %rax
+    cmpq 16(%rsi), %rax
+    jb 1f
+    call tc_grow
+1:  call tc_width
+    movq $-1, %r9
+    cmpq $8, %rax
+    jne 2f
+    call tc_count
+    movzbl %al, %r9d
+2:  call tc_signed
+    movq 8(%rsi), %rdx
+    shlq $4, %rdx
+    addq (%rsi), %rdx
+    movq %rax, (%rdx)
+    movq %r9, 8(%rdx)
+    incq 8(%rsi)
+    ret
+
+# rsi = array: doubles its capacity
+tc_grow:
+    pushq %rdi
+    pushq %rsi
+    movq 16(%rsi), %rax
+    leaq (%rax,%rax), %rdx
+    testq %rax, %rax
+    jnz 1f
+    movl $4096, %edx
+1:  pushq %rdx
+    shlq $4, %rdx
+    movq (%rsi), %rdi
+    testq %rdi, %rdi
+    jnz 2f
+    movq %rdx, %rsi
+    movl $3, %edx               # PROT_READ | PROT_WRITE
+    movl $0x22, %r10d           # MAP_PRIVATE | MAP_ANONYMOUS
+    movq $-1, %r8
+    xorl %r9d, %r9d
+    movl $9, %eax               # mmap
+    syscall
+    jmp 3f
+2:  shlq $4, %rax
+    movq %rax, %rsi
+    movl $1, %r10d              # MREMAP_MAYMOVE
+    movl $25, %eax              # mremap
+    syscall
+3:  cmpq $-4095, %rax
+    jae tc_out_of_memory
+    popq %rdx
+    popq %rsi
+    popq %rdi
+    movq %rax, (%rsi)
+    movq %rdx, 16(%rsi)
+    ret
+
+tc_out_of_memory:
+    call tc_flush
+    movl $1, %eax               # write
+    movl $2, %edi
+    leaq tc_no_memory(%rip), %rsi
+    movl $tc_no_memory_end - tc_no_memory, %edx
+    syscall
+    movl $60, %eax              # exit
+    movl $1, %edi
+    syscall
+
+# #[Output] buffered in tc_out, written out when it fills up and at exit
+
+# al = character
+tc_putc:
+    pushq %rcx
+    pushq %rdx
+    leaq tc_out(%rip), %rcx
+    movq tc_out_length(%rip), %rdx
+    movb %al, (%rcx,%rdx)
+    incq %rdx
+    movq %rdx, tc_out_length(%rip)
+    cmpq $65536, %rdx
+    jb 1f
+    call tc_flush
+1:  popq %rdx
+    popq %rcx
+    ret
+
+tc_flush:
+    pushq %rax
+    pushq %rcx
+    pushq %rdx
+    pushq %rsi
+    pushq %rdi
+    pushq %r11
+    leaq tc_out(%rip), %rsi
+    movq tc_out_length(%rip), %rdx
+1:  testq %rdx, %rdx
+    jz 2f
+    movl $1, %eax               # write
+    movl $1, %edi
+    syscall
+    testq %rax, %rax
+    jle 2f
+    addq %rax, %rsi
+    subq %rax, %rdx
+    jmp 1b
+2:  movq $0, tc_out_length(%rip)
+    popq %r11
+    popq %rdi
+    popq %rsi
+    popq %rdx
+    popq %rcx
+    popq %rax
+    ret
+
+# rax = signed value, written in decimal
+tc_put_int:
+    pushq %rsi
+    subq $40, %rsp
+    movq %rax, 32(%rsp)
+    leaq 24(%rsp), %rsi
+    testq %rax, %rax
+    jns 1f
+    negq %rax
+1:  movl $10, %ecx
+2:  xorl %edx, %edx
+    divq %rcx
+    addb $48, %dl
+    decq %rsi
+    movb %dl, (%rsi)
+    testq %rax, %rax
+    jnz 2b
+    cmpq $0, 32(%rsp)
+    jge 3f
+    decq %rsi
+    movb $45, (%rsi)
+3:  leaq 24(%rsp), %rcx
+4:  movb (%rsi), %al
+    call tc_putc
+    incq %rsi
+    cmpq %rcx, %rsi
+    jb 4b
+    addq $40, %rsp
+    popq %rsi
+    ret
+
+# rdi = variable: <<@
+tc_print_number:
+    call tc_define
+    call tc_signed
+    call tc_put_int
+    movb $10, %al
+    jmp tc_putc
+
+# rdi = variable: <<
+tc_print_bits:
+    call tc_define
+    movq 16(%rdi), %rdx
+    testq %rdx, %rdx
+    jz 2f
+    leaq 32(%rdx), %r8
+    movq 24(%rdx), %r9
+1:  testq %r9, %r9
+    jz 9f
+    movb (%r8), %al
+    call tc_putc
+    incq %r8
+    decq %r9
+    jmp 1b
+2:  movq 8(%rdi), %rax
+    testq %rax, %rax
+    jnz 3f
+    movb $48, %al
+    call tc_putc
+    jmp 9f
+3:  movq %rax, %r8
+    call tc_magnitude
+    movb $48, %al
+    testq %r8, %r8
+    jns 4f
+    movb $49, %al
+4:  call tc_putc
+    testl %edx, %edx
+    jz 9f
+    bsrl %edx, %ecx
+5:  btl %ecx, %edx
+    setc %al
+    addb $48, %al
+    call tc_putc
+    decl %ecx
+    jns 5b
+9:  movb $10, %al
+    jmp tc_putc
+
+# rdi = array: <<@
+tc_print_numbers:
+    movq (%rdi), %r8
+    movq 8(%rdi), %r9
+1:  testq %r9, %r9
+    jz 2f
+    movq (%r8), %rax
+    call tc_put_int
+    movb $32, %al
+    call tc_putc
+    addq $16, %r8
+    decq %r9
+    jmp 1b
+2:  movb $10, %al
+    jmp tc_putc
+
+# rdi = array: <<, only elements exactly 8 bits wide are printed
+tc_print_chars:
+    movq (%rdi), %r8
+    movq 8(%rdi), %r9
+1:  testq %r9, %r9
+    jz 2f
+    movq 8(%r8), %rax
+    testq %rax, %rax
+    js 3f
+    call tc_putc
+3:  addq $16, %r8
+    decq %r9
+    jmp 1b
+2:  movb $10, %al
+    jmp tc_putc
+
+tc_exit:
+    call tc_flush
+    movl $60, %eax              # exit
+    xorl %edi, %edi
+    syscall
+
+    .section .rodata
+    .p2align 4
+tc_sign:
+    .quad 0x8000000000000000, 0
+tc_no_memory:
+    .ascii "out of memory\n"
+tc_no_memory_end:
+
+    .bss
+    .p2align 4
+tc_out_length:
+    .zero 8
+tc_out:
+    .zero 65536
+)runtime";
+
+    class AsmWriter {
+    public:
+        AsmWriter(const tcomp::vm::Program &program, std::ostream &out)
+            : program(program), out(out), arrays(tcomp::emit::array_slots(program)) {
+            for (std::size_t slot = 0; slot < program.slots.size(); ++slot) {
+                this->names.push_back(tcomp::emit::symbol(program, slot));
+            }
+        }
+
+        void write(const std::string &source) {
+            this->out << "# " << source << ", translated by turingcomplete --emit-asm. Build with\n"
+                      << "#     as <this file> -o program.o && ld program.o -o program\n"
+                      << "    .text\n"
+                      << "    .globl _start\n"
+                      << "_start:\n";
+            this->block(0, this->program.code.size());
+            this->out << "    jmp tc_exit\n" << RUNTIME;
+
+            this->out << "\n    .section .rodata\n";
+            for (std::size_t index = 0; index < this->program.literals.size(); ++index) {
+                const tcomp::vm::Literal &literal = this->program.literals[index];
+                this->out << "    .p2align 3\n"
+                          << ".Lliteral" << index << ":\n"
+                          << "    .quad " << literal.signed_value << ", " << literal.unsigned_value << ", "
+                          << bits(literal.number) << ", " << literal.bits.size() << "\n"
+                          << "    .ascii \"" << literal.bits << "\"\n";
+            }
+            this->out << "    .p2align 3\n";
+            for (const auto &[value, label] : this->constants) {
+                this->out << ".Lconstant" << label << ":\n"
+                          << "    .quad " << value << '\n';
+            }
+
+            this->out << "\n    .bss\n"
+                      << "    .p2align 4\n";
+            for (std::size_t slot = 0; slot < this->program.slots.size(); ++slot) {
+                this->out << this->names[slot] << ":  # " << this->program.slots[slot] << '\n'
+                          << "    .zero " << (this->arrays[slot] ? 24 : 32) << '\n';
+            }
+            this->out << "\n    .section .note.GNU-stack,\"\",@progbits\n";
+        }
+
+    private:
+        static std::string bits(double value) {
+            std::ostringstream text;
+            text << "0x" << std::hex << std::bit_cast<std::uint64_t>(value);
+            return text.str();
+        }
+
+        static std::string xmm(std::int32_t index) {
+            return "%xmm" + std::to_string(index);
+        }
+
+        std::string address(std::int32_t slot) const {
+            return this->names[slot] + "(%rip)";
+        }
+
+        void line(const std::string &instruction) {
+            this->out << "    " << instruction << '\n';
+        }
+
+        void block(std::size_t pc, std::size_t end) {
+            while (pc < end) {
+                const tcomp::vm::Instr &instr = this->program.code[pc];
+                this->out << "    # " << tcomp::emit::describe(this->program, pc) << '\n';
+
+                switch (instr.op) {
+                    case Op::Literal:
+                        this->line("leaq " + this->address(instr.slot) + ", %rdi");
+                        this->line("leaq .Lliteral" + std::to_string(instr.operand) + "(%rip), %rsi");
+                        this->line("call tc_assign");
+                        break;
+                    case Op::Eval:
+                        this->expression(this->program.expressions[instr.operand]);
+                        this->line("cvttsd2si %xmm0, %rax");
+                        this->line("leaq " + this->address(instr.slot) + ", %rdi");
+                        this->line("call tc_set");
+                        break;
+                    case Op::Output:
+                        this->line("leaq " + this->address(instr.slot) + ", %rdi");
+                        this->line(std::string("call tc_print_") + (this->arrays[instr.slot] ? (instr.as_number ? "numbers" : "chars")
+                                                                                            : (instr.as_number ? "number" : "bits")));
+                        break;
+                    case Op::Array:
+                        for (const std::int32_t source : this->program.array_sources[instr.operand]) {
+                            this->line("leaq " + this->address(source) + ", %rdi");
+                            this->line("leaq " + this->address(instr.slot) + ", %rsi");
+                            this->line("call tc_append");
+                        }
+                        break;
+                    case Op::Copy:
+                        if (this->arrays[instr.slot]) {
+                            // an Array record owns its buffer, so a copy would need its own allocation
+                            throw std::invalid_argument(tcomp::emit::describe(this->program, pc) + ": copies an array");
+                        }
+                        this->line("movdqu " + this->address(instr.operand) + ", %xmm0");
+                        this->line("movdqu " + this->names[instr.operand] + "+16(%rip), %xmm1");
+                        this->line("movdqu %xmm0, " + this->address(instr.slot));
+                        this->line("movdqu %xmm1, " + this->names[instr.slot] + "+16(%rip)");
+                        break;
+                    case Op::LoopEnter: {
+                        // the counter is read back from the variable every iteration, since the body may assign it
+                        const std::string head = ".Lhead" + std::to_string(pc), exit = ".Lexit" + std::to_string(pc);
+                        this->out << head << ":\n";
+                        this->line("leaq " + this->address(instr.slot) + ", %rdi");
+                        this->line("call tc_count");
+                        this->line("testq %rax, %rax");
+                        this->line("jle " + exit);
+                        this->line("decq %rax");
+                        this->line("call tc_set");
+                        this->block(pc + 2, static_cast<std::size_t>(instr.operand) - 1);
+                        this->line("jmp " + head);
+                        this->out << exit << ":\n";
+                        pc = static_cast<std::size_t>(instr.operand);
+                        continue;
+                    }
+                    default:
+                        break;
+                }
+                ++pc;
+            }
+        }
+
+        /// Evaluates `expression` into xmm0, the stack growing from xmm0 upwards
+        void expression(const tcomp::vm::Expression &expression) {
+            if (expression.stack_depth > EXPRESSION_REGISTERS) {
+                throw std::invalid_argument("`" + expression.text + "` nests deeper than " + std::to_string(EXPRESSION_REGISTERS) + " operands");
+            }
+
+            std::int32_t depth = 0;
+            for (const tcomp::vm::ExprStep &step : expression.code) {
+                switch (step.op) {
+                    case ExprOp::Constant: {
+                        const std::size_t label = this->constants.emplace(bits(step.constant), this->constants.size()).first->second;
+                        this->line("movsd .Lconstant" + std::to_string(label) + "(%rip), " + xmm(depth++));
+                        continue;
+                    }
+                    case ExprOp::Load:
+                        this->line("movsd " + this->address(expression.variables[step.index]) + ", " + xmm(depth++));
+                        continue;
+                    case ExprOp::Negate:
+                        this->line("xorpd tc_sign(%rip), " + xmm(depth - 1));
+                        continue;
+                    default:
+                        break;
+                }
+
+                const std::string rhs = xmm(--depth), lhs = xmm(depth - 1);
+                switch (step.op) {
+                    case ExprOp::Add: this->line("addsd " + rhs + ", " + lhs); break;
+                    case ExprOp::Sub: this->line("subsd " + rhs + ", " + lhs); break;
+                    case ExprOp::Mul: this->line("mulsd " + rhs + ", " + lhs); break;
+                    case ExprOp::Div: this->line("divsd " + rhs + ", " + lhs); break;
+                    case ExprOp::Mod:
+                        // fprem computes the exact remainder fmod returns, a few bits per round
+                        this->line("movsd " + rhs + ", -16(%rsp)");
+                        this->line("movsd " + lhs + ", -8(%rsp)");
+                        this->line("fldl -16(%rsp)");
+                        this->line("fldl -8(%rsp)");
+                        this->out << "1:\n";
+                        this->line("fprem");
+                        this->line("fnstsw %ax");
+                        this->line("testw $0x400, %ax");
+                        this->line("jnz 1b");
+                        this->line("fstpl -8(%rsp)");
+                        this->line("fstp %st(0)");
+                        this->line("movsd -8(%rsp), " + lhs);
+                        break;
+                    // unordered operands leave CF, ZF and PF set, so each comparison is written to be false for NaN
+                    case ExprOp::Lt: this->compare(lhs, rhs, lhs, "seta"); break;
+                    case ExprOp::Le: this->compare(lhs, rhs, lhs, "setae"); break;
+                    case ExprOp::Gt: this->compare(lhs, lhs, rhs, "seta"); break;
+                    case ExprOp::Ge: this->compare(lhs, lhs, rhs, "setae"); break;
+                    case ExprOp::Eq:
+                        this->line("ucomisd " + rhs + ", " + lhs);
+                        this->line("sete %al");
+                        this->line("setnp %cl");
+                        this->line("andb %cl, %al");
+                        this->truth(lhs);
+                        break;
+                    case ExprOp::Ne:
+                        this->line("ucomisd " + rhs + ", " + lhs);
+                        this->line("setne %al");
+                        this->line("setp %cl");
+                        this->line("orb %cl, %al");
+                        this->truth(lhs);
+                        break;
+                    case ExprOp::And:
+                    case ExprOp::Or:
+                        this->line("xorpd %xmm15, %xmm15");
+                        this->nonzero(lhs, "%al");
+                        this->nonzero(rhs, "%cl");
+                        this->line(std::string(step.op == ExprOp::And ? "andb" : "orb") + " %cl, %al");
+                        this->truth(lhs);
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+
+        /// `target` = `left` > `right` (seta) or >= (setae)
+        void compare(const std::string &target, const std::string &left, const std::string &right, const std::string &set) {
+            this->line("ucomisd " + right + ", " + left);
+            this->line(set + " %al");
+            this->truth(target);
+        }
+
+        /// `reg` = (value != 0), NaN included; xmm15 holds 0
+        void nonzero(const std::string &value, const std::string &reg) {
+            this->line("ucomisd %xmm15, " + value);
+            this->line("setne " + reg);
+            this->line("setp %dl");
+            this->line("orb %dl, " + reg);
+        }
+
+        /// `target` = al ? 1.0 : 0.0
+        void truth(const std::string &target) {
+            this->line("movzbl %al, %eax");
+            this->line("cvtsi2sdl %eax, " + target);
+        }
+
+        const tcomp::vm::Program &program;
+        std::ostream &out;
+        std::vector<bool> arrays;
+        std::vector<std::string> names;                 // symbol of each slot
+        std::map<std::string, std::size_t> constants;   // bits of each double constant -> label number
+    };
+}
+
+void tcomp::emit::write_asm(const vm::Program &program, const std::string &source, std::ostream &out) {
+    AsmWriter(program, out).write(source);
+}
@@ -22,6 +22,7 @@ void ErrorPack::augment(const tcomp::Error &error) {
 
 void ErrorPack::merge(const ErrorPack &error_pack) {
     this->errors.insert(this->errors.end(), error_pack.errors.begin(), error_pack.errors.end());
+    this->stopped_early = this->stopped_early || error_pack.stopped_early;
 }
 
 
@@ -42,10 +43,21 @@ std::string getErrorType(const tcomp::ErrorType type, const tcomp::Error error)
 ErrorHandler::ErrorHandler(ErrorPack &errors, std::vector<Token> unfiltered_tokens, std::map<int, std::string> unfiltered_lines) : errors_(errors), unfiltered_tokens_(std::move(unfiltered_tokens)), unfiltered_lines_(std::move(unfiltered_lines)) {}
 
 void ErrorHandler::handle() {
-    for (auto &err : errors_.errors) {
-        std::cout << getErrorType(err.type, err) << std::endl;
-    }
+    this->report(std::cout);
     if (errors_.errors.size() > 0) {
         std::terminate();
     }
 }
+
+void ErrorHandler::report(std::ostream &out) const {
+    if (errors_.stopped_early) {
+        out << "Too many errors, stopping parsing." << std::endl;
+    }
+    for (auto &err : errors_.errors) {
+        out << getErrorType(err.type, err) << std::endl;
+        // a runtime error's location does not say what went wrong, so its message is printed as well
+        if (err.type == tcomp::ErrorType::RUNTIME_ERROR && !err.Xmessage.empty()) {
+            out << "    " << err.Xmessage << std::endl;
+        }
+    }
+}
@@ -15,6 +15,9 @@ public:
 
     [[nodiscard]] std::string get_bits() const;
 
+    /// Heap memory held by the bits, 0 while they fit inside the string object itself
+    [[nodiscard]] std::size_t heap_bytes() const;
+
 private:
     std::string bits{};
 };
@@ -220,6 +223,20 @@ private:
     std::string _name;
 };
 
+class ParallelLoopGetterVisitor final : public Visitor {
+public:
+    ParallelLoopGetterVisitor() = default;
+
+    void visit(StmtLoopNode *node) override;
+
+    [[nodiscard]] bool isParallel() const;
+    [[nodiscard]] std::vector<std::pair<std::string, std::string>> getReductions() const;
+
+private:
+    bool _parallel = false;
+    std::vector<std::pair<std::string, std::string>> _reductions;
+};
+
 class EvaluateNodeExpressionGetterVisitor final : public Visitor {
 public:
     EvaluateNodeExpressionGetterVisitor() = default;
@@ -258,9 +275,17 @@ public:
 
     virtual void addParent(std::shared_ptr<AST> parent);
 
+    /// Position of the token the node was parsed from (1-based); 0 for nodes the parser synthesised
+    void setLocation(int line, int column) { this->line = line; this->column = column; }
+    [[nodiscard]] int getLine() const { return line; }
+    [[nodiscard]] int getColumn() const { return column; }
+
 protected:
     std::shared_ptr<AST> parent;
     std::vector<std::shared_ptr<AST>> children;
+
+    int line = 0;
+    int column = 0;
 };
 
 /**
@@ -631,6 +656,9 @@ public:
     void addParent(std::shared_ptr<AST> parent) override;
 
     std::string iteration_count_identifier;
+
+    bool parallel = false;                                        // `(:n | ... ${ ... })`
+    std::vector<std::pair<std::string, std::string>> reductions;  // (operator, variable) pairs a parallel loop declares
 };
 
 /**
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace tcomp {
+    struct Options;
+}
+
+/**
+ * Batch runner.
+ *
+ * `turingcomplete --batch [--jobs n] <files or directories...>` compiles and runs every program on a
+ * work-stealing pool. Each program gets its own symbol table and output buffer, and results are printed
+ * in input order (directories expand to their `.af` files sorted by name) as soon as each one and all
+ * of its predecessors have finished, so the combined output is identical from run to run.
+ */
+namespace tcomp::batch {
+    /// Expands directories into their `.af` files, sorted by name; other paths are kept as given
+    [[nodiscard]] std::vector<std::string> collect_inputs(const std::vector<std::string> &inputs);
+
+    /// Runs every input of `options`. Returns 0 when all programs succeeded, 1 otherwise.
+    int run_all(const Options &options, std::ostream &out);
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+class AST;
+class ProgramNode;
+
+/**
+ * Compiled form of a program.
+ *
+ * The tree walker (sem_analysis::SemanticAnalyser) keys every access by name and stores values as bit strings.
+ * `tcomp::vm::compile` resolves names to dense slots once and flattens the AST into a small instruction list,
+ * turning each `!{...}` into postfix code over doubles where exprtk's grammar allows it. Engines that execute
+ * this form must produce exactly the tree walker's output, including its quirks (a literal only defines a
+ * name that is still undefined, printing an undefined name defines it as 0, ...).
+ */
+namespace tcomp::vm {
+    // #[Value semantics]
+    // A `!{...}` result v is stored as int_to_binary(v) (sign bit + 32-bit magnitude) and read back with
+    // binary_to_int64_t. The helpers below reproduce those round trips without building the strings.
+
+    [[nodiscard]] inline std::uint32_t produced_magnitude(std::int64_t v) {
+        return static_cast<unsigned int>(std::abs(v));
+    }
+
+    /// Number of bits int_to_binary(v) produces
+    [[nodiscard]] inline int produced_width(std::int64_t v) {
+        return v == 0 ? 1 : std::bit_width(produced_magnitude(v)) + 1;
+    }
+
+    /// binary_to_int64_t(int_to_binary(v), false), what loop counters see
+    [[nodiscard]] inline std::int64_t produced_unsigned(std::int64_t v) {
+        const std::uint32_t magnitude = produced_magnitude(v);
+        if (v >= 0) {
+            return magnitude;
+        }
+        return (std::int64_t{1} << std::bit_width(magnitude)) | magnitude;
+    }
+
+    /// binary_to_int64_t(int_to_binary(v), true), what expressions and `<<@` see
+    [[nodiscard]] inline std::int64_t produced_signed(std::int64_t v) {
+        const std::uint32_t magnitude = produced_magnitude(v);
+        if (v >= 0) {
+            return magnitude;
+        }
+        return static_cast<std::int64_t>(magnitude) - (std::int64_t{1} << std::bit_width(magnitude));
+    }
+
+    /// A `[+-...]` literal, kept verbatim because it may be wider than 64 bits
+    struct Literal {
+        std::string bits;
+        std::int64_t signed_value = 0;
+        std::int64_t unsigned_value = 0;
+        double number = 0;  // the signed value as exprtk reads it back from its decimal spelling
+    };
+
+    /// One scalar: either the int64 an expression produced, or a literal
+    struct Value {
+        std::int64_t produced = 0;
+        std::int32_t literal = -1;
+    };
+
+    // #[Expressions]
+    enum class ExprOp : std::uint8_t {
+        Constant, Load, Negate,
+        Add, Sub, Mul, Div, Mod,
+        Lt, Le, Gt, Ge, Eq, Ne,
+        And, Or
+    };
+
+    struct ExprStep {
+        ExprOp op;
+        std::int32_t index = 0;  // Load: placeholder number
+        double constant = 0;     // Constant
+    };
+
+    struct Expression {
+        std::string text;                     // the parser's template, one "{}" per variable reference
+        std::vector<std::int32_t> variables;  // slot of each placeholder, in order
+        std::vector<ExprStep> code;           // postfix; empty when only exprtk can evaluate the text
+        std::int32_t stack_depth = 0;
+
+        [[nodiscard]] bool native() const { return !code.empty(); }
+    };
+
+    /// Applies one binary ExprOp the way exprtk does on doubles
+    [[nodiscard]] inline double apply(ExprOp op, double lhs, double rhs) {
+        switch (op) {
+            case ExprOp::Add: return lhs + rhs;
+            case ExprOp::Sub: return lhs - rhs;
+            case ExprOp::Mul: return lhs * rhs;
+            case ExprOp::Div: return lhs / rhs;
+            case ExprOp::Mod: return std::fmod(lhs, rhs);
+            case ExprOp::Lt:  return lhs < rhs ? 1.0 : 0.0;
+            case ExprOp::Le:  return lhs <= rhs ? 1.0 : 0.0;
+            case ExprOp::Gt:  return lhs > rhs ? 1.0 : 0.0;
+            case ExprOp::Ge:  return lhs >= rhs ? 1.0 : 0.0;
+            case ExprOp::Eq:  return lhs == rhs ? 1.0 : 0.0;
+            case ExprOp::Ne:  return lhs != rhs ? 1.0 : 0.0;
+            case ExprOp::And: return (lhs != 0.0 && rhs != 0.0) ? 1.0 : 0.0;
+            case ExprOp::Or:  return (lhs != 0.0 || rhs != 0.0) ? 1.0 : 0.0;
+            default:          return 0.0;
+        }
+    }
+
+    // #[Instructions]
+    enum class Op : std::uint8_t {
+        Literal,    // slot := literals[operand], only if slot is undefined
+        Param,      // slot := the current lane's value of parameters[operand]
+        Eval,       // slot := expressions[operand]
+        Array,      // slot := slot ++ array_sources[operand]
+        Output,     // print slot, as numbers when `as_number` (<<@)
+        Copy,       // slot := exactly what slot `operand` holds (only the optimiser emits these)
+        LoopEnter,  // a loop over counter `slot` starts; operand = first instruction after the loop
+        LoopHead,   // counter `slot` <= 0 ? jump operand : decrement it and fall into the body
+        LoopBack    // jump operand (the LoopHead)
+    };
+
+    struct Instr {
+        Op op;
+        std::int32_t slot = -1;
+        std::int32_t operand = -1;
+        bool as_number = false;
+    };
+
+    struct Program {
+        std::vector<std::string> slots;
+        std::vector<Literal> literals;
+        std::vector<Expression> expressions;
+        std::vector<std::vector<std::int32_t>> array_sources;
+        std::vector<std::string> parameters;
+        std::vector<Instr> code;
+        std::vector<std::shared_ptr<AST>> origins;  // the statement each instruction was compiled from
+
+        [[nodiscard]] std::int64_t signed_value(const Value &value) const {
+            return value.literal < 0 ? produced_signed(value.produced) : literals[value.literal].signed_value;
+        }
+
+        [[nodiscard]] std::int64_t unsigned_value(const Value &value) const {
+            return value.literal < 0 ? produced_unsigned(value.produced) : literals[value.literal].unsigned_value;
+        }
+
+        [[nodiscard]] double number(const Value &value) const {
+            return value.literal < 0 ? static_cast<double>(produced_signed(value.produced)) : literals[value.literal].number;
+        }
+
+        [[nodiscard]] int width(const Value &value) const {
+            return value.literal < 0 ? produced_width(value.produced) : static_cast<int>(literals[value.literal].bits.size());
+        }
+
+        [[nodiscard]] std::string bits(const Value &value) const;
+    };
+
+    /**
+     * Compiles a parsed program.
+     *
+     * Each name in `parameters` turns the program's first top-level constant assignment to that name
+     * (`!{5} => n` or `[+-+] => n`) into a Param instruction, so a caller can supply a different value per run.
+     * Throws std::invalid_argument when a parameter has no such assignment.
+     */
+    [[nodiscard]] Program compile(const std::shared_ptr<ProgramNode> &program, const std::vector<std::string> &parameters = {});
+
+    /**
+     * Compiles one loop statement on its own, for engines that take a single loop over from the tree walker.
+     * The loop's instructions start at 0 and its exit is `code.size()`; names the loop reads must already be
+     * defined when it runs, as the caller provides them rather than the program's earlier statements.
+     */
+    [[nodiscard]] Program compile_loop(const std::shared_ptr<AST> &loop);
+
+    /// Compiles an expression template into postfix code; leaves `code` empty if the text needs exprtk
+    void compile_expression(Expression &expression);
+
+    /// Runs an expression's native postfix code; `inputs[i]` is the value of placeholder i
+    [[nodiscard]] double evaluate_native(const Expression &expression, const std::vector<double> &inputs);
+
+    /// Evaluates an expression through exprtk exactly like the tree walker; `values` are the placeholder spellings
+    [[nodiscard]] double evaluate_text(const Expression &expression, const std::vector<std::string> &values);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Differential testing for `--cross-check`.
+ *
+ * A program is run on every engine that can execute it: the tree walker, the tree walker with parallel
+ * regions and loops enabled, the tree walker with loops running as native code (tcomp::jit) where the
+ * platform has it, and the compiled form (tcomp::vm) on a single lane after each -O level. Where a C++
+ * compiler, or `as` and `ld` on x86-64 Linux, are on PATH, the program is also emitted with `--emit-cpp`
+ * and `--emit-asm` (when tcomp::emit takes it), built and run. Their output and their final symbols must be identical (emitted
+ * executables only report output); the tree walker run with one job is the reference.
+ */
+namespace tcomp::crosscheck {
+    struct Outcome {
+        std::string backend;
+        std::string output;
+        bool ok = true;                              // false when the run stopped with a runtime error
+        bool symbols_known = true;                   // false for emitted executables, which only report their output
+        std::map<std::string, std::string> symbols;  // name -> bits, or `[bits,...]` for arrays
+    };
+
+    /// Runs `script` on every backend; engines that cannot take the program are listed in `skipped` with the reason
+    [[nodiscard]] std::vector<Outcome> run_backends(const CompiledScript &script, const std::string &filename, std::vector<std::string> &skipped);
+
+    /// Describes the first disagreement with the reference (outcomes[0]); empty when every backend agrees
+    [[nodiscard]] std::string compare(const std::vector<Outcome> &outcomes);
+
+    /**
+     * Generates a random program from the constructs Parser::parse accepts: literals, `!{...}` evaluations,
+     * arrays, both kinds of output, loops nested up to two deep and top-level `|` parallel loops with every kind
+     * of reduction, which only the tree walker takes. Loop counters are never assigned inside their own loop,
+     * so generated programs always terminate. Most arithmetic is reduced modulo a small
+     * prime; the rest, and constants near 2^31, 2^32 and 2^53 or below 0, reach the 32-bit magnitude wrap,
+     * the sign encoding and the limits of exact doubles. A few top-level loops accumulate for thousands of
+     * iterations, so the closed forms of -O3 have to check their ranges.
+     */
+    [[nodiscard]] std::string generate_program(std::mt19937_64 &rng);
+
+    /// `--cross-check file.af`, or `--cross-check --generate <n> [--seed <s>]` for n random programs
+    int run(const Options &options, std::ostream &out);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Persistent interpreter daemon.
+ *
+ * `turingcomplete --serve <socket>` keeps one warm process around: compiled scripts are cached
+ * (keyed by path and invalidated on mtime/size change, or by source text) and requests are
+ * executed on a worker pool, each with its own symbol table and output buffer.
+ *
+ * `turingcomplete --client <socket> <args...>` forwards its remaining argv, working directory and,
+ * when the script is `-`, its stdin to the daemon and relays the output and exit code, so callers
+ * only have to add one flag. If nothing is listening the client runs the script itself.
+ *
+ * Wire format (all integers are little-endian u32, strings are a length followed by raw bytes):
+ *   request:  argc, argv[0..argc), cwd, stdin
+ *   response: exit code, output
+ */
+namespace tcomp::daemon {
+    /// Serves forwarded invocations until SIGINT/SIGTERM. Returns the process exit code.
+    int serve(const std::string &socket_path, unsigned workers = std::thread::hardware_concurrency());
+
+    /// Forwards one invocation. Returns std::nullopt when no daemon is listening on `socket_path`.
+    [[nodiscard]] std::optional<int> forward(const std::string &socket_path, const std::vector<std::string> &args);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * Read/write sets of statements, used to find work that can run concurrently.
+ *
+ * A name is "written" by a statement whenever the statement may create or change its symbol table entry,
+ * including the implicit definitions the interpreter performs (printing or appending an undefined name
+ * defines it as 0, a literal only defines a name that does not exist yet). A name is "read" whenever the
+ * statement's behaviour depends on its value or on whether it exists at all.
+ */
+namespace sem_analysis {
+    struct Effects {
+        std::unordered_set<std::string> reads;
+        std::unordered_set<std::string> writes;
+        bool has_loop = false;  // contains a loop and may run for a long time
+
+        void merge(const Effects &other);
+
+        /// True when running the two statements in either order (or at the same time) could differ
+        [[nodiscard]] bool conflicts_with(const Effects &other) const;
+    };
+
+    /**
+     * Effects of one statement.
+     *
+     * `defined` holds the names that are certainly defined before the statement runs (it lets e.g. `<< x` be a
+     * pure read), and is updated with the names the statement certainly defines. Loop bodies may run zero times,
+     * so nothing they define is added.
+     */
+    [[nodiscard]] Effects statement_effects(const std::shared_ptr<AST> &node, std::unordered_set<std::string> &defined);
+
+    /// Names appended to by `<...> => name` anywhere in `nodes`, nested loops included
+    [[nodiscard]] std::unordered_set<std::string> array_targets(const std::vector<std::shared_ptr<AST>> &nodes);
+
+    /// Combined effects of a list of statements, e.g. a loop body
+    [[nodiscard]] Effects block_effects(const std::vector<std::shared_ptr<AST>> &nodes, std::unordered_set<std::string> &defined);
+
+    /// Statements [begin, end) of a block, with the earlier regions they have to wait for
+    struct Region {
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        Effects effects;
+        std::vector<std::size_t> dependencies;
+    };
+
+    /**
+     * Splits a block into regions (every loop on its own, runs of other statements together) and links each
+     * region to every earlier region it conflicts with. Regions without a path between them are independent.
+     */
+    [[nodiscard]] std::vector<Region> build_regions(const std::vector<std::shared_ptr<AST>> &nodes);
+
+    /// True when at least two regions containing loops are independent, i.e. running the regions concurrently can pay off
+    [[nodiscard]] bool has_parallel_loops(const std::vector<Region> &regions);
+
+    /**
+     * How the iterations of a loop can be split across threads.
+     *
+     * Every name the body writes (other than through its reductions) is private: each iteration assigns it with
+     * `!{...}` before anything else touches it, so iterations never see each other's values and the loop leaves
+     * behind the last iteration's value. A reduction is a name only ever touched by one `!{f(acc, ...)} => acc`
+     * statement whose expression has native postfix code; iterations record that statement's other inputs and
+     * the updates are folded in iteration order afterwards, so the result is bit-identical to sequential
+     * execution whatever f is (sum, product, an arithmetic min/max select, ...).
+     */
+    struct LoopPlan {
+        struct Reduction {
+            AST *statement = nullptr;
+            std::string accumulator;
+            std::vector<std::string> inputs;  // the statement's variables, in placeholder order
+        };
+
+        std::string counter;
+        std::unordered_set<std::string> privates;
+        std::vector<Reduction> reductions;
+        std::unordered_set<std::string> touched;  // every name the body may read or write
+    };
+
+    /**
+     * Decides whether the iterations of `loop` are independent apart from reductions.
+     * `defined` holds the names that exist when the loop starts. The caller still has to check that reduction
+     * accumulators and their inputs hold plain variables before relying on the plan.
+     */
+    [[nodiscard]] std::optional<LoopPlan> plan_parallel_loop(const std::shared_ptr<AST> &loop, const std::unordered_set<std::string> &defined);
+}
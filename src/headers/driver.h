@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tcomp::limits {
+    class LimitExceeded;
+    class Budget;
+}
+
+namespace tcomp {
+    /**
+     * @brief Command line options shared by the local interpreter and the daemon.
+     *
+     * The daemon receives a client's argv verbatim and runs it through the same parser,
+     * so every flag means the same thing whether a script is run locally or forwarded.
+     */
+    struct Options {
+        std::string input;                  // the last non-flag argument, the script of a normal run
+        std::vector<std::string> inputs;    // every non-flag argument, for --batch
+        int max_error_count = 20;
+        bool show_help = false;
+        bool show_version = false;
+
+        std::string serve_socket;   // --serve <socket>
+        std::string client_socket;  // --client <socket>
+
+        bool batch = false;         // --batch
+        unsigned jobs = 0;          // --jobs <n>, 0 means one worker per core
+
+        std::vector<std::string> sweeps;  // every --sweep <name=values>
+
+        bool stats = false;         // --stats, or --stats=<modes> with a comma-separated list of json and hw
+        bool stats_json = false;
+        bool stats_hardware = false;
+
+        bool profile = false;       // --profile, or --profile=<file> to also write the collapsed stacks
+        std::string profile_output;
+
+        unsigned sample_frequency = 0;  // --sample, or --sample=<hz>; 0 when not sampling
+
+        std::string trace_file;             // --trace <file>
+        std::uint64_t trace_iterations = 0; // --trace-iterations <n>: trace every n-th loop iteration
+
+        std::uint64_t max_steps = 0;    // --max-steps <n>: stop after n loop iterations, 0 for no limit
+        double timeout_seconds = 0;     // --timeout <seconds>, 0 for no limit
+        std::uint64_t max_memory = 0;   // --max-memory <bytes>[K|M|G]: cap on what variables and arrays hold
+
+        bool jit = true;            // --no-jit interprets every loop instead of running numeric ones as native code
+
+        bool cross_check = false;   // --cross-check
+        unsigned generate = 0;      // --generate <n>: cross-check n random programs instead of the input
+        std::uint64_t seed = 0;     // --seed <s>, 0 picks a random seed
+
+        std::string emit_cpp;       // --emit-cpp <file>: write the program as C++ instead of running it
+        std::string emit_asm;       // --emit-asm <file>: write it as x86-64 assembly
+
+        int opt_level = 0;          // -O0 ... -O3 (-O is -O2): how much the optimiser does before the compiled engines run
+        bool dump_ir = false;       // --dump-ir: print the optimised IR instead of running the program
+
+        /// Set when a flag's value could not be parsed; the run stops with it as a usage error
+        std::string usage_error;
+
+        /// Every argument except the daemon flags, i.e. what a client forwards to the server
+        std::vector<std::string> forwarded;
+    };
+
+    [[nodiscard]] Options parse_options(const std::vector<std::string> &args);
+
+    /// Writes the -h / -v banners requested by `options`
+    void print_banners(const Options &options, std::ostream &out);
+
+    /**
+     * @brief The front-end output for one script: everything needed to execute it again without re-lexing or re-parsing.
+     *
+     * Execution only reads the AST, so a single CompiledScript may be run concurrently by several workers.
+     */
+    struct CompiledScript {
+        std::shared_ptr<ProgramNode> program;
+        ErrorPack error_pack;
+        std::vector<Token> unfilteredTokens;
+        std::map<int, std::string> unfilteredLines;
+    };
+
+    /// Lexes and parses `source` without terminating on syntax errors; they are left in the returned error pack
+    [[nodiscard]] std::shared_ptr<const CompiledScript> compile(std::istream &source, const std::string &filename, int max_error_count = 20);
+
+    /**
+     * Runs a compiled script, writing program output (or its syntax errors) to `out`. Returns the process exit code.
+     * A run that exceeds the --max-steps, --timeout or --max-memory limits in `options` stops with a note on `out`
+     * and tcomp::limits::EXIT_LIMIT_EXCEEDED.
+     */
+    int run(const CompiledScript &script, const std::string &filename, std::ostream &out, const Options &options = {});
+
+    /// Reports a run stopped by a limit: how far it got for steps and time, a runtime error at the failing statement for memory
+    void report_limit(const limits::LimitExceeded &error, const std::string &filename, const std::vector<Token> &unfilteredTokens,
+                      const std::map<int, std::string> &unfilteredLines, const limits::Budget *budget, std::ostream &out);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace tcomp {
+    struct Options;
+}
+
+namespace tcomp::vm {
+    struct Program;
+}
+
+/**
+ * Ahead-of-time backends.
+ *
+ * `--emit-cpp` writes the compiled form of a program (tcomp::vm::compile) as a standalone C++ translation
+ * unit: every name becomes a typed local, loops become `for` loops and `!{...}` becomes a C++ expression
+ * over doubles. Values, output and the int_to_binary round trips come from a small runtime header written
+ * next to it. A program is only emitted when the result is guaranteed to behave exactly like the
+ * interpreter, so anything whose behaviour depends on exprtk or on a runtime error is refused up front.
+ *
+ * `--emit-asm` lowers the same program to GNU assembler source for x86-64 Linux. The file carries its own
+ * runtime, a few routines that format output into a buffer and hand it to the kernel with `write`, so it
+ * assembles and links into a static executable with no libc at all: `as p.s -o p.o && ld p.o -o p`.
+ */
+namespace tcomp::emit {
+    /// The header every emitted translation unit includes, written next to it
+    inline constexpr const char *RUNTIME_HEADER = "tcomp_runtime.h";
+
+    /// Which slots are arrays (targets of `<...> => name`); every other slot holds a number
+    [[nodiscard]] std::vector<bool> array_slots(const vm::Program &program);
+
+    /// "line:column statement" for the statement instruction `pc` was compiled from, for comments and errors
+    [[nodiscard]] std::string describe(const vm::Program &program, std::size_t pc);
+
+    /// The identifier generated code uses for `slot`: v_<name>, or v<slot> when the name is not an identifier
+    [[nodiscard]] std::string symbol(const vm::Program &program, std::size_t slot);
+
+    /**
+     * Checks that `program` can be emitted: every `!{...}` has native code and reads names that are assigned
+     * on every path to it, loop counters are assigned before their loop, and no name is used both as a
+     * number and as an array. Throws std::invalid_argument describing the first statement that cannot be.
+     */
+    void check(const vm::Program &program);
+
+    /// Writes `program` (which must pass `check`) as a C++ translation unit; `source` names the script in its header comment
+    void write_cpp(const vm::Program &program, const std::string &source, std::ostream &out);
+
+    /// The text of RUNTIME_HEADER
+    [[nodiscard]] const std::string &cpp_runtime();
+
+    /// Writes `program` (which must pass `check`) as x86-64 assembly; throws std::invalid_argument for an expression
+    /// too deep for the SSE registers
+    void write_asm(const vm::Program &program, const std::string &source, std::ostream &out);
+
+    /// `--emit-cpp <file.cpp>` / `--emit-asm <file.s> program.af`: writes the requested outputs, reporting problems on `out`
+    int run(const Options &options, std::ostream &out);
+}
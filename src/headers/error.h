@@ -24,6 +24,7 @@ namespace tcomp {
 
 struct ErrorPack {
     std::vector<tcomp::Error> errors;
+    bool stopped_early = false;  // the parser gave up after too many errors
 
     void augment(const tcomp::Error &error);
 
@@ -39,6 +40,9 @@ public:
 
     void handle();
 
+    /// Prints every collected error to `out` without terminating, for hosts (e.g. the daemon) that must outlive a bad script
+    void report(std::ostream &out) const;
+
 private:
     ErrorPack &errors_;
     std::vector<Token> unfiltered_tokens_;
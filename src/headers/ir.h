@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+class AST;
+
+namespace tcomp::vm {
+    struct Program;
+    struct Expression;
+}
+
+/**
+ * The optimiser's intermediate representation, between the compiled program (tcomp::vm::compile) and the
+ * engines that run it.
+ *
+ * A Function is in SSA form with structured control flow: every value is defined once, by one instruction,
+ * and loops are regions. A Loop instruction takes the initial state of every name its body assigns, its body
+ * block starts with one Phi per carried name and ends by yielding their next values, and its Exit values are
+ * what the names hold after it. The counter is one of the carried names; its Phi is the state the loop head
+ * leaves it in, the count after the decrement.
+ *
+ * A name's content is a State value (a produced int64, a literal, or undefined) or an Array value. `!{...}`
+ * arithmetic is on Number values (the doubles exprtk computes with) and becomes a state again through
+ * Truncate and Produce, so folding a chain of assignments reproduces the int_to_binary round trips exactly.
+ * Expressions that read a name that may be undefined, or that only exprtk can evaluate, stay opaque
+ * Evaluate instructions with the interpreter's exact semantics.
+ *
+ * Passes (tcomp::ir::PassManager) rewrite a Function; lower() turns it back into a vm::Program, so every
+ * optimisation is shared by the engines that take one: `--sweep`, `-O` runs and the ahead-of-time backends.
+ */
+namespace tcomp::ir {
+    using ValueId = std::int32_t;
+    constexpr ValueId NONE = -1;
+
+    enum class Type : std::uint8_t { None, State, Array, Number, Integer };
+
+    enum class Opcode : std::uint8_t {
+        // #[States] each tied to the slot it is the content of
+        Undefined,  // the slot before anything is assigned to it
+        Param,      // index = sweep parameter: `!{value} => name`
+        Produce,    // {integer}: int_to_binary(integer)
+        Assign,     // {state}, index = literal: `[+-...] => name`, which only assigns an undefined name
+        Define,     // {state}: the state, or 0 if it is undefined (what printing and appending leave)
+        Evaluate,   // {states of the expression's names}, index = expression: `!{...}` left to the interpreter
+        Phi,        // index = carried position: the value at the top of a loop body
+        Exit,       // {loop}, index = carried position: the value after the loop
+        // #[Arrays]
+        Append,     // {array, states...}
+        // #[Numbers]
+        Number,     // {state}, which is defined: what an expression reads
+        Constant,
+        Negate, Add, Sub, Mul, Div, Mod, Lt, Le, Gt, Ge, Eq, Ne, And, Or,
+        // #[Integers]
+        Truncate,   // {number}: static_cast<std::int64_t>
+        Integer,
+        // #[Effects]
+        Print,      // {state or array}, as_number for `<<@`
+        Loop        // {initial carried states}, body, index = carried position of the counter
+    };
+
+    struct Instr {
+        Opcode op;
+        Type type = Type::None;
+        std::vector<ValueId> operands{};
+        std::int32_t slot = -1;      // the name a State or Array value is the content of
+        std::int32_t index = -1;
+        double constant = 0;
+        std::int64_t integer = 0;
+        bool as_number = false;
+        std::int32_t body = -1;         // Loop: its block
+        std::vector<ValueId> results{}; // Loop: its Exit values
+        std::shared_ptr<AST> origin{};  // the statement this was compiled from
+    };
+
+    struct Block {
+        ValueId loop = NONE;           // the Loop this is the body of, NONE for the program itself
+        std::vector<ValueId> params;   // Phi values
+        std::vector<ValueId> code;     // instructions in execution order (Phi and Exit values are not listed)
+        std::vector<ValueId> yields;   // the carried values at the end of the body
+    };
+
+    /**
+     * @class Function
+     * @brief One program in SSA form.
+     */
+    class Function {
+    public:
+        explicit Function(std::shared_ptr<const vm::Program> source);
+
+        /// Literals, expressions, names and parameters the instructions refer to
+        [[nodiscard]] const vm::Program &G_source() const { return *this->source; }
+
+        [[nodiscard]] Instr &operator[](ValueId value) { return this->values[value]; }
+        [[nodiscard]] const Instr &operator[](ValueId value) const { return this->values[value]; }
+        [[nodiscard]] std::size_t size() const { return this->values.size(); }
+
+        ValueId add(Instr instr);
+
+        /// Replaces every use of `from` (operands, yields and exits) by `to`
+        void replace_uses(ValueId from, ValueId to);
+
+        /// Whether a State value is known to be defined wherever it is used
+        [[nodiscard]] bool defined(ValueId value) const;
+
+        std::vector<Block> blocks;   // blocks[0] is the program
+        std::vector<ValueId> exits;  // the content of every slot at the end, which the run leaves behind
+
+    private:
+        std::shared_ptr<const vm::Program> source;
+        std::vector<Instr> values;
+    };
+
+    /// Whether instructions with this opcode have no effect besides their value, so unused ones can be deleted
+    [[nodiscard]] bool pure(Opcode op);
+
+    [[nodiscard]] const char *name(Opcode op);
+
+    /// Applies a binary Number opcode the way exprtk does (tcomp::vm::apply)
+    [[nodiscard]] double apply(Opcode op, double lhs, double rhs);
+
+    /**
+     * Adds the Number tree of a native expression to `code`, reading `operands` (defined states, one per
+     * placeholder) at its leaves. Returns the root.
+     */
+    ValueId expand(Function &function, const vm::Expression &expression, const std::vector<ValueId> &operands,
+                   const std::shared_ptr<AST> &origin, std::vector<ValueId> &code);
+
+    /**
+     * Builds the SSA form of a compiled program. Throws std::invalid_argument for programs it cannot represent
+     * exactly: names used both as numbers and as arrays, and arrays printed before they may exist.
+     */
+    [[nodiscard]] Function build(const vm::Program &program);
+
+    /**
+     * Turns a Function back into a program: values live in their own name's slot where they can, and in
+     * temporaries (named `%0`, `%1`, ...) where an optimisation made two contents of a name live at once.
+     */
+    [[nodiscard]] vm::Program lower(const Function &function);
+
+    /// Writes the Function as text, for `--dump-ir`
+    void print(const Function &function, std::ostream &out);
+}
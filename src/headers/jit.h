@@ -0,0 +1,173 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class AST;
+
+namespace tcomp::vm {
+    struct Program;
+}
+
+/**
+ * Native code for loops (Linux on x86-64 only), the optimised tier of the interpreter.
+ *
+ * Loops start out interpreted. Every back-edge the interpreter runs counts towards its loop's hotness, and
+ * once a loop has run HOT_LOOP_BACK_EDGES of them (over all its entries) it is compiled: later entries run
+ * native code from the start, and the entry that made it hot switches over at its next back-edge. That is
+ * on-stack replacement without any frame translation, because at a back-edge the symbol table is all the
+ * state a loop has, exactly what a compiled loop takes on entry. Short scripts never pay for compilation.
+ *
+ * A loop statement is compiled on its own (tcomp::vm::compile_loop) and its instructions are translated to
+ * machine code in an mmap'd buffer that is made executable once it is written. For the duration of the loop
+ * every variable lives in an SSE register (or, past the tenth, in the frame) as the double exprtk would read
+ * back, `!{...}` postfix code runs on a register stack and each store reproduces the int_to_binary round trip
+ * with integer instructions, so results match the tree walker exactly. Outputs and array appends call back
+ * into the interpreter. Loops with anything else (literals, expressions only exprtk can evaluate, more than
+ * 64 names) are not translated and keep running in the interpreter.
+ */
+namespace tcomp::jit {
+    /// Interpreted back-edges after which a loop is compiled; an iteration of the tree walker costs about as much as
+    /// translating a loop, so this is where compiling starts to pay off
+    constexpr std::uint64_t HOT_LOOP_BACK_EDGES = 64;
+
+    /// Whether this build can generate native code at all
+    [[nodiscard]] constexpr bool available() {
+#if defined(__x86_64__) && defined(__linux__)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /// What a compiled loop does with each of its slots; a slot may have several roles
+    enum Role : std::uint8_t {
+        Read = 1,      // read by an expression, an array append or as a loop counter: must hold a number on entry
+        Write = 2,     // assigned by `!{...}` or a loop head
+        Counter = 4,   // counter of the loop or of a nested loop
+        Appended = 8,  // target of an array append
+        Assigned = 16  // assigned at the top level of the body before anything reads it, so it may be undefined on entry
+    };
+
+    /// Runs the statements a compiled loop leaves to the interpreter (outputs and array appends)
+    class Runtime {
+    public:
+        virtual ~Runtime() = default;
+        /// Runs instruction `instr` of the loop's program; the slots it reads are written back beforehand
+        virtual void statement(std::int32_t instr) = 0;
+    };
+
+    /**
+     * @class Frame
+     * @brief The state one run of a compiled loop works on, laid out for the generated code.
+     *
+     * The caller fills in the numbers of the slots the loop reads (and the counts of its counters), runs the
+     * loop and writes every dirty slot back from its produced value, which is what `!{...}` assigned.
+     */
+    class Frame {
+    public:
+        explicit Frame(std::size_t slots);
+
+        Frame(const Frame &) = delete;
+        Frame &operator=(const Frame &) = delete;
+
+        /// The value expressions read, as exprtk sees it
+        void S_number(std::size_t slot, double number) { this->words[NUMBERS + slot] = std::bit_cast<std::int64_t>(number); }
+        /// The value a loop head reads (binary_to_int64_t without sign)
+        void S_count(std::size_t slot, std::int64_t count) { this->words[NUMBERS + 2 * this->slots + slot] = count; }
+
+        [[nodiscard]] bool dirty(std::size_t slot) const { return (static_cast<std::uint64_t>(this->words[DIRTY]) >> slot) & 1; }
+        /// What the last store to a dirty slot produced, to be stored as int_to_binary(produced)
+        [[nodiscard]] std::int64_t produced(std::size_t slot) const { return this->words[NUMBERS + this->slots + slot]; }
+        [[nodiscard]] std::uint64_t G_iterations() const { return static_cast<std::uint64_t>(this->words[ITERATIONS]); }
+        /// Statements the loop ran natively, nested loops included (outputs and appends are counted by the interpreter)
+        [[nodiscard]] std::uint64_t G_statements() const { return static_cast<std::uint64_t>(this->words[STATEMENTS]); }
+        /// Set when a statement run by the Runtime threw; the loop stopped right there
+        [[nodiscard]] const std::exception_ptr &G_error() const { return this->error; }
+
+        // word offsets the generated code addresses the frame by
+        static constexpr std::size_t DIRTY = 0, ITERATIONS = 1, STATEMENTS = 2, ZERO = 3, SCRATCH = 4, SELF = 6, NUMBERS = 8;
+
+    private:
+        friend class Loop;
+
+        std::size_t slots;
+        std::vector<std::int64_t> words;  // header, then numbers, produced values and counts of every slot
+        Runtime *runtime = nullptr;
+        std::exception_ptr error;
+    };
+
+    /**
+     * @class Loop
+     * @brief One loop statement translated to machine code.
+     */
+    class Loop {
+    public:
+        Loop(std::unique_ptr<vm::Program> program, std::vector<std::uint8_t> roles, void *code, std::size_t size);
+        ~Loop();
+
+        Loop(const Loop &) = delete;
+        Loop &operator=(const Loop &) = delete;
+
+        [[nodiscard]] const vm::Program &G_program() const { return *this->program; }
+        /// Role bits of every slot of the program
+        [[nodiscard]] const std::vector<std::uint8_t> &G_roles() const { return this->roles; }
+
+        /// Runs the loop until it exits or a statement run by `runtime` throws
+        void run(Frame &frame, Runtime &runtime) const;
+
+    private:
+        friend std::unique_ptr<Loop> compile(vm::Program program);
+
+        /// Called by the generated code for statements left to the Runtime; returns nonzero when the statement threw
+        static int run_statement(std::int64_t *words, std::int32_t instr) noexcept;
+
+        std::unique_ptr<vm::Program> program;
+        std::vector<std::uint8_t> roles;
+        void *code;
+        std::size_t size;
+    };
+
+    /// Translates a program from vm::compile_loop; nullptr when the loop uses something the JIT does not translate
+    [[nodiscard]] std::unique_ptr<Loop> compile(vm::Program program);
+
+    /**
+     * @class Cache
+     * @brief The hotness and native code of every loop a run has entered, shared by all threads of the run.
+     */
+    class Cache {
+    public:
+        /// `hot_back_edges` of 0 compiles every loop on its first entry
+        explicit Cache(std::uint64_t hot_back_edges = HOT_LOOP_BACK_EDGES);
+
+        /**
+         * Called when `loop` is entered. Returns its native code if it is hot and could be translated; otherwise
+         * nullptr, with how many more back-edges make it hot in `cold_for` (UINT64_MAX when it cannot be translated).
+         */
+        [[nodiscard]] const Loop *enter(const std::shared_ptr<AST> &loop, std::uint64_t &cold_for);
+
+        /// Adds `back_edges` interpreted back-edges to `loop`, compiling it when that makes it hot; returns its native code if any
+        const Loop *heat(const std::shared_ptr<AST> &loop, std::uint64_t back_edges);
+
+        [[nodiscard]] std::uint64_t G_hot_back_edges() const { return this->hot_back_edges; }
+
+    private:
+        struct Entry {
+            std::uint64_t back_edges = 0;
+            bool compiled = false;  // translation was attempted; `native` is nullptr if it failed
+            std::unique_ptr<Loop> native;
+        };
+
+        /// Compiles the entry's loop once it is hot, with the mutex held
+        void promote(const std::shared_ptr<AST> &loop, Entry &entry) const;
+
+        const std::uint64_t hot_back_edges;
+        std::mutex mutex;
+        std::unordered_map<const AST *, Entry> loops;
+    };
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Lockstep execution of one compiled program over many parameter sets.
+ *
+ * `turingcomplete --sweep numtimes=1..1000 program.af` compiles the program once (tcomp::vm::compile) with
+ * `numtimes` as a parameter and runs one lane per value. Lanes are grouped into blocks that walk the
+ * instruction list together: every slot holds one value per lane, `!{...}` postfix code is applied to whole
+ * lane columns at a time, and loops keep a lane mask so lanes whose counters run out early simply sit
+ * idle until the last lane leaves the loop. Blocks are independent and run on the thread pool.
+ *
+ * Every lane behaves exactly like a separate `turingcomplete program.af` run with the parameter's first
+ * top-level assignment replaced by `!{value} => name`; lanes that hit a runtime error stop with the same
+ * "Runtime Error: ..." line while the rest of their block carries on.
+ */
+namespace tcomp::vm {
+    /// One `--sweep name=values` argument; values are comma separated integers or inclusive `a..b` ranges
+    struct Sweep {
+        std::string name;
+        std::vector<std::int64_t> values;
+    };
+
+    /// Parses a `--sweep` argument. Throws std::invalid_argument on malformed input.
+    [[nodiscard]] Sweep parse_sweep(const std::string &spec);
+
+    struct LaneResult {
+        std::string output;
+        bool ok = true;
+    };
+
+    /**
+     * @class LaneMachine
+     * @brief Runs up to BLOCK_SIZE lanes of a Program in lockstep.
+     *
+     * Slots are stored column-wise (one vector per slot, one element per lane) so each instruction is a
+     * tight loop over lanes the compiler can vectorise. Lanes whose state does not fit the fast path
+     * (undefined or array operands of an expression, expressions exprtk has to evaluate) drop to an
+     * exact per-lane emulation of the tree walker for that instruction only.
+     */
+    class LaneMachine {
+    public:
+        static constexpr std::size_t BLOCK_SIZE = 64;
+
+        /// `parameters[p][lane]` is the value of program.parameters[p] in that lane
+        LaneMachine(const Program &program, std::size_t lanes, std::vector<std::vector<std::int64_t>> parameters);
+
+        [[nodiscard]] std::vector<LaneResult> run();
+
+        /// Writes a single-lane machine's output to `out` as it is produced, leaving LaneResult::output empty
+        void S_output(std::ostream &out);
+
+        /// A lane's defined names after run(): variables as their bits, arrays as `[bits,bits,...]`
+        [[nodiscard]] std::map<std::string, std::string> symbols(std::size_t lane) const;
+
+    private:
+        enum class Kind : std::uint8_t { Undefined, Variable, Array };
+
+        struct SlotColumn {
+            std::vector<Kind> kind;
+            std::vector<Value> value;
+            std::vector<double> number;  // program.number(value), what a `!{...}` reads
+            std::vector<std::vector<Value>> array;
+        };
+
+        void set(std::int32_t slot, std::size_t lane, const Value &value);
+        void kill(std::size_t lane, const std::string &message);
+        void flush(std::size_t lane);
+
+        void literal(const Instr &instr);
+        void param(const Instr &instr);
+        void eval(const Instr &instr);
+        void array(const Instr &instr);
+        void output(const Instr &instr);
+        void copy(const Instr &instr);
+        void loop_enter(const Instr &instr);
+        bool loop_head(const Instr &instr);
+
+        [[nodiscard]] double evaluate_slow(const Expression &expression, std::size_t lane);
+        void store(std::int32_t slot, std::size_t lane, double value);
+
+        const Program &program;
+        std::vector<std::vector<std::int64_t>> parameters;
+        std::size_t lanes;
+
+        std::vector<SlotColumn> columns;
+        std::vector<std::uint8_t> alive;
+        std::vector<std::uint8_t> active;
+        std::vector<std::vector<std::uint8_t>> mask_stack;  // active masks of the enclosing loops, mask_depth deep
+        std::size_t mask_depth = 0;
+        std::vector<LaneResult> results;
+        std::ostream *out = nullptr;
+
+        // scratch space for the column-wise expression evaluator
+        std::vector<std::vector<double>> stack;
+    };
+
+    /// Runs `options.input` once per lane described by `options.sweeps`, printing each lane's output in order
+    int run_sweep(const Options &options, std::ostream &out);
+}
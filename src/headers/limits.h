@@ -0,0 +1,158 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+/**
+ * Resource limits for `--max-steps`, `--timeout` and `--max-memory`.
+ *
+ * A step is one loop iteration: the interpreter charges the budget at every loop back-edge, on whichever
+ * thread runs the iteration, so a program without loops always finishes on its own. Each analyser takes its
+ * steps from the shared budget in batches (Allowance), so worker threads do not contend for it at every
+ * iteration. The wall-clock deadline
+ * is enforced by a watchdog thread that only raises a flag; the next back-edge sees it and unwinds the run
+ * with LimitExceeded, so nothing is killed halfway through a statement. Memory is charged by the statements
+ * that store variables and arrays, and the first statement that takes a run over its cap fails with it.
+ */
+namespace tcomp::limits {
+    /// Exit code of a run stopped by --max-steps, --timeout or --max-memory (the code coreutils `timeout` uses)
+    constexpr int EXIT_LIMIT_EXCEEDED = 124;
+
+    enum class Reason { Steps, Timeout, Memory };
+
+    class LimitExceeded : public std::runtime_error {
+    public:
+        LimitExceeded(Reason reason, const std::string &message, int line = 0, int column = 0)
+            : std::runtime_error(message), reason(reason), line(line), column(column) {}
+
+        [[nodiscard]] Reason G_reason() const { return this->reason; }
+        /// Where the statement that went over the limit starts; 0:0 for limits checked at loop back-edges
+        [[nodiscard]] int G_line() const { return this->line; }
+        [[nodiscard]] int G_column() const { return this->column; }
+
+    private:
+        Reason reason;
+        int line;
+        int column;
+    };
+
+    /**
+     * @class MemoryArena
+     * @brief Accounts for the bytes a run's variables and arrays occupy, against a cap.
+     *
+     * Every analyser of a run (the workers included) charges what its own symbol table holds and releases it
+     * again when the table shrinks or the analyser is destroyed, so the total is what the run holds right now.
+     */
+    class MemoryArena {
+    public:
+        /// `max_bytes` of 0 means no cap, only accounting; caps beyond INT64_MAX bytes are taken as INT64_MAX
+        explicit MemoryArena(std::uint64_t max_bytes);
+
+        /// Adds `bytes` (negative to release); returns false when the run is now over its cap
+        bool charge(std::int64_t bytes) {
+            const std::int64_t used = this->used.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+            if (bytes > 0) {
+                std::int64_t peak = this->peak.load(std::memory_order_relaxed);
+                while (used > peak && !this->peak.compare_exchange_weak(peak, used, std::memory_order_relaxed)) {}
+            }
+            return this->max_bytes == 0 || used <= static_cast<std::int64_t>(this->max_bytes);
+        }
+
+        [[nodiscard]] std::uint64_t G_max_bytes() const { return this->max_bytes; }
+        [[nodiscard]] std::uint64_t G_peak_bytes() const { return static_cast<std::uint64_t>(this->peak.load(std::memory_order_relaxed)); }
+
+    private:
+        const std::uint64_t max_bytes;
+        std::atomic<std::int64_t> used{0};
+        std::atomic<std::int64_t> peak{0};
+    };
+
+    /**
+     * Parses a `--max-memory` size: bytes, or a number with a K, M or G suffix (powers of 1024). Throws
+     * std::invalid_argument for anything else, including NaN and sizes above INT64_MAX bytes.
+     */
+    [[nodiscard]] std::uint64_t parse_size(const std::string &text);
+
+    /**
+     * @class Budget
+     * @brief The steps and time one run may use, shared by every analyser working on that run.
+     */
+    class Budget {
+    public:
+        /// Steps an Allowance takes from the budget at a time
+        static constexpr std::int64_t CLAIM = 1024;
+
+        /// `max_steps` of 0 and `timeout_seconds` of 0 mean no limit; the deadline counts from construction
+        Budget(std::uint64_t max_steps, double timeout_seconds);
+        ~Budget();
+
+        Budget(const Budget &) = delete;
+        Budget &operator=(const Budget &) = delete;
+
+        /// Throws LimitExceeded once the deadline has passed
+        void check_deadline() const {
+            if (this->expired.load(std::memory_order_relaxed)) [[unlikely]] {
+                this->fail(Reason::Timeout);
+            }
+        }
+
+        /// Takes up to `wanted` steps, fewer when fewer are left; throws LimitExceeded when none are
+        std::int64_t claim(std::int64_t wanted);
+
+        /// Returns steps that were claimed and not used
+        void give_back(std::int64_t steps) {
+            this->remaining.fetch_add(steps, std::memory_order_relaxed);
+        }
+
+        /// Loop iterations that were allowed to run, counting steps still held by an Allowance
+        [[nodiscard]] std::uint64_t G_steps() const;
+
+    private:
+        [[noreturn]] void fail(Reason reason) const;
+
+        const std::int64_t initial;
+        std::atomic<std::int64_t> remaining;
+        const double timeout_seconds;
+        std::atomic<bool> expired{false};
+
+        std::mutex mutex;
+        std::condition_variable cancelled;
+        bool finished = false;
+        std::thread watchdog;
+    };
+
+    /**
+     * @class Allowance
+     * @brief The steps one analyser has claimed from a Budget and not used yet.
+     *
+     * step() only touches the shared counter once every Budget::CLAIM iterations. Unused steps go back with
+     * release(), which an analyser calls before handing work to other analysers and when it is destroyed, so
+     * a sequential run stops after exactly the allowed number of iterations. Analysers running at the same
+     * time may each hold up to Budget::CLAIM steps, so a parallel run can stop that much earlier per worker.
+     */
+    class Allowance {
+    public:
+        /// Charges one loop iteration; throws LimitExceeded once the steps are used up or the deadline has passed
+        void step(Budget &budget) {
+            budget.check_deadline();
+            if (this->left == 0) [[unlikely]] {
+                this->left = budget.claim(Budget::CLAIM);
+            }
+            --this->left;
+        }
+
+        void release(Budget &budget) {
+            budget.give_back(this->left);
+            this->left = 0;
+        }
+
+    private:
+        std::int64_t left = 0;
+    };
+}
@@ -34,6 +34,9 @@ namespace parser_constants {
     inline constexpr char TOKEN_RIGHT_BRACE[] = "}";
     inline constexpr char TOKEN_DOLLAR[] = "$";
     inline constexpr char TOKEN_LEFT_SHIFT_AT[] = "<<@";
+
+    /// Reductions a parallel loop `(:n | sum total ${ ... })` may declare
+    inline const std::unordered_set<std::string> REDUCTION_OPERATORS = {"sum", "product", "min", "max", "xor"};
 }
 
 class Parser {
@@ -105,9 +108,11 @@ public:
     void parse_variable(int &pos);
     void parse_array(int &pos);
     void parse_loop(int &pos);
+    void parse_reductions(int &pos, std::vector<std::pair<std::string, std::string>> &reductions);
     void parse_collection(int &pos);
     void parse_out(int &pos, bool output_as_normal);
     void parse_expression(int &pos);
+    void unexpected_token(int &pos);
 
     void parse();
 
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <iosfwd>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace tcomp {
+    struct Options;
+    struct CompiledScript;
+}
+
+namespace tcomp::vm {
+    struct Program;
+}
+
+namespace tcomp::ir {
+    class Function;
+}
+
+/**
+ * Optimisation passes over the IR (tcomp::ir::Function) and the `-O` levels that choose them.
+ *
+ * -O0 runs nothing, so lowering reproduces the compiled program. -O1 folds constants (arithmetic on known
+ * values, expressions whose inputs are known, loops that cannot run) and deletes instructions whose results
+ * are never used. -O2 adds loop-invariant code motion, which computes `!{...}` whose inputs a loop does not
+ * change once before the loop. -O3 replaces counting and accumulation loops with a known trip count by the
+ * values they leave behind, and computes loops whose names are linear combinations of each other (a
+ * Fibonacci step) with a logarithmic number of matrix products.
+ */
+namespace tcomp::ir {
+    constexpr int MAX_LEVEL = 3;
+
+    /**
+     * @class Pass
+     * @brief One rewrite of a Function, which must leave every observable behaviour exactly as it was.
+     */
+    class Pass {
+    public:
+        virtual ~Pass() = default;
+
+        [[nodiscard]] virtual const char *name() const = 0;
+
+        /// Rewrites `function`; returns whether anything changed
+        virtual bool run(Function &function) = 0;
+    };
+
+    /**
+     * @class PassManager
+     * @brief The pipeline of an `-O` level, run over a Function until it stops changing.
+     */
+    class PassManager {
+    public:
+        /// Rounds of the whole pipeline before giving up on reaching a fixed point
+        static constexpr int MAX_ROUNDS = 8;
+
+        explicit PassManager(int level);
+
+        void add(std::unique_ptr<Pass> pass);
+
+        void run(Function &function) const;
+
+        [[nodiscard]] const std::vector<std::unique_ptr<Pass>> &G_passes() const { return this->passes; }
+
+    private:
+        std::vector<std::unique_ptr<Pass>> passes;
+    };
+
+    [[nodiscard]] std::unique_ptr<Pass> constant_folding();
+    [[nodiscard]] std::unique_ptr<Pass> loop_invariant_code_motion();
+    [[nodiscard]] std::unique_ptr<Pass> closed_form_loops();
+    [[nodiscard]] std::unique_ptr<Pass> linear_recurrences();
+    [[nodiscard]] std::unique_ptr<Pass> dead_code_elimination();
+
+    /// Builds, optimises at `level` and lowers `program`; a program the IR cannot represent is returned as it is
+    [[nodiscard]] vm::Program optimize(const vm::Program &program, int level);
+
+    /**
+     * Runs a script optimised at `level` on the compiled engine, writing its output to `out` as it is produced,
+     * and returns the exit code; a runtime error is reported as the tree walker reports it and exits with 1.
+     * Returns nothing, having run nothing, for programs the compiler does not take, which the tree walker runs instead.
+     */
+    [[nodiscard]] std::optional<int> run(const CompiledScript &script, int level, std::ostream &out);
+
+    /// `--dump-ir program.af`: prints the IR of the program after the passes of `options.opt_level`
+    int dump(const Options &options, std::ostream &out);
+}
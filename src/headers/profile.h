@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class AST;
+
+/**
+ * Statement-level profiling for `--profile`.
+ *
+ * The interpreter reports every statement it starts and finishes; the profiler keeps a tree of the statement
+ * paths seen (a loop and the statements of its body form one path each), with a run count and inclusive and
+ * exclusive time per path, and with allocation tracking built in (tcomp::stats) the heap allocations each
+ * path made on the profiled thread. The hot-spot table folds the paths back onto statements, the collapsed-stack
+ * output (`frame;frame;frame <ns>`) feeds flamegraph.pl, speedscope and similar tools directly.
+ */
+namespace tcomp::profile {
+    struct Entry {
+        AST *node = nullptr;   // nullptr for the root
+        std::size_t parent = 0;
+        std::uint64_t count = 0;
+        std::uint64_t inclusive_ns = 0;
+        std::uint64_t exclusive_ns = 0;
+        std::uint64_t inclusive_allocations = 0;
+        std::uint64_t exclusive_allocations = 0;
+        std::unordered_map<AST *, std::size_t> children;
+    };
+
+    /**
+     * @class Profiler
+     * @brief Collects per-statement counts and times from a single interpreter thread.
+     */
+    class Profiler {
+    public:
+        Profiler();
+
+        void enter(AST *node);
+        void leave();
+
+        /// The `limit` statements with the most exclusive time, hottest first
+        void write_hotspots(std::ostream &out, std::size_t limit = 25) const;
+
+        /// One `root;outer;inner <exclusive ns>` line per statement path
+        void write_collapsed(std::ostream &out, const std::string &root) const;
+
+    private:
+        struct Frame {
+            std::size_t entry;
+            std::chrono::steady_clock::time_point start;
+            std::uint64_t children_ns;
+            std::uint64_t allocations_start;
+            std::uint64_t children_allocations;
+        };
+
+        std::vector<Entry> entries;
+        std::vector<Frame> stack;
+    };
+
+    /**
+     * @brief Reports one statement to a profiler for as long as it is in scope.
+     *
+     * A null profiler makes this a no-op, so the interpreter can keep the guard on its hot path.
+     */
+    class Scope {
+    public:
+        Scope(Profiler *profiler, AST *node) : profiler(profiler) {
+            if (profiler) profiler->enter(node);
+        }
+        ~Scope() {
+            if (profiler) profiler->leave();
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        Profiler *profiler;
+    };
+
+    /// A short source-like spelling of a statement, e.g. `!{i + 1} => i` or `(:n ${...})`
+    [[nodiscard]] std::string describe(AST *node);
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <vector>
+
+class AST;
+class ProgramNode;
+
+/**
+ * SIGPROF sampling for `--sample`.
+ *
+ * The interpreter publishes the statement it is running and the loops it is inside with plain relaxed stores;
+ * a setitimer(ITIMER_PROF) signal handler reads them and bumps preallocated counters. Nothing on either side
+ * allocates or locks, so the handler is async-signal-safe and the interpreter pays one store per statement.
+ */
+namespace tcomp::sampling {
+    /// Loops nested deeper than this are still counted towards their enclosing loops, but not themselves
+    constexpr std::size_t MAX_LOOP_DEPTH = 64;
+
+    struct Published {
+        std::atomic<AST *> statement{nullptr};
+        std::atomic<std::uint32_t> depth{0};
+        std::atomic<AST *> loops[MAX_LOOP_DEPTH] = {};
+    };
+
+    /// Written by the interpreter thread, read by the signal handler
+    extern Published published;
+
+    inline void publish_statement(AST *node) {
+        published.statement.store(node, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Marks a loop as running for as long as it is in scope; a no-op when `enabled` is false.
+     */
+    class LoopScope {
+    public:
+        LoopScope(bool enabled, AST *loop) : enabled(enabled) {
+            if (!enabled) return;
+            const std::uint32_t depth = published.depth.load(std::memory_order_relaxed);
+            if (depth < MAX_LOOP_DEPTH) {
+                published.loops[depth].store(loop, std::memory_order_relaxed);
+            }
+            // the slot must be visible before a handler can see the deeper depth
+            std::atomic_signal_fence(std::memory_order_release);
+            published.depth.store(depth + 1, std::memory_order_relaxed);
+        }
+        ~LoopScope() {
+            if (enabled) {
+                published.depth.store(published.depth.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+            }
+        }
+
+        LoopScope(const LoopScope &) = delete;
+        LoopScope &operator=(const LoopScope &) = delete;
+
+    private:
+        bool enabled;
+    };
+
+    /**
+     * @class Sampler
+     * @brief Owns the SIGPROF timer and the sample counters for one program.
+     *
+     * Only one sampler can run at a time. Counters exist for every statement of the program up front, so the
+     * handler only has to find the published statement in a sorted table.
+     */
+    class Sampler {
+    public:
+        Sampler(const std::shared_ptr<ProgramNode> &program, unsigned frequency);
+        ~Sampler();
+
+        Sampler(const Sampler &) = delete;
+        Sampler &operator=(const Sampler &) = delete;
+
+        /// Installs the handler and starts the timer; false (and nothing installed) if the platform refuses
+        bool start();
+        void stop();
+
+        /// Per-line and per-loop sample histograms
+        void write_report(std::ostream &out) const;
+
+        /// Called from the signal handler
+        void record() noexcept;
+
+    private:
+        [[nodiscard]] std::ptrdiff_t find(const AST *node) const noexcept;
+
+        unsigned frequency;
+        bool running = false;
+
+        std::vector<AST *> statements;                     // sorted by address
+        std::unique_ptr<std::atomic<std::uint64_t>[]> hits;       // samples whose current statement is statements[i]
+        std::unique_ptr<std::atomic<std::uint64_t>[]> loop_hits;  // samples taken anywhere inside loop statements[i]
+        std::atomic<std::uint64_t> total{0};
+        std::atomic<std::uint64_t> outside{0};             // samples taken before the first statement ran
+    };
+}
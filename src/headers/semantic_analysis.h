@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include "limits.h"
+
 struct Variable {
     std::string name;
     tc_Bitset bitset;
@@ -26,11 +28,32 @@ struct Collection {
 
 using SymbolInfo = std::variant<Variable, Array, Collection>;
 
+namespace tcomp {
+    class ThreadPool;
+}
+
+namespace tcomp::profile {
+    class Profiler;
+}
+
+namespace tcomp::trace {
+    class Tracer;
+}
+
+namespace tcomp::jit {
+    class Cache;
+    class Loop;
+}
+
 namespace sem_analysis {
     [[nodiscard]] char binary_to_char(const std::string &binary);
     [[nodiscard]] int64_t binary_to_int64_t(const std::string &binary, bool is_signed = false);
     [[nodiscard]] std::string int_to_binary(int64_t value);
 
+    /// Evaluates an `!{...}` expression whose variables have already been substituted, exactly as the interpreter does
+    /// (exprtk over doubles; an expression that fails to compile yields NaN)
+    [[nodiscard]] double evaluate_expression(const std::string &expression);
+
     class SemanticAnalyser {
     public:
         explicit SemanticAnalyser(std::shared_ptr<ProgramNode> program, std::string filename = "");
@@ -40,12 +63,87 @@ namespace sem_analysis {
 
         void analyze();
 
+        // #[Getters<Def>]
+        [[nodiscard]] const std::unordered_map<std::string, SymbolInfo> &G_symbol_table() const;
+
+        // #[Setters<Def>]
+        /// Redirect program output (defaults to std::cout), used by the daemon to capture a run's stdout
+        void S_output(std::ostream &out);
+        /// Worker threads independent top-level statements and loop iterations may be spread over;
+        /// 1 (the default) runs everything in order
+        void S_jobs(unsigned jobs);
+        /// Reports every statement this analyser runs to `profiler`; statements run by worker threads are not reported
+        void S_profiler(tcomp::profile::Profiler *profiler);
+        /// Publishes the running statement and loop stack for tcomp::sampling::Sampler; worker threads never publish
+        void S_sampling(bool sampling);
+        /// Records loops, sampled iterations and worker activity (on every thread) as trace spans
+        void S_tracer(tcomp::trace::Tracer *tracer);
+        /// Charges every loop iteration (on every thread) to `budget`, which stops the run with
+        /// tcomp::limits::LimitExceeded once its steps or time are used up
+        void S_budget(tcomp::limits::Budget *budget);
+        /// Charges the variables and arrays this analyser holds to `arena`; a statement that takes the run over
+        /// the arena's cap fails with tcomp::limits::LimitExceeded
+        void S_arena(tcomp::limits::MemoryArena *arena);
+        /// Promotes hot loops whose bodies only compute numbers to native code from `jit` (tcomp::jit), when
+        /// nothing observes or limits the run; nullptr (the default) interprets every loop
+        void S_jit(tcomp::jit::Cache *jit);
+
     protected:
         std::unordered_map<std::string, SymbolInfo> symbol_table;
 
+        /// Executes a list of statements against this analyser's symbol table.
+        /// Loop bodies run through here directly so the (possibly shared) AST is never mutated during execution.
+        void execute(const std::vector<std::shared_ptr<AST>> &nodes);
+
     private:
+        /// Runs independent regions of `nodes` (see sem_analysis::build_regions) concurrently, each against a private
+        /// copy of the symbols it touches, and prints their output in program order. Returns false without running
+        /// anything when there is no pair of independent loops to overlap.
+        bool execute_parallel(const std::vector<std::shared_ptr<AST>> &nodes);
+
+        /// Splits the iterations of `loop` into chunks run on worker analysers when sem_analysis::plan_parallel_loop
+        /// finds them independent. Returns false without running anything otherwise.
+        bool execute_parallel_loop(const std::shared_ptr<AST> &loop, const std::string &counter, int64_t iteration_count);
+
+        /// Runs a declared parallel loop `(:n | sum total ${ ... })`: every iteration starts from the symbols as
+        /// they were when the loop started, reductions are combined and array appends concatenated in iteration
+        /// order, and other names keep the last iteration's value. The result does not depend on `jobs`.
+        void execute_declared_parallel_loop(const std::shared_ptr<AST> &loop, const std::string &counter, int64_t iteration_count);
+
+        /// Runs a loop as its native code from the jit cache, from the loop head on (at entry or at a back-edge),
+        /// and writes the values it assigned back to the symbol table. Returns false without running anything when
+        /// the values the loop reads are not plain numbers.
+        bool execute_native_loop(const tcomp::jit::Loop &native);
+
+        /// The analyser's worker pool, started on first use
+        tcomp::ThreadPool &workers();
+
+        /// Charges `bytes` more (or fewer) to the arena, failing at `node` when the run goes over its cap
+        void account(std::int64_t bytes, const AST *node);
+        /// Recomputes what the whole symbol table holds, after parallel work merged results into it
+        void recount(const AST *node);
+
         std::shared_ptr<ProgramNode> program_;
         ErrorPack error_pack;
         std::string filename;
+        std::ostream *out = &std::cout;
+        unsigned jobs = 1;
+        std::unique_ptr<tcomp::ThreadPool> pool;
+        tcomp::profile::Profiler *profiler = nullptr;
+        bool sampling = false;
+        tcomp::trace::Tracer *tracer = nullptr;
+        tcomp::limits::Budget *budget = nullptr;
+        tcomp::limits::Allowance allowance;  // steps claimed from `budget`
+        tcomp::limits::MemoryArena *arena = nullptr;
+        tcomp::jit::Cache *jit = nullptr;
+        std::int64_t held_bytes = 0;  // what this analyser has charged to the arena
+
+        // set on loop workers: reduction statements (by node) whose inputs are recorded instead of executed
+        std::unordered_map<const AST *, std::size_t> deferred;
+        std::vector<std::pair<std::size_t, std::vector<int64_t>>> deferred_inputs;
+
+        // --stats counts, published to tcomp::stats::counters() when the analyser is destroyed
+        std::uint64_t executed_statements = 0;
+        std::uint64_t executed_iterations = 0;
     };
 }
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+class AST;
+
+/**
+ * Run statistics for `--stats`.
+ *
+ * Counters are process-wide and updated with relaxed atomics, so executors on any thread can contribute;
+ * the interpreter batches its per-statement counts and publishes them once per analyser. Allocation counts
+ * come from the replaceable global operator new defined in stats.cpp, which is only compiled in when the
+ * build defines TURINGCOMPLETE_ALLOCATION_TRACKING (the CMake option of the same name, off by default);
+ * without it every allocation count reads 0. Hardware counters (`--stats=hw`) are
+ * optional and only reported where perf_event_open works.
+ */
+namespace tcomp::stats {
+    struct Counters {
+        std::atomic<std::uint64_t> statements{0};
+        std::atomic<std::uint64_t> loop_iterations{0};
+        std::atomic<std::uint64_t> expression_compilations{0};
+        std::atomic<std::uint64_t> native_loops{0};       // loops translated to machine code by tcomp::jit
+        std::atomic<std::uint64_t> loop_replacements{0};  // interpreted loops that switched tiers at a back-edge
+        std::atomic<std::uint64_t> allocations{0};
+        std::atomic<std::uint64_t> allocated_bytes{0};
+    };
+
+    [[nodiscard]] Counters &counters();
+
+    /// Allocations made by the calling thread so far, for attributing them to whatever that thread is running
+    [[nodiscard]] std::uint64_t thread_allocations();
+
+    /// Whether this build counts allocations at all
+    [[nodiscard]] constexpr bool tracks_allocations() {
+#if defined(TURINGCOMPLETE_ALLOCATION_TRACKING)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /// CPU time consumed by every thread of the process so far
+    [[nodiscard]] double cpu_seconds();
+
+    /// Peak resident set size of the process, 0 where the platform does not report it
+    [[nodiscard]] std::uint64_t peak_rss_bytes();
+
+    /// Number of nodes in the tree rooted at `node`, the root included
+    [[nodiscard]] std::size_t count_nodes(const std::shared_ptr<AST> &node);
+
+    /**
+     * @class HardwareCounters
+     * @brief CPU performance counters for the process, read with Linux perf_event_open.
+     *
+     * Cycles, instructions, branch misses and cache misses are counted in user space for the calling thread
+     * and every thread it starts afterwards; a worker's counts are folded in when it exits, which for the
+     * interpreter is when its analyser is destroyed. Counters the kernel or the hardware refuses are left
+     * out, and on other platforms nothing can be opened.
+     */
+    class HardwareCounters {
+    public:
+        HardwareCounters() = default;
+        ~HardwareCounters();
+        HardwareCounters(const HardwareCounters &) = delete;
+        HardwareCounters &operator=(const HardwareCounters &) = delete;
+
+        /// Opens and starts the counters; returns why none could be opened, or an empty string
+        std::string open();
+
+        [[nodiscard]] bool available() const;
+
+        /// The value of every open counter, scaled up when the kernel had to multiplex them
+        [[nodiscard]] std::vector<std::pair<std::string, std::uint64_t>> read() const;
+
+    private:
+        struct Event {
+            std::string name;
+            int fd = -1;
+        };
+
+        std::vector<Event> events;
+    };
+
+    struct Phase {
+        std::string name;
+        double wall_seconds = 0;
+        double cpu_seconds = 0;
+        std::uint64_t allocations = 0;
+        std::uint64_t allocated_bytes = 0;
+        std::vector<std::pair<std::string, std::uint64_t>> hardware;  // empty unless hardware counters are on
+    };
+
+    /**
+     * @class Report
+     * @brief Phase timings plus named totals, printed as a table or as JSON.
+     *
+     * Phases are timed with begin_phase/end_phase; the process-wide counters and peak RSS are read when the
+     * report is written.
+     */
+    class Report {
+    public:
+        /// Adds hardware counters to every phase started afterwards; when they cannot be opened the report says why
+        void enable_hardware_counters();
+
+        void begin_phase(std::string name);
+        void end_phase();
+
+        /// Records a named total such as the token count
+        void set(const std::string &name, std::uint64_t value);
+
+        void write_text(std::ostream &out) const;
+        void write_json(std::ostream &out) const;
+
+        [[nodiscard]] const std::vector<Phase> &G_phases() const;
+
+    private:
+        [[nodiscard]] std::vector<std::pair<std::string, std::uint64_t>> totals() const;
+
+        std::vector<Phase> phases;
+        std::vector<std::pair<std::string, std::uint64_t>> values;
+
+        std::chrono::steady_clock::time_point phase_wall_start;
+        double phase_cpu_start = 0;
+        std::uint64_t phase_allocations_start = 0;
+        std::uint64_t phase_bytes_start = 0;
+
+        HardwareCounters hardware;
+        bool hardware_requested = false;
+        std::string hardware_error;
+        std::vector<std::pair<std::string, std::uint64_t>> phase_hardware_start;
+    };
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tcomp {
+    /**
+     * @class ThreadPool
+     * @brief A work-stealing pool sized to the machine's core count.
+     *
+     * Every worker owns a deque. Tasks submitted from inside a worker go to the back of its own deque and are
+     * taken LIFO (the data they touch is still warm); tasks submitted from outside are dealt round-robin.
+     * A worker whose deque runs dry steals from the front of its siblings' deques, so a few long scripts
+     * cannot leave the remaining cores idle.
+     *
+     * Tasks must not throw; anything a task needs to report has to be captured by the task itself.
+     * Destroying the pool finishes every task that was already submitted.
+     */
+    class ThreadPool {
+    public:
+        explicit ThreadPool(unsigned workers = std::thread::hardware_concurrency());
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        void submit(std::function<void()> task);
+
+        /// Blocks until every submitted task has finished
+        void wait();
+
+        [[nodiscard]] unsigned G_size() const;
+
+    private:
+        struct WorkQueue {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        void worker_loop(std::size_t index);
+        bool take(std::size_t index, std::function<void()> &task);
+
+        std::vector<std::unique_ptr<WorkQueue>> queues;
+        std::vector<std::thread> workers;
+        std::atomic<std::size_t> next_queue{0};
+
+        // sleeping and completion bookkeeping; the counters are signed because a task may be taken
+        // before the submitter has finished accounting for it
+        std::mutex mutex;
+        std::condition_variable task_available;
+        std::condition_variable all_done;
+        std::ptrdiff_t queued = 0;
+        std::ptrdiff_t in_flight = 0;
+        bool stopping = false;
+    };
+}
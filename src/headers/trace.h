@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Chrome trace-event output for `--trace <file>`.
+ *
+ * Spans become complete ("X") events in the JSON object format, which chrome://tracing, Perfetto and
+ * speedscope all open. Every thread that records a span gets its own track; worker threads are named after
+ * the order in which they first traced something.
+ */
+namespace tcomp::trace {
+    struct Event {
+        std::string name;
+        const char *category;
+        std::int64_t start_us;
+        std::int64_t duration_us;
+        std::uint32_t thread;
+        std::string args;  // a JSON object body, e.g. "\"iteration\":3", or empty
+    };
+
+    /**
+     * @class Tracer
+     * @brief Collects events from any thread; written out once the run is over.
+     */
+    class Tracer {
+    public:
+        /// Records every `iteration_interval`-th loop iteration as its own span; 0 records none
+        explicit Tracer(std::uint64_t iteration_interval = 0);
+
+        [[nodiscard]] std::chrono::steady_clock::time_point now() const { return std::chrono::steady_clock::now(); }
+        [[nodiscard]] bool trace_iteration(std::uint64_t iteration) const {
+            return this->iteration_interval != 0 && iteration % this->iteration_interval == 0;
+        }
+
+        void record(std::string name, const char *category, std::chrono::steady_clock::time_point start, std::string args = "");
+
+        void write(std::ostream &out) const;
+
+    private:
+        std::chrono::steady_clock::time_point origin;
+        std::uint64_t iteration_interval;
+
+        mutable std::mutex mutex;
+        std::vector<Event> events;
+        std::vector<std::string> thread_names;
+    };
+
+    /**
+     * @brief Records a span covering its own lifetime; a no-op for a null tracer.
+     */
+    class Span {
+    public:
+        Span(Tracer *tracer, std::string name, const char *category, std::string args = "")
+            : tracer(tracer) {
+            if (tracer) {
+                this->name = std::move(name);
+                this->category = category;
+                this->args = std::move(args);
+                this->start = tracer->now();
+            }
+        }
+        ~Span() {
+            if (tracer) tracer->record(std::move(this->name), this->category, this->start, std::move(this->args));
+        }
+
+        Span(const Span &) = delete;
+        Span &operator=(const Span &) = delete;
+
+    private:
+        Tracer *tracer;
+        std::string name;
+        const char *category = "";
+        std::string args;
+        std::chrono::steady_clock::time_point start;
+    };
+}
@@ -0,0 +1,751 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <limits>
+
+#include "headers/bytecode.h"
+#include "headers/ir.h"
+
+tcomp::ir::Function::Function(std::shared_ptr<const vm::Program> source) : source(std::move(source)) {
+    this->blocks.emplace_back();
+}
+
+tcomp::ir::ValueId tcomp::ir::Function::add(Instr instr) {
+    this->values.push_back(std::move(instr));
+    return static_cast<ValueId>(this->values.size() - 1);
+}
+
+void tcomp::ir::Function::replace_uses(ValueId from, ValueId to) {
+    for (Instr &instr : this->values) {
+        std::ranges::replace(instr.operands, from, to);
+    }
+    for (Block &block : this->blocks) {
+        std::ranges::replace(block.yields, from, to);
+    }
+    std::ranges::replace(this->exits, from, to);
+}
+
+bool tcomp::ir::Function::defined(ValueId value) const {
+    const Instr &instr = this->values[value];
+    switch (instr.op) {
+        case Opcode::Undefined:
+            return false;
+        case Opcode::Phi: {
+            const Instr &loop = this->values[this->blocks[instr.body].loop];
+            // the loop head has just assigned the counter; anything else may still be what it was on entry
+            return instr.index == loop.index || this->defined(loop.operands[instr.index]);
+        }
+        case Opcode::Exit: {
+            const Instr &loop = this->values[instr.operands[0]];
+            // entering a loop over an undefined counter is a runtime error, so nothing after it runs
+            return instr.index == loop.index || this->defined(loop.operands[instr.index]);
+        }
+        default:
+            return true;
+    }
+}
+
+bool tcomp::ir::pure(Opcode op) {
+    // Evaluate may fail at run time (exprtk, or an array operand), which stops the program
+    return op != Opcode::Evaluate && op != Opcode::Print && op != Opcode::Loop;
+}
+
+const char *tcomp::ir::name(Opcode op) {
+    switch (op) {
+        case Opcode::Undefined: return "undefined";
+        case Opcode::Param:     return "param";
+        case Opcode::Produce:   return "produce";
+        case Opcode::Assign:    return "assign";
+        case Opcode::Define:    return "define";
+        case Opcode::Evaluate:  return "evaluate";
+        case Opcode::Phi:       return "phi";
+        case Opcode::Exit:      return "exit";
+        case Opcode::Append:    return "append";
+        case Opcode::Number:    return "number";
+        case Opcode::Constant:  return "constant";
+        case Opcode::Negate:    return "neg";
+        case Opcode::Add:       return "add";
+        case Opcode::Sub:       return "sub";
+        case Opcode::Mul:       return "mul";
+        case Opcode::Div:       return "div";
+        case Opcode::Mod:       return "mod";
+        case Opcode::Lt:        return "lt";
+        case Opcode::Le:        return "le";
+        case Opcode::Gt:        return "gt";
+        case Opcode::Ge:        return "ge";
+        case Opcode::Eq:        return "eq";
+        case Opcode::Ne:        return "ne";
+        case Opcode::And:       return "and";
+        case Opcode::Or:        return "or";
+        case Opcode::Truncate:  return "truncate";
+        case Opcode::Integer:   return "integer";
+        case Opcode::Print:     return "print";
+        case Opcode::Loop:      return "loop";
+    }
+    return "?";
+}
+
+namespace {
+    using tcomp::ir::Block;
+    using tcomp::ir::Function;
+    using tcomp::ir::Instr;
+    using tcomp::ir::NONE;
+    using tcomp::ir::Opcode;
+    using tcomp::ir::Type;
+    using tcomp::ir::ValueId;
+    using tcomp::vm::ExprOp;
+    using tcomp::vm::Op;
+
+    constexpr std::pair<ExprOp, Opcode> BINARY[] = {
+        {ExprOp::Add, Opcode::Add}, {ExprOp::Sub, Opcode::Sub}, {ExprOp::Mul, Opcode::Mul}, {ExprOp::Div, Opcode::Div},
+        {ExprOp::Mod, Opcode::Mod}, {ExprOp::Lt, Opcode::Lt}, {ExprOp::Le, Opcode::Le}, {ExprOp::Gt, Opcode::Gt},
+        {ExprOp::Ge, Opcode::Ge}, {ExprOp::Eq, Opcode::Eq}, {ExprOp::Ne, Opcode::Ne}, {ExprOp::And, Opcode::And},
+        {ExprOp::Or, Opcode::Or}
+    };
+
+    Opcode opcode(ExprOp op) {
+        return std::ranges::find(BINARY, op, &std::pair<ExprOp, Opcode>::first)->second;
+    }
+
+    ExprOp expr_op(Opcode op) {
+        return std::ranges::find(BINARY, op, &std::pair<ExprOp, Opcode>::second)->first;
+    }
+
+    // #[Building]
+
+    class Builder {
+    public:
+        Builder(const tcomp::vm::Program &program, Function &function) : program(program), function(function) {}
+
+        void run() {
+            std::vector<bool> numbers(this->program.slots.size(), false);
+            this->arrays.assign(this->program.slots.size(), false);
+            for (const tcomp::vm::Instr &instr : this->program.code) {
+                switch (instr.op) {
+                    case Op::Array:
+                        this->arrays[instr.slot] = true;
+                        for (const std::int32_t source : this->program.array_sources[instr.operand]) numbers[source] = true;
+                        break;
+                    case Op::Eval:
+                        for (const std::int32_t slot : this->program.expressions[instr.operand].variables) numbers[slot] = true;
+                        numbers[instr.slot] = true;
+                        break;
+                    case Op::Output:
+                        break;
+                    default:
+                        numbers[instr.slot] = true;
+                        break;
+                }
+            }
+            for (std::size_t slot = 0; slot < numbers.size(); ++slot) {
+                if (numbers[slot] && this->arrays[slot]) {
+                    throw std::invalid_argument("`" + this->program.slots[slot] + "` is used both as a number and as an array");
+                }
+            }
+
+            for (std::size_t slot = 0; slot < this->program.slots.size(); ++slot) {
+                this->current.push_back(this->emit(0, Instr{
+                    .op = Opcode::Undefined, .type = this->arrays[slot] ? Type::Array : Type::State, .slot = static_cast<std::int32_t>(slot)
+                }));
+            }
+            this->walk(0, this->program.code.size(), 0);
+            this->function.exits = this->current;
+        }
+
+    private:
+        ValueId emit(std::int32_t block, Instr instr) {
+            const ValueId value = this->function.add(std::move(instr));
+            this->function.blocks[block].code.push_back(value);
+            return value;
+        }
+
+        /// The state of `slot` after printing or appending it, which defines it as 0
+        ValueId define(std::int32_t block, std::int32_t slot, const std::shared_ptr<AST> &origin) {
+            if (!this->function.defined(this->current[slot])) {
+                this->current[slot] = this->emit(block, Instr{
+                    .op = Opcode::Define, .type = Type::State, .operands = {this->current[slot]}, .slot = slot, .origin = origin
+                });
+            }
+            return this->current[slot];
+        }
+
+        /// Slots anything in [pc, end) may assign
+        std::vector<std::int32_t> assigned(std::size_t pc, std::size_t end) const {
+            std::vector<std::int32_t> slots;
+            for (; pc < end; ++pc) {
+                const tcomp::vm::Instr &instr = this->program.code[pc];
+                slots.push_back(instr.slot);
+                if (instr.op == Op::Array) {
+                    const auto &sources = this->program.array_sources[instr.operand];
+                    slots.insert(slots.end(), sources.begin(), sources.end());
+                }
+            }
+            std::ranges::sort(slots);
+            slots.erase(std::unique(slots.begin(), slots.end()), slots.end());
+            return slots;
+        }
+
+        void walk(std::size_t pc, std::size_t end, std::int32_t block) {
+            while (pc < end) {
+                const tcomp::vm::Instr &instr = this->program.code[pc];
+                const std::shared_ptr<AST> &origin = this->program.origins[pc];
+                const std::int32_t slot = instr.slot;
+
+                switch (instr.op) {
+                    case Op::Literal:
+                        this->current[slot] = this->emit(block, Instr{
+                            .op = Opcode::Assign, .type = Type::State, .operands = {this->current[slot]}, .slot = slot,
+                            .index = instr.operand, .origin = origin
+                        });
+                        break;
+                    case Op::Param:
+                        this->current[slot] = this->emit(block, Instr{
+                            .op = Opcode::Param, .type = Type::State, .slot = slot, .index = instr.operand, .origin = origin
+                        });
+                        break;
+                    case Op::Eval: {
+                        const tcomp::vm::Expression &expression = this->program.expressions[instr.operand];
+                        std::vector<ValueId> operands;
+                        for (const std::int32_t variable : expression.variables) operands.push_back(this->current[variable]);
+
+                        if (expression.native() && std::ranges::all_of(operands, [&](ValueId v) { return this->function.defined(v); })) {
+                            const ValueId number = tcomp::ir::expand(this->function, expression, operands, origin, this->function.blocks[block].code);
+                            const ValueId integer = this->emit(block, Instr{
+                                .op = Opcode::Truncate, .type = Type::Integer, .operands = {number}, .origin = origin
+                            });
+                            this->current[slot] = this->emit(block, Instr{
+                                .op = Opcode::Produce, .type = Type::State, .operands = {integer}, .slot = slot, .origin = origin
+                            });
+                        } else {
+                            this->current[slot] = this->emit(block, Instr{
+                                .op = Opcode::Evaluate, .type = Type::State, .operands = std::move(operands), .slot = slot,
+                                .index = instr.operand, .origin = origin
+                            });
+                        }
+                        break;
+                    }
+                    case Op::Output:
+                        if (this->arrays[slot] && !this->function.defined(this->current[slot])) {
+                            // the interpreter would print 0 and turn the name into a number
+                            throw std::invalid_argument("`" + this->program.slots[slot] + "` may be printed before it is an array");
+                        }
+                        this->emit(block, Instr{
+                            .op = Opcode::Print, .operands = {this->arrays[slot] ? this->current[slot] : this->define(block, slot, origin)},
+                            .as_number = instr.as_number, .origin = origin
+                        });
+                        break;
+                    case Op::Array: {
+                        std::vector<ValueId> operands = {this->current[slot]};
+                        for (const std::int32_t source : this->program.array_sources[instr.operand]) {
+                            operands.push_back(this->define(block, source, origin));
+                        }
+                        this->current[slot] = this->emit(block, Instr{
+                            .op = Opcode::Append, .type = Type::Array, .operands = std::move(operands), .slot = slot, .origin = origin
+                        });
+                        break;
+                    }
+                    case Op::LoopEnter: {
+                        const auto exit = static_cast<std::size_t>(instr.operand);
+                        const std::vector<std::int32_t> carried = this->assigned(pc, exit);
+
+                        Instr loop{.op = Opcode::Loop, .origin = origin};
+                        for (const std::int32_t name : carried) loop.operands.push_back(this->current[name]);
+                        loop.index = static_cast<std::int32_t>(std::ranges::find(carried, slot) - carried.begin());
+                        loop.body = static_cast<std::int32_t>(this->function.blocks.size());
+                        const ValueId id = this->emit(block, std::move(loop));
+                        this->function.blocks.emplace_back();
+                        this->function.blocks[this->function[id].body].loop = id;
+
+                        const std::int32_t body = this->function[id].body;
+                        for (std::size_t i = 0; i < carried.size(); ++i) {
+                            const ValueId phi = this->function.add(Instr{
+                                .op = Opcode::Phi, .type = this->arrays[carried[i]] ? Type::Array : Type::State, .slot = carried[i],
+                                .index = static_cast<std::int32_t>(i), .body = body
+                            });
+                            this->function.blocks[body].params.push_back(phi);
+                            this->current[carried[i]] = phi;
+                        }
+
+                        this->walk(pc + 2, exit - 1, body);
+
+                        for (std::size_t i = 0; i < carried.size(); ++i) {
+                            this->function.blocks[body].yields.push_back(this->current[carried[i]]);
+                            const ValueId result = this->function.add(Instr{
+                                .op = Opcode::Exit, .type = this->arrays[carried[i]] ? Type::Array : Type::State, .operands = {id},
+                                .slot = carried[i], .index = static_cast<std::int32_t>(i)
+                            });
+                            this->function[id].results.push_back(result);
+                            this->current[carried[i]] = result;
+                        }
+                        pc = exit;
+                        continue;
+                    }
+                    default:
+                        break;
+                }
+                ++pc;
+            }
+        }
+
+        const tcomp::vm::Program &program;
+        Function &function;
+        std::vector<bool> arrays;
+        std::vector<ValueId> current;  // the content of every slot at the point being built
+    };
+
+    // #[Lowering]
+
+    class Lowerer {
+    public:
+        explicit Lowerer(const Function &function) : function(function), source(function.G_source()) {
+            this->out.slots = this->source.slots;
+            this->out.literals = this->source.literals;
+            this->out.parameters = this->source.parameters;
+
+            this->location.assign(function.size(), -1);
+            this->position.assign(function.size(), 0);
+            this->last_use.assign(function.size(), -1);
+            this->block_of.assign(function.size(), 0);
+            this->parent.assign(function.blocks.size(), -1);
+            this->ends.assign(function.size(), 0);
+            this->body_end.assign(function.blocks.size(), 0);
+        }
+
+        tcomp::vm::Program run() {
+            this->number(0);
+            this->uses(0);
+            const std::int64_t end = ++this->clock;
+            for (const ValueId exit : this->function.exits) this->use(exit, 0, end);
+
+            this->occupant.assign(this->out.slots.size(), NONE);
+            this->lower(0);
+
+            std::vector<std::pair<std::int32_t, ValueId>> copies;
+            for (std::size_t slot = 0; slot < this->function.exits.size(); ++slot) {
+                copies.emplace_back(static_cast<std::int32_t>(slot), this->function.exits[slot]);
+            }
+            this->parallel_copy(copies);
+            return std::move(this->out);
+        }
+
+    private:
+        // #[Liveness] positions in execution order, loops running from their entry to after their body
+
+        void number(std::int32_t block) {
+            for (const ValueId value : this->function.blocks[block].code) {
+                this->position[value] = ++this->clock;
+                this->block_of[value] = block;
+                const Instr &instr = this->function[value];
+                if (instr.op == Opcode::Loop) {
+                    this->parent[instr.body] = block;
+                    for (const ValueId phi : this->function.blocks[instr.body].params) {
+                        this->block_of[phi] = instr.body;
+                        this->position[phi] = this->position[value];
+                    }
+                    this->number(instr.body);
+                    this->body_end[instr.body] = ++this->clock;
+                    this->ends[value] = ++this->clock;
+                    for (const ValueId result : instr.results) {
+                        this->block_of[result] = block;
+                        this->position[result] = this->ends[value];
+                    }
+                }
+            }
+        }
+
+        [[nodiscard]] bool contains(std::int32_t outer, std::int32_t block) const {
+            for (; block != -1; block = this->parent[block]) {
+                if (block == outer) return true;
+            }
+            return false;
+        }
+
+        /// Records that `value` is needed at `at` in `block`; a value from outside a loop is needed until the loop ends
+        void use(ValueId value, std::int32_t block, std::int64_t at) {
+            const Instr &instr = this->function[value];
+            if (instr.type == Type::Number || instr.type == Type::Integer) {
+                // expression trees are evaluated where their result is stored, reading the states at their leaves there
+                for (const ValueId operand : instr.operands) this->use(operand, block, at);
+                return;
+            }
+            for (std::int32_t b = block; !this->contains(b, this->block_of[value]); b = this->parent[b]) {
+                at = std::max(at, this->ends[this->function.blocks[b].loop]);
+            }
+            this->last_use[value] = std::max(this->last_use[value], at);
+        }
+
+        void uses(std::int32_t block) {
+            for (const ValueId value : this->function.blocks[block].code) {
+                const Instr &instr = this->function[value];
+                if (instr.type == Type::Number || instr.type == Type::Integer) continue;
+                for (const ValueId operand : instr.operands) this->use(operand, block, this->position[value]);
+                if (instr.op == Opcode::Loop) {
+                    this->uses(instr.body);
+                    for (const ValueId yield : this->function.blocks[instr.body].yields) {
+                        this->use(yield, instr.body, this->body_end[instr.body]);
+                    }
+                }
+            }
+        }
+
+        [[nodiscard]] bool live_after(ValueId value, std::int64_t at) const {
+            return value != NONE && this->last_use[value] > at;
+        }
+
+        // #[Emission]
+
+        void emit(Op op, std::int32_t slot, std::int32_t operand = -1, bool as_number = false) {
+            this->out.code.push_back(tcomp::vm::Instr{op, slot, operand, as_number});
+            this->out.origins.push_back(this->origin);
+        }
+
+        std::int32_t temporary() {
+            this->out.slots.push_back("%" + std::to_string(this->temporaries++));
+            this->occupant.push_back(NONE);
+            return static_cast<std::int32_t>(this->out.slots.size() - 1);
+        }
+
+        void place(ValueId value, std::int32_t slot) {
+            this->location[value] = slot;
+            this->occupant[slot] = value;
+        }
+
+        /// A slot for a value computed at its position: its own name's, unless that still holds something needed
+        std::int32_t computed(ValueId value) {
+            const std::int32_t slot = this->function[value].slot;
+            const std::int32_t target = this->live_after(this->occupant[slot], this->position[value]) ? this->temporary() : slot;
+            this->place(value, target);
+            return target;
+        }
+
+        /// The slot for a value that updates `operand` where it is, working on a copy if the operand is still needed
+        std::int32_t in_place(ValueId value, ValueId operand) {
+            std::int32_t slot = this->location[operand];
+            if (this->live_after(operand, this->position[value])) {
+                const std::int32_t copy = this->temporary();
+                this->emit(Op::Copy, copy, slot);
+                slot = copy;
+            }
+            this->place(value, slot);
+            return slot;
+        }
+
+        /// Moves every value to its slot at once, breaking cycles through a temporary
+        void parallel_copy(std::vector<std::pair<std::int32_t, ValueId>> copies) {
+            std::vector<std::pair<std::int32_t, std::int32_t>> pending;  // (target, source slot)
+            for (const auto &[slot, value] : copies) {
+                if (this->location[value] != slot) pending.emplace_back(slot, this->location[value]);
+            }
+            while (!pending.empty()) {
+                auto ready = std::ranges::find_if(pending, [&](const auto &copy) {
+                    return std::ranges::none_of(pending, [&](const auto &other) { return other.second == copy.first; });
+                });
+                if (ready == pending.end()) {
+                    const std::int32_t saved = pending.front().second, spare = this->temporary();
+                    this->emit(Op::Copy, spare, saved);
+                    for (auto &copy : pending) {
+                        if (copy.second == saved) copy.second = spare;
+                    }
+                    continue;
+                }
+                this->emit(Op::Copy, ready->first, ready->second);
+                pending.erase(ready);
+            }
+            for (const auto &[slot, value] : copies) this->place(value, slot);
+        }
+
+        /// Appends the postfix code of a Number tree, reading states from where they are now
+        void postfix(ValueId value, tcomp::vm::Expression &expression, std::vector<std::string> &text) {
+            const Instr &instr = this->function[value];
+            switch (instr.op) {
+                case Opcode::Constant: {
+                    expression.code.push_back({ExprOp::Constant, 0, instr.constant});
+                    std::ostringstream spelling;
+                    spelling.precision(17);
+                    spelling << instr.constant;
+                    text.push_back("(" + spelling.str() + ")");
+                    return;
+                }
+                case Opcode::Number:
+                    expression.code.push_back({ExprOp::Load, static_cast<std::int32_t>(expression.variables.size())});
+                    expression.variables.push_back(this->location[instr.operands[0]]);
+                    text.push_back("{}");
+                    return;
+                case Opcode::Negate:
+                    this->postfix(instr.operands[0], expression, text);
+                    expression.code.push_back({ExprOp::Negate});
+                    text.back() = "(-" + text.back() + ")";
+                    return;
+                default: {
+                    this->postfix(instr.operands[0], expression, text);
+                    this->postfix(instr.operands[1], expression, text);
+                    const ExprOp op = expr_op(instr.op);
+                    expression.code.push_back({op});
+                    static const std::map<ExprOp, std::string> spellings = {
+                        {ExprOp::Add, "+"}, {ExprOp::Sub, "-"}, {ExprOp::Mul, "*"}, {ExprOp::Div, "/"}, {ExprOp::Mod, "%"},
+                        {ExprOp::Lt, "<"}, {ExprOp::Le, "<="}, {ExprOp::Gt, ">"}, {ExprOp::Ge, ">="}, {ExprOp::Eq, "=="},
+                        {ExprOp::Ne, "!="}, {ExprOp::And, "&"}, {ExprOp::Or, "|"}
+                    };
+                    const std::string rhs = text.back();
+                    text.pop_back();
+                    text.back() = "(" + text.back() + spellings.at(op) + rhs + ")";
+                    return;
+                }
+            }
+        }
+
+        /// The index of a new expression computing the Integer value `value`
+        std::int32_t expression(ValueId value) {
+            tcomp::vm::Expression expression;
+            std::vector<std::string> text;
+            const Instr &instr = this->function[value];
+            if (instr.op == Opcode::Truncate) {
+                this->postfix(instr.operands[0], expression, text);
+            } else {
+                // Integer: a truncated double (or a small folded value), so the double holds it exactly
+                expression.code.push_back({ExprOp::Constant, 0, static_cast<double>(instr.integer)});
+                text.push_back(std::to_string(instr.integer));
+            }
+            expression.text = text.back();
+
+            std::int32_t depth = 0;
+            for (const tcomp::vm::ExprStep &step : expression.code) {
+                depth += step.op == ExprOp::Constant || step.op == ExprOp::Load ? 1 : step.op == ExprOp::Negate ? 0 : -1;
+                expression.stack_depth = std::max(expression.stack_depth, depth);
+            }
+            this->out.expressions.push_back(std::move(expression));
+            return static_cast<std::int32_t>(this->out.expressions.size() - 1);
+        }
+
+        void lower(std::int32_t block) {
+            for (const ValueId value : this->function.blocks[block].code) {
+                const Instr &instr = this->function[value];
+                if (instr.origin) this->origin = instr.origin;
+
+                switch (instr.op) {
+                    case Opcode::Undefined:
+                        this->place(value, instr.slot);
+                        break;
+                    case Opcode::Param:
+                        this->emit(Op::Param, this->computed(value), instr.index);
+                        break;
+                    case Opcode::Produce: {
+                        const std::int32_t expression = this->expression(instr.operands[0]);
+                        this->emit(Op::Eval, this->computed(value), expression);
+                        break;
+                    }
+                    case Opcode::Evaluate: {
+                        tcomp::vm::Expression expression = this->source.expressions[instr.index];
+                        for (std::size_t i = 0; i < instr.operands.size(); ++i) {
+                            expression.variables[i] = this->location[instr.operands[i]];
+                        }
+                        this->out.expressions.push_back(std::move(expression));
+                        this->emit(Op::Eval, this->computed(value), static_cast<std::int32_t>(this->out.expressions.size() - 1));
+                        break;
+                    }
+                    case Opcode::Assign:
+                        this->emit(Op::Literal, this->in_place(value, instr.operands[0]), instr.index);
+                        break;
+                    case Opcode::Define:
+                        // the Print or Append that needs it defines the slot as it runs
+                        this->in_place(value, instr.operands[0]);
+                        break;
+                    case Opcode::Append: {
+                        std::vector<std::int32_t> sources;
+                        for (std::size_t i = 1; i < instr.operands.size(); ++i) sources.push_back(this->location[instr.operands[i]]);
+                        this->out.array_sources.push_back(std::move(sources));
+                        this->emit(Op::Array, this->in_place(value, instr.operands[0]), static_cast<std::int32_t>(this->out.array_sources.size() - 1));
+                        break;
+                    }
+                    case Opcode::Print:
+                        this->emit(Op::Output, this->location[instr.operands[0]], -1, instr.as_number);
+                        break;
+                    case Opcode::Loop:
+                        this->loop(value);
+                        break;
+                    default:
+                        // Numbers and Integers are computed where a state is produced from them
+                        break;
+                }
+            }
+        }
+
+        void loop(ValueId value) {
+            const Instr &instr = this->function[value];
+            const Block &body = this->function.blocks[instr.body];
+            const std::int64_t at = this->position[value];
+
+            // each carried name lives in one slot for the whole loop: its own unless that holds something else still needed
+            std::vector<std::pair<std::int32_t, ValueId>> entry;
+            for (std::size_t i = 0; i < body.params.size(); ++i) {
+                const std::int32_t slot = this->function[body.params[i]].slot;
+                // what it holds may still be an initial value, which the parallel copy reads before overwriting it
+                entry.emplace_back(this->live_after(this->occupant[slot], at) ? this->temporary() : slot, instr.operands[i]);
+            }
+            this->parallel_copy(entry);
+            for (std::size_t i = 0; i < body.params.size(); ++i) this->place(body.params[i], entry[i].first);
+
+            const std::int32_t counter = entry[instr.index].first;
+            const std::size_t enter = this->out.code.size();
+            this->emit(Op::LoopEnter, counter);
+            const std::size_t head = this->out.code.size();
+            this->emit(Op::LoopHead, counter);
+
+            this->lower(instr.body);
+
+            std::vector<std::pair<std::int32_t, ValueId>> next;
+            for (std::size_t i = 0; i < body.yields.size(); ++i) next.emplace_back(entry[i].first, body.yields[i]);
+            this->origin = instr.origin;
+            this->parallel_copy(next);
+            this->emit(Op::LoopBack, counter, static_cast<std::int32_t>(head));
+
+            const auto exit = static_cast<std::int32_t>(this->out.code.size());
+            this->out.code[enter].operand = exit;
+            this->out.code[head].operand = exit;
+            for (std::size_t i = 0; i < instr.results.size(); ++i) this->place(instr.results[i], entry[i].first);
+        }
+
+        const Function &function;
+        const tcomp::vm::Program &source;
+        tcomp::vm::Program out;
+        std::shared_ptr<AST> origin;
+
+        std::int64_t clock = 0;
+        std::vector<std::int64_t> position, last_use, ends, body_end;
+        std::vector<std::int32_t> block_of, parent;
+
+        std::vector<std::int32_t> location;  // slot of every State and Array value, once lowered
+        std::vector<ValueId> occupant;       // the value each slot holds at the point being lowered
+        std::int32_t temporaries = 0;
+    };
+
+    // #[Printing]
+
+    class Printer {
+    public:
+        Printer(const Function &function, std::ostream &out) : function(function), out(out) {}
+
+        void block(std::int32_t block, int depth) {
+            const std::string indent(2 * static_cast<std::size_t>(depth), ' ');
+            for (const ValueId value : this->function.blocks[block].code) {
+                const Instr &instr = this->function[value];
+                if (instr.op != Opcode::Loop) {
+                    this->out << indent << this->instruction(value) << '\n';
+                    continue;
+                }
+
+                const Block &body = this->function.blocks[instr.body];
+                this->out << indent << "loop %" << value << " over " << this->slot(this->function[body.params[instr.index]].slot) << " (";
+                for (std::size_t i = 0; i < body.params.size(); ++i) {
+                    this->out << (i ? ", " : "") << '%' << body.params[i] << " = " << this->operand(instr.operands[i]);
+                }
+                this->out << ") {\n";
+                this->block(instr.body, depth + 1);
+                this->out << indent << "  yield";
+                for (std::size_t i = 0; i < body.yields.size(); ++i) this->out << (i ? ", " : " ") << this->operand(body.yields[i]);
+                this->out << '\n' << indent << "} ->";
+                for (std::size_t i = 0; i < instr.results.size(); ++i) {
+                    this->out << (i ? ", " : " ") << '%' << instr.results[i] << ' ' << this->slot(this->function[instr.results[i]].slot);
+                }
+                this->out << '\n';
+            }
+        }
+
+        void exits() {
+            this->out << "exit";
+            for (std::size_t slot = 0; slot < this->function.exits.size(); ++slot) {
+                this->out << (slot ? ", " : " ") << this->slot(static_cast<std::int32_t>(slot)) << " = " << this->operand(this->function.exits[slot]);
+            }
+            this->out << '\n';
+        }
+
+    private:
+        [[nodiscard]] std::string slot(std::int32_t slot) const {
+            return this->function.G_source().slots[slot];
+        }
+
+        [[nodiscard]] static std::string operand(ValueId value) {
+            return "%" + std::to_string(value);
+        }
+
+        [[nodiscard]] std::string instruction(ValueId value) const {
+            const Instr &instr = this->function[value];
+            std::ostringstream text;
+            text.precision(17);
+            if (instr.type != Type::None) text << '%' << value << " = ";
+            text << tcomp::ir::name(instr.op);
+            if (instr.type == Type::State || instr.type == Type::Array) text << ' ' << this->slot(instr.slot);
+
+            switch (instr.op) {
+                case Opcode::Constant: text << ' ' << instr.constant; break;
+                case Opcode::Integer:  text << ' ' << instr.integer; break;
+                case Opcode::Param:    text << ' ' << this->function.G_source().parameters[instr.index]; break;
+                case Opcode::Assign:   text << " [" << this->function.G_source().literals[instr.index].bits << "]"; break;
+                case Opcode::Evaluate: text << " !{" << this->function.G_source().expressions[instr.index].text << "}"; break;
+                case Opcode::Print:    text << (instr.as_number ? " @" : ""); break;
+                default: break;
+            }
+            for (std::size_t i = 0; i < instr.operands.size(); ++i) text << (i ? ", " : " ") << operand(instr.operands[i]);
+            return text.str();
+        }
+
+        const Function &function;
+        std::ostream &out;
+    };
+}
+
+double tcomp::ir::apply(Opcode op, double lhs, double rhs) {
+    return vm::apply(expr_op(op), lhs, rhs);
+}
+
+tcomp::ir::ValueId tcomp::ir::expand(Function &function, const vm::Expression &expression, const std::vector<ValueId> &operands,
+                                     const std::shared_ptr<AST> &origin, std::vector<ValueId> &code) {
+    std::vector<ValueId> stack;
+    for (const vm::ExprStep &step : expression.code) {
+        Instr instr{.op = Opcode::Constant, .type = Type::Number, .origin = origin};
+        switch (step.op) {
+            case ExprOp::Constant:
+                instr.constant = step.constant;
+                break;
+            case ExprOp::Load:
+                instr.op = Opcode::Number;
+                instr.operands = {operands[step.index]};
+                break;
+            case ExprOp::Negate:
+                instr.op = Opcode::Negate;
+                instr.operands = {stack.back()};
+                stack.pop_back();
+                break;
+            default:
+                instr.op = opcode(step.op);
+                instr.operands = {stack[stack.size() - 2], stack.back()};
+                stack.resize(stack.size() - 2);
+                break;
+        }
+        stack.push_back(function.add(std::move(instr)));
+        code.push_back(stack.back());
+    }
+    return stack.back();
+}
+
+tcomp::ir::Function tcomp::ir::build(const vm::Program &program) {
+    Function function(std::make_shared<const vm::Program>(program));
+    Builder(program, function).run();
+    return function;
+}
+
+tcomp::vm::Program tcomp::ir::lower(const Function &function) {
+    return Lowerer(function).run();
+}
+
+void tcomp::ir::print(const Function &function, std::ostream &out) {
+    Printer printer(function, out);
+    printer.block(0, 0);
+    printer.exits();
+}
@@ -0,0 +1,578 @@
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <mutex>
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "headers/ast.h"
+#include "headers/bytecode.h"
+#include "headers/stats.h"
+#include "headers/jit.h"
+
+tcomp::jit::Frame::Frame(std::size_t slots) : slots(slots), words(NUMBERS + 3 * slots, 0) {
+    this->words[ZERO] = std::bit_cast<std::int64_t>(0.0);
+    this->words[SELF] = reinterpret_cast<std::int64_t>(this);
+}
+
+tcomp::jit::Loop::Loop(std::unique_ptr<vm::Program> program, std::vector<std::uint8_t> roles, void *code, std::size_t size)
+    : program(std::move(program)), roles(std::move(roles)), code(code), size(size) {}
+
+tcomp::jit::Loop::~Loop() {
+#if defined(__x86_64__) && defined(__linux__)
+    munmap(this->code, this->size);
+#endif
+}
+
+void tcomp::jit::Loop::run(Frame &frame, Runtime &runtime) const {
+    frame.runtime = &runtime;
+    frame.error = nullptr;
+    reinterpret_cast<void (*)(std::int64_t *)>(this->code)(frame.words.data());
+}
+
+int tcomp::jit::Loop::run_statement(std::int64_t *words, std::int32_t instr) noexcept {
+    auto *frame = reinterpret_cast<Frame *>(words[Frame::SELF]);
+    try {
+        frame->runtime->statement(instr);
+        return 0;
+    } catch (...) {
+        // unwinding through generated code is impossible, the loop returns and its caller rethrows
+        frame->error = std::current_exception();
+        return 1;
+    }
+}
+
+tcomp::jit::Cache::Cache(std::uint64_t hot_back_edges) : hot_back_edges(hot_back_edges) {}
+
+const tcomp::jit::Loop *tcomp::jit::Cache::enter(const std::shared_ptr<AST> &loop, std::uint64_t &cold_for) {
+    std::lock_guard lock(this->mutex);
+    Entry &entry = this->loops[loop.get()];
+    this->promote(loop, entry);
+
+    if (entry.compiled) {
+        cold_for = entry.native ? 0 : UINT64_MAX;
+    } else {
+        cold_for = this->hot_back_edges - entry.back_edges;
+    }
+    return entry.native.get();
+}
+
+const tcomp::jit::Loop *tcomp::jit::Cache::heat(const std::shared_ptr<AST> &loop, std::uint64_t back_edges) {
+    std::lock_guard lock(this->mutex);
+    Entry &entry = this->loops[loop.get()];
+    entry.back_edges += back_edges;
+    this->promote(loop, entry);
+    return entry.native.get();
+}
+
+void tcomp::jit::Cache::promote(const std::shared_ptr<AST> &loop, Entry &entry) const {
+    if (entry.compiled || entry.back_edges < this->hot_back_edges) {
+        return;
+    }
+    entry.compiled = true;
+    try {
+        entry.native = compile(vm::compile_loop(loop));
+        if (entry.native) {
+            stats::counters().native_loops.fetch_add(1, std::memory_order_relaxed);
+        }
+    } catch (const std::invalid_argument &) {
+        // parallel loops and empty literals, which only the interpreter handles
+    }
+}
+
+#if defined(__x86_64__) && defined(__linux__)
+
+namespace {
+    using tcomp::vm::ExprOp;
+    using tcomp::vm::Op;
+    using tcomp::jit::Frame;
+
+    // #[Registers]
+    // rbx holds the frame, r12 the dirty mask and r13 the iteration count for the whole loop; rax, rcx, rdx and
+    // r8 are scratch. xmm0-5 are the expression stack and xmm6-15 hold the ten most used slots.
+
+    constexpr int STACK_REGISTERS = 6;
+    constexpr int FIRST_SLOT_REGISTER = 6;
+    constexpr int SLOT_REGISTERS = 10;
+    constexpr std::size_t MAX_SLOTS = 64;  // one dirty bit each
+
+    /// An x86-64 encoder for the handful of instructions loops need; memory operands are always [rbx + disp32]
+    class Assembler {
+    public:
+        std::vector<std::uint8_t> bytes;
+
+        void emit(std::initializer_list<std::uint8_t> code) {
+            this->bytes.insert(this->bytes.end(), code);
+        }
+
+        void imm32(std::int32_t value) {
+            for (int i = 0; i < 4; ++i) this->bytes.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+        }
+
+        void imm64(std::int64_t value) {
+            for (int i = 0; i < 8; ++i) this->bytes.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+        }
+
+        /// ModRM addressing [rbx + disp32] with `reg` in the reg field
+        void frame_operand(int reg, std::size_t word) {
+            this->bytes.push_back(static_cast<std::uint8_t>(0x80 | ((reg & 7) << 3) | 3));
+            this->imm32(static_cast<std::int32_t>(8 * word));
+        }
+
+        /// A scalar double instruction `prefix [REX] 0F op` between two xmm registers
+        void sse(std::uint8_t prefix, std::uint8_t op, int reg, int rm) {
+            this->bytes.push_back(prefix);
+            if (reg >= 8 || rm >= 8) {
+                this->bytes.push_back(static_cast<std::uint8_t>(0x40 | (reg >= 8 ? 4 : 0) | (rm >= 8 ? 1 : 0)));
+            }
+            this->emit({0x0F, op, static_cast<std::uint8_t>(0xC0 | ((reg & 7) << 3) | (rm & 7))});
+        }
+
+        /// The same with a frame word as the r/m operand
+        void sse_frame(std::uint8_t prefix, std::uint8_t op, int reg, std::size_t word) {
+            this->bytes.push_back(prefix);
+            if (reg >= 8) {
+                this->bytes.push_back(0x44);
+            }
+            this->emit({0x0F, op});
+            this->frame_operand(reg, word);
+        }
+
+        void movsd_load(int xmm, std::size_t word) { this->sse_frame(0xF2, 0x10, xmm, word); }
+        void movsd_store(int xmm, std::size_t word) { this->sse_frame(0xF2, 0x11, xmm, word); }
+
+        /// movq between xmm and a general register (`to_xmm` ? xmm <- gpr : gpr <- xmm), gpr below r8
+        void movq(int xmm, int gpr, bool to_xmm) {
+            this->bytes.push_back(0x66);
+            this->bytes.push_back(static_cast<std::uint8_t>(0x48 | (xmm >= 8 ? 4 : 0)));
+            this->emit({0x0F, static_cast<std::uint8_t>(to_xmm ? 0x6E : 0x7E), static_cast<std::uint8_t>(0xC0 | ((xmm & 7) << 3) | gpr)});
+        }
+
+        /// cvtsi2sd xmm, rdx
+        void convert_rdx(int xmm) {
+            this->bytes.push_back(0xF2);
+            this->bytes.push_back(static_cast<std::uint8_t>(0x48 | (xmm >= 8 ? 4 : 0)));
+            this->emit({0x0F, 0x2A, static_cast<std::uint8_t>(0xC0 | ((xmm & 7) << 3) | 2)});
+        }
+
+        /// A forward rel8 jump whose target is set with `land`
+        std::size_t jump8(std::uint8_t opcode) {
+            this->emit({opcode, 0});
+            return this->bytes.size() - 1;
+        }
+
+        void land(std::size_t at) {
+            this->bytes[at] = static_cast<std::uint8_t>(this->bytes.size() - at - 1);
+        }
+
+        /// A rel32 jump (`opcode` 0xE9, or a 0x0F 0x8x condition) to a position recorded later; returns where to patch
+        std::size_t jump32(std::initializer_list<std::uint8_t> opcode) {
+            this->emit(opcode);
+            this->imm32(0);
+            return this->bytes.size() - 4;
+        }
+
+        void patch32(std::size_t at, std::size_t target) {
+            const auto rel = static_cast<std::int32_t>(static_cast<std::int64_t>(target) - static_cast<std::int64_t>(at + 4));
+            std::memcpy(&this->bytes[at], &rel, 4);
+        }
+    };
+
+    class CodeGenerator {
+    public:
+        using Entry = int (*)(std::int64_t *, std::int32_t);
+
+        CodeGenerator(const tcomp::vm::Program &program, const std::vector<std::uint8_t> &roles, Entry runtime)
+            : program(program), roles(roles), runtime(runtime) {
+            // the most used numbers get registers, the rest are read from and written to the frame
+            std::vector<std::size_t> uses(program.slots.size(), 0);
+            for (const auto &instr : program.code) {
+                if (instr.op == Op::Eval) {
+                    for (const std::int32_t slot : program.expressions[instr.operand].variables) ++uses[slot];
+                }
+                if (instr.op == Op::Eval || instr.op == Op::LoopHead) ++uses[instr.slot];
+            }
+            std::vector<std::size_t> order(program.slots.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&uses](std::size_t a, std::size_t b) { return uses[a] > uses[b]; });
+
+            this->registers.assign(program.slots.size(), -1);
+            int next = FIRST_SLOT_REGISTER;
+            for (const std::size_t slot : order) {
+                if (next == FIRST_SLOT_REGISTER + SLOT_REGISTERS) break;
+                if (roles[slot] & tcomp::jit::Read) {
+                    this->registers[slot] = next++;
+                    this->allocated.push_back(slot);
+                }
+            }
+        }
+
+        /// Generates the whole function; false when an instruction cannot be translated
+        bool generate() {
+            Assembler &a = this->a;
+            const std::size_t count = this->program.code.size();
+
+            // push rbx; push r12; push r13 (leaves the stack 16-byte aligned for calls); mov rbx, rdi
+            a.emit({0x53, 0x41, 0x54, 0x41, 0x55, 0x48, 0x89, 0xFB});
+            // xor r12d, r12d; xor r13d, r13d
+            a.emit({0x45, 0x31, 0xE4, 0x45, 0x31, 0xED});
+            this->reload();
+
+            std::vector<std::size_t> offsets(count + 1);
+            std::vector<std::pair<std::size_t, std::size_t>> fixups;  // (rel32 position, target instruction)
+
+            for (std::size_t i = 0; i < count; ++i) {
+                offsets[i] = a.bytes.size();
+                const tcomp::vm::Instr &instr = this->program.code[i];
+
+                switch (instr.op) {
+                    case Op::LoopEnter:
+                        break;
+                    case Op::LoopHead: {
+                        const auto counter = static_cast<std::size_t>(instr.slot);
+                        // mov rax, [count]; test rax, rax; jle exit; dec rax
+                        a.emit({0x48, 0x8B});
+                        a.frame_operand(0, this->count_word(counter));
+                        a.emit({0x48, 0x85, 0xC0});
+                        fixups.emplace_back(a.jump32({0x0F, 0x8E}), static_cast<std::size_t>(instr.operand));
+                        a.emit({0x48, 0xFF, 0xC8});
+                        // the counter becomes int_to_binary(count - 1): mov [produced], rax; mov edx, eax; mov [count], rdx
+                        a.emit({0x48, 0x89});
+                        a.frame_operand(0, this->produced_word(counter));
+                        a.emit({0x89, 0xC2, 0x48, 0x89});
+                        a.frame_operand(2, this->count_word(counter));
+                        this->store_number(counter);
+                        this->mark_dirty(counter);
+                        // inc r13; add qword [statements], body
+                        a.emit({0x49, 0xFF, 0xC5});
+                        if (const std::int32_t body = this->body_statements(i); body > 0) {
+                            a.emit({0x48, 0x81});
+                            a.frame_operand(0, Frame::STATEMENTS);
+                            a.imm32(body);
+                        }
+                        break;
+                    }
+                    case Op::LoopBack:
+                        fixups.emplace_back(a.jump32({0xE9}), static_cast<std::size_t>(instr.operand));
+                        break;
+                    case Op::Eval:
+                        if (!this->expression(this->program.expressions[instr.operand])) {
+                            return false;
+                        }
+                        this->store(static_cast<std::size_t>(instr.slot));
+                        break;
+                    case Op::Output:
+                    case Op::Array:
+                        this->call_runtime(static_cast<std::int32_t>(i));
+                        fixups.emplace_back(a.jump32({0x0F, 0x85}), count);
+                        break;
+                    default:
+                        return false;
+                }
+            }
+
+            // exit: mov [dirty], r12; mov [iterations], r13; pop r13; pop r12; pop rbx; ret
+            offsets[count] = a.bytes.size();
+            a.emit({0x4C, 0x89});
+            a.frame_operand(4, Frame::DIRTY);
+            a.emit({0x4C, 0x89});
+            a.frame_operand(5, Frame::ITERATIONS);
+            a.emit({0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3});
+
+            for (const auto &[at, target] : fixups) {
+                a.patch32(at, offsets[target]);
+            }
+            return true;
+        }
+
+        [[nodiscard]] const std::vector<std::uint8_t> &G_bytes() const { return this->a.bytes; }
+
+    private:
+        [[nodiscard]] std::size_t number_word(std::size_t slot) const { return Frame::NUMBERS + slot; }
+        [[nodiscard]] std::size_t produced_word(std::size_t slot) const { return Frame::NUMBERS + this->program.slots.size() + slot; }
+        [[nodiscard]] std::size_t count_word(std::size_t slot) const { return Frame::NUMBERS + 2 * this->program.slots.size() + slot; }
+
+        /// Direct statements of the body that starts after the LoopHead at `head`, nested loops counting as one
+        [[nodiscard]] std::int32_t body_statements(std::size_t head) const {
+            std::int32_t statements = 0;
+            int depth = 0;
+            for (std::size_t i = head + 1; i < this->program.code.size(); ++i) {
+                const Op op = this->program.code[i].op;
+                if (op == Op::LoopBack && depth-- == 0) break;
+                if (depth == 0 && (op == Op::Eval || op == Op::LoopEnter)) ++statements;
+                if (op == Op::LoopEnter) ++depth;
+            }
+            return statements;
+        }
+
+        /// Leaves the value of `expression` in xmm0
+        bool expression(const tcomp::vm::Expression &expression) {
+            if (!expression.native() || expression.stack_depth > STACK_REGISTERS) {
+                return false;
+            }
+
+            Assembler &a = this->a;
+            int top = -1;
+            for (const tcomp::vm::ExprStep &step : expression.code) {
+                switch (step.op) {
+                    case ExprOp::Constant:
+                        ++top;
+                        a.emit({0x48, 0xB8});  // mov rax, imm64
+                        a.imm64(std::bit_cast<std::int64_t>(step.constant));
+                        a.movq(top, 0, true);
+                        break;
+                    case ExprOp::Load: {
+                        ++top;
+                        const auto slot = static_cast<std::size_t>(expression.variables[step.index]);
+                        if (this->registers[slot] >= 0) {
+                            a.sse(0x66, 0x28, top, this->registers[slot]);  // movapd
+                        } else {
+                            a.movsd_load(top, this->number_word(slot));
+                        }
+                        break;
+                    }
+                    case ExprOp::Negate:
+                        // flip the sign bit: movq rax, xmm; btc rax, 63; movq xmm, rax
+                        a.movq(top, 0, false);
+                        a.emit({0x48, 0x0F, 0xBA, 0xF8, 0x3F});
+                        a.movq(top, 0, true);
+                        break;
+                    default:
+                        this->binary(step.op, top - 1, top);
+                        --top;
+                        break;
+                }
+            }
+            return true;
+        }
+
+        void binary(ExprOp op, int lhs, int rhs) {
+            Assembler &a = this->a;
+            switch (op) {
+                case ExprOp::Add: a.sse(0xF2, 0x58, lhs, rhs); return;
+                case ExprOp::Mul: a.sse(0xF2, 0x59, lhs, rhs); return;
+                case ExprOp::Sub: a.sse(0xF2, 0x5C, lhs, rhs); return;
+                case ExprOp::Div: a.sse(0xF2, 0x5E, lhs, rhs); return;
+                case ExprOp::Mod: {
+                    // x87 fprem computes the exact remainder, which is what fmod returns
+                    a.movsd_store(lhs, Frame::SCRATCH);
+                    a.movsd_store(rhs, Frame::SCRATCH + 1);
+                    a.emit({0xDD});
+                    a.frame_operand(0, Frame::SCRATCH + 1);  // fld qword [rhs]
+                    a.emit({0xDD});
+                    a.frame_operand(0, Frame::SCRATCH);      // fld qword [lhs]
+                    // 1: fprem; fnstsw ax; test ah, 4; jnz 1b; fstp st(1)
+                    a.emit({0xD9, 0xF8, 0xDF, 0xE0, 0xF6, 0xC4, 0x04, 0x75, 0xF7, 0xDD, 0xD9});
+                    a.emit({0xDD});
+                    a.frame_operand(3, Frame::SCRATCH);      // fstp qword [lhs]
+                    a.movsd_load(lhs, Frame::SCRATCH);
+                    return;
+                }
+                case ExprOp::And:
+                case ExprOp::Or:
+                    // al = lhs != 0, dl = rhs != 0 (NaN counts as nonzero, as in C++)
+                    a.sse_frame(0x66, 0x2E, lhs, Frame::ZERO);
+                    a.emit({0x0F, 0x95, 0xC0, 0x0F, 0x9A, 0xC1, 0x08, 0xC8});  // setne al; setp cl; or al, cl
+                    a.sse_frame(0x66, 0x2E, rhs, Frame::ZERO);
+                    a.emit({0x0F, 0x95, 0xC2, 0x0F, 0x9A, 0xC1, 0x08, 0xCA});  // setne dl; setp cl; or dl, cl
+                    a.emit({static_cast<std::uint8_t>(op == ExprOp::And ? 0x20 : 0x08), 0xD0});  // and/or al, dl
+                    break;
+                case ExprOp::Lt: a.sse(0x66, 0x2E, rhs, lhs); a.emit({0x0F, 0x97, 0xC0}); break;  // rhs > lhs: seta
+                case ExprOp::Le: a.sse(0x66, 0x2E, rhs, lhs); a.emit({0x0F, 0x93, 0xC0}); break;  // rhs >= lhs: setae
+                case ExprOp::Gt: a.sse(0x66, 0x2E, lhs, rhs); a.emit({0x0F, 0x97, 0xC0}); break;
+                case ExprOp::Ge: a.sse(0x66, 0x2E, lhs, rhs); a.emit({0x0F, 0x93, 0xC0}); break;
+                case ExprOp::Eq:
+                    a.sse(0x66, 0x2E, lhs, rhs);
+                    a.emit({0x0F, 0x94, 0xC0, 0x0F, 0x9B, 0xC1, 0x20, 0xC8});  // sete al; setnp cl; and al, cl
+                    break;
+                case ExprOp::Ne:
+                    a.sse(0x66, 0x2E, lhs, rhs);
+                    a.emit({0x0F, 0x95, 0xC0, 0x0F, 0x9A, 0xC1, 0x08, 0xC8});  // setne al; setp cl; or al, cl
+                    break;
+                default:
+                    return;
+            }
+            // the comparison result is 0.0 or 1.0: movzx eax, al; cvtsi2sd lhs, eax
+            a.emit({0x0F, 0xB6, 0xC0, 0xF2});
+            if (lhs >= 8) a.emit({0x44});
+            a.emit({0x0F, 0x2A, static_cast<std::uint8_t>(0xC0 | ((lhs & 7) << 3))});
+        }
+
+        /// Stores xmm0 to `slot` the way the tree walker does: int_to_binary(static_cast<int64_t>(value))
+        void store(std::size_t slot) {
+            Assembler &a = this->a;
+            // cvttsd2si rax, xmm0; mov [produced], rax
+            a.emit({0xF2, 0x48, 0x0F, 0x2C, 0xC0, 0x48, 0x89});
+            a.frame_operand(0, this->produced_word(slot));
+            this->mark_dirty(slot);
+
+            const std::uint8_t roles = this->roles[slot];
+            if (!(roles & tcomp::jit::Read)) {
+                return;
+            }
+
+            // rdx = the 32-bit magnitude: mov rdx, rax; neg rdx; cmovs rdx, rax; mov edx, edx
+            a.emit({0x48, 0x89, 0xC2, 0x48, 0xF7, 0xDA, 0x48, 0x0F, 0x48, 0xD0, 0x89, 0xD2});
+            // test rax, rax; jns positive
+            a.emit({0x48, 0x85, 0xC0});
+            const std::size_t positive = a.jump8(0x79);
+
+            // negative: the bits read back as magnitude - 2^bit_width(magnitude) (signed) or with that bit set (count)
+            a.emit({0x31, 0xC9, 0x85, 0xD2});  // xor ecx, ecx; test edx, edx
+            const std::size_t shift = a.jump8(0x74);
+            a.emit({0x0F, 0xBD, 0xCA, 0xFF, 0xC1});  // bsr ecx, edx; inc ecx
+            a.land(shift);
+            a.emit({0xB8, 0x01, 0x00, 0x00, 0x00, 0x48, 0xD3, 0xE0});  // mov eax, 1; shl rax, cl
+            if (roles & tcomp::jit::Counter) {
+                // mov r8, rdx; or r8, rax; mov [count], r8
+                a.emit({0x49, 0x89, 0xD0, 0x49, 0x09, 0xC0, 0x4C, 0x89});
+                a.frame_operand(0, this->count_word(slot));
+            }
+            a.emit({0x48, 0x29, 0xC2});  // sub rdx, rax
+            const std::size_t convert = a.jump8(0xEB);
+
+            a.land(positive);
+            if (roles & tcomp::jit::Counter) {
+                a.emit({0x48, 0x89});
+                a.frame_operand(2, this->count_word(slot));
+            }
+            a.land(convert);
+            this->store_number(slot);
+        }
+
+        /// Converts the signed value in rdx into the slot's number
+        void store_number(std::size_t slot) {
+            if (this->registers[slot] >= 0) {
+                this->a.convert_rdx(this->registers[slot]);
+            } else if (this->roles[slot] & tcomp::jit::Read) {
+                this->a.convert_rdx(0);
+                this->a.movsd_store(0, this->number_word(slot));
+            }
+        }
+
+        void mark_dirty(std::size_t slot) {
+            // bts r12, slot
+            this->a.emit({0x49, 0x0F, 0xBA, 0xEC, static_cast<std::uint8_t>(slot)});
+        }
+
+        void spill() {
+            for (const std::size_t slot : this->allocated) {
+                this->a.movsd_store(this->registers[slot], this->number_word(slot));
+            }
+        }
+
+        void reload() {
+            for (const std::size_t slot : this->allocated) {
+                this->a.movsd_load(this->registers[slot], this->number_word(slot));
+            }
+        }
+
+        /// Calls the runtime entry (Loop::run_statement) with the frame and `instr` and leaves its result in eax; every xmm register is caller-saved
+        void call_runtime(std::int32_t instr) {
+            Assembler &a = this->a;
+            a.emit({0x4C, 0x89});
+            a.frame_operand(4, Frame::DIRTY);  // mov [dirty], r12
+            this->spill();
+            a.emit({0x48, 0x89, 0xDF, 0xBE});  // mov rdi, rbx; mov esi, instr
+            a.imm32(instr);
+            a.emit({0x48, 0xB8});              // mov rax, run_statement; call rax
+            a.imm64(reinterpret_cast<std::int64_t>(this->runtime));
+            a.emit({0xFF, 0xD0});
+            this->reload();
+            a.emit({0x85, 0xC0});              // test eax, eax
+        }
+
+        Assembler a;
+        const tcomp::vm::Program &program;
+        const std::vector<std::uint8_t> &roles;
+        const Entry runtime;
+        std::vector<int> registers;           // xmm register of each slot, -1 for slots kept in the frame
+        std::vector<std::size_t> allocated;   // slots that have a register
+    };
+
+    /// Role bits of every slot, or an empty vector when the same name is used as a number and as an array
+    std::vector<std::uint8_t> slot_roles(const tcomp::vm::Program &program) {
+        std::vector<std::uint8_t> roles(program.slots.size(), 0);
+        int depth = 0;  // 1 in the body of the loop itself
+        for (const auto &instr : program.code) {
+            switch (instr.op) {
+                case Op::LoopEnter:
+                    ++depth;
+                    break;
+                case Op::LoopBack:
+                    --depth;
+                    break;
+                case Op::Eval:
+                    for (const std::int32_t slot : program.expressions[instr.operand].variables) roles[slot] |= tcomp::jit::Read;
+                    if (depth == 1 && roles[instr.slot] == 0) {
+                        // nested bodies may not run at all, the loop's own body always does before anything else
+                        roles[instr.slot] |= tcomp::jit::Assigned;
+                    }
+                    roles[instr.slot] |= tcomp::jit::Write;
+                    break;
+                case Op::LoopHead:
+                    roles[instr.slot] |= tcomp::jit::Read | tcomp::jit::Write | tcomp::jit::Counter;
+                    break;
+                case Op::Array:
+                    for (const std::int32_t slot : program.array_sources[instr.operand]) roles[slot] |= tcomp::jit::Read;
+                    roles[instr.slot] |= tcomp::jit::Appended;
+                    break;
+                default:
+                    break;
+            }
+        }
+        for (const std::uint8_t role : roles) {
+            if ((role & tcomp::jit::Appended) && (role & (tcomp::jit::Read | tcomp::jit::Write))) {
+                return {};
+            }
+        }
+        return roles;
+    }
+}
+
+std::unique_ptr<tcomp::jit::Loop> tcomp::jit::compile(vm::Program program) {
+    if (program.slots.size() > MAX_SLOTS) {
+        return nullptr;
+    }
+    std::vector<std::uint8_t> roles = slot_roles(program);
+    if (roles.empty() && !program.slots.empty()) {
+        return nullptr;
+    }
+
+    CodeGenerator generator(program, roles, &Loop::run_statement);
+    if (!generator.generate()) {
+        return nullptr;
+    }
+
+    // written while writable, then switched to executable: the buffer is never both
+    const std::vector<std::uint8_t> &bytes = generator.G_bytes();
+    const auto page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    const std::size_t size = (bytes.size() + page - 1) / page * page;
+    void *code = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED) {
+        return nullptr;
+    }
+    std::memcpy(code, bytes.data(), bytes.size());
+    if (mprotect(code, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(code, size);
+        return nullptr;
+    }
+
+    return std::make_unique<Loop>(std::make_unique<vm::Program>(std::move(program)), std::move(roles), code, size);
+}
+
+#else
+
+std::unique_ptr<tcomp::jit::Loop> tcomp::jit::compile(vm::Program) {
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,546 @@
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <variant>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <stdexcept>
+#include <cstdint>
+
+#include "headers/ast.h"
+#include "headers/lexer.h"
+#include "headers/error.h"
+#include "headers/parser.h"
+#include "headers/semantic_analysis.h"
+#include "headers/driver.h"
+#include "headers/thread_pool.h"
+#include "headers/bytecode.h"
+#include "headers/lanes.h"
+#include "headers/passes.h"
+
+namespace {
+    /// Upper bound on the values a single `--sweep` may expand to
+    constexpr std::size_t MAX_SWEEP_VALUES = std::size_t{1} << 24;
+
+    std::int64_t parse_integer(const std::string &text, const std::string &spec) {
+        std::size_t consumed = 0;
+        std::int64_t value = 0;
+        try {
+            value = std::stoll(text, &consumed);
+        } catch (const std::exception &) {
+            consumed = 0;
+        }
+        if (text.empty() || consumed != text.size()) {
+            throw std::invalid_argument("'" + text + "' is not an integer in " + spec);
+        }
+        return value;
+    }
+
+    /// The message std::get throws with when a slot holds the other kind of symbol, as the tree walker reports it
+    const std::string &wrong_alternative_message() {
+        static const std::string message = [] {
+            try {
+                std::variant<Variable, Array> symbol;
+                (void)std::get<Array>(symbol);
+            } catch (const std::bad_variant_access &e) {
+                return std::string(e.what());
+            }
+            return std::string();
+        }();
+        return message;
+    }
+
+    template <typename F>
+    void combine(std::vector<double> &lhs, const std::vector<double> &rhs, std::size_t lanes, F f) {
+        for (std::size_t lane = 0; lane < lanes; ++lane) {
+            lhs[lane] = f(lhs[lane], rhs[lane]);
+        }
+    }
+}
+
+tcomp::vm::Sweep tcomp::vm::parse_sweep(const std::string &spec) {
+    const std::size_t equals = spec.find('=');
+    if (equals == std::string::npos || equals == 0 || equals + 1 == spec.size()) {
+        throw std::invalid_argument("expected name=values, got " + spec);
+    }
+
+    Sweep sweep;
+    sweep.name = spec.substr(0, equals);
+
+    std::stringstream items(spec.substr(equals + 1));
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        const std::size_t range = item.find("..");
+        if (range == std::string::npos) {
+            sweep.values.push_back(parse_integer(item, spec));
+        } else {
+            const std::int64_t first = parse_integer(item.substr(0, range), spec);
+            const std::int64_t last = parse_integer(item.substr(range + 2), spec);
+            const std::int64_t step = first <= last ? 1 : -1;
+            for (std::int64_t value = first; ; value += step) {
+                if (sweep.values.size() >= MAX_SWEEP_VALUES) break;
+                sweep.values.push_back(value);
+                if (value == last) break;
+            }
+        }
+
+        if (sweep.values.size() >= MAX_SWEEP_VALUES) {
+            throw std::invalid_argument("too many values in " + spec);
+        }
+    }
+
+    if (sweep.values.empty()) {
+        throw std::invalid_argument("no values in " + spec);
+    }
+    return sweep;
+}
+
+tcomp::vm::LaneMachine::LaneMachine(const Program &program, std::size_t lanes, std::vector<std::vector<std::int64_t>> parameters)
+    : program(program), parameters(std::move(parameters)), lanes(lanes),
+      columns(program.slots.size()), alive(lanes, 1), active(lanes, 1), results(lanes) {
+    for (auto &column : this->columns) {
+        column.kind.assign(lanes, Kind::Undefined);
+        column.value.assign(lanes, Value{});
+        column.number.assign(lanes, 0.0);
+        column.array.resize(lanes);
+    }
+
+    std::int32_t depth = 0;
+    for (const auto &expression : program.expressions) {
+        depth = std::max(depth, expression.stack_depth);
+    }
+    this->stack.assign(static_cast<std::size_t>(depth), std::vector<double>(lanes));
+}
+
+std::vector<tcomp::vm::LaneResult> tcomp::vm::LaneMachine::run() {
+    const std::vector<Instr> &code = this->program.code;
+
+    std::size_t pc = 0;
+    while (pc < code.size() && std::ranges::any_of(this->alive, [](std::uint8_t a) { return a != 0; })) {
+        const Instr &instr = code[pc];
+
+        switch (instr.op) {
+            case Op::Literal: this->literal(instr); break;
+            case Op::Param:   this->param(instr); break;
+            case Op::Eval:    this->eval(instr); break;
+            case Op::Array:   this->array(instr); break;
+            case Op::Output:  this->output(instr); break;
+            case Op::Copy:    this->copy(instr); break;
+            case Op::LoopEnter:
+                this->loop_enter(instr);
+                break;
+            case Op::LoopHead:
+                if (!this->loop_head(instr)) {
+                    pc = static_cast<std::size_t>(instr.operand);
+                    continue;
+                }
+                break;
+            case Op::LoopBack:
+                pc = static_cast<std::size_t>(instr.operand);
+                continue;
+        }
+        ++pc;
+    }
+
+    return std::move(this->results);
+}
+
+void tcomp::vm::LaneMachine::S_output(std::ostream &out) {
+    if (this->lanes != 1) {
+        throw std::logic_error("only a single lane can write its output as it runs");
+    }
+    this->out = &out;
+}
+
+void tcomp::vm::LaneMachine::flush(std::size_t lane) {
+    if (this->out) {
+        *this->out << this->results[lane].output;
+        this->results[lane].output.clear();
+    }
+}
+
+std::map<std::string, std::string> tcomp::vm::LaneMachine::symbols(std::size_t lane) const {
+    std::map<std::string, std::string> symbols;
+    for (std::size_t slot = 0; slot < this->columns.size(); ++slot) {
+        const SlotColumn &column = this->columns[slot];
+        if (this->program.slots[slot].starts_with('%')) {
+            continue;  // the optimiser's temporaries
+        }
+        if (column.kind[lane] == Kind::Variable) {
+            symbols[this->program.slots[slot]] = this->program.bits(column.value[lane]);
+        } else if (column.kind[lane] == Kind::Array) {
+            std::string elements;
+            for (const Value &value : column.array[lane]) {
+                elements += (elements.empty() ? "" : ",") + this->program.bits(value);
+            }
+            symbols[this->program.slots[slot]] = "[" + elements + "]";
+        }
+    }
+    return symbols;
+}
+
+void tcomp::vm::LaneMachine::set(std::int32_t slot, std::size_t lane, const Value &value) {
+    SlotColumn &column = this->columns[slot];
+    column.kind[lane] = Kind::Variable;
+    column.value[lane] = value;
+    column.number[lane] = this->program.number(value);
+}
+
+void tcomp::vm::LaneMachine::kill(std::size_t lane, const std::string &message) {
+    this->results[lane].output += "Runtime Error: " + message + "\n";
+    this->flush(lane);
+    this->results[lane].ok = false;
+    this->alive[lane] = 0;
+    this->active[lane] = 0;
+}
+
+void tcomp::vm::LaneMachine::literal(const Instr &instr) {
+    const SlotColumn &column = this->columns[instr.slot];
+    for (std::size_t lane = 0; lane < this->lanes; ++lane) {
+        if (this->active[lane] && column.kind[lane] == Kind::Undefined) {
+            this->set(instr.slot, lane, Value{0, instr.operand});
+        }
+    }
+}
+
+void tcomp::vm::LaneMachine::param(const Instr &instr) {
+    const std::vector<std::int64_t> &values = this->parameters[instr.operand];
+    for (std::size_t lane = 0; lane < this->lanes; ++lane) {
+        if (this->active[lane]) {
+            this->store(instr.slot, lane, static_cast<double>(values[lane]));
+        }
+    }
+}
+
+void tcomp::vm::LaneMachine::store(std::int32_t slot, std::size_t lane, double value) {
+    if (this->columns[slot].kind[lane] == Kind::Array) {
+        this->kill(lane, wrong_alternative_message());
+        return;
+    }
+    this->set(slot, lane, Value{static_cast<std::int64_t>(value)});
+}
+
+double tcomp::vm::LaneMachine::evaluate_slow(const Expression &expression, std::size_t lane) {
+    // the tree walker skips undefined names (shifting later placeholders) and throws on arrays
+    std::vector<std::string> values;
+    for (const std::int32_t slot : expression.variables) {
+        const SlotColumn &column = this->columns[slot];
+        if (column.kind[lane] == Kind::Array) {
+            throw std::runtime_error(wrong_alternative_message());
+        }
+        if (column.kind[lane] == Kind::Variable) {
+            values.push_back(std::to_string(this->program.signed_value(column.value[lane])));
+        }
+    }
+    return evaluate_text(expression, values);
+}
+
+void tcomp::vm::LaneMachine::eval(const Instr &instr) {
+    const Expression &expression = this->program.expressions[instr.operand];
+
+    if (!expression.native()) {
+        for (std::size_t lane = 0; lane < this->lanes; ++lane) {
+            if (!this->active[lane]) continue;
+            try {
+                this->store(instr.slot, lane, this->evaluate_slow(expression, lane));
+            } catch (const std::exception &e) {
+                this->kill(lane, e.what());
+            }
+        }
+        return;
+    }
+
+    // evaluate the postfix code over whole lane columns; inactive lanes compute garbage that is never stored
+    std::size_t depth = 0;
+    for (const ExprStep &step : expression.code) {
+        switch (step.op) {
+            case ExprOp::Constant:
+                std::fill(this->stack[depth].begin(), this->stack[depth].end(), step.constant);
+                ++depth;
+                break;
+            case ExprOp::Load: {
+                const std::vector<double> &number = this->columns[expression.variables[step.index]].number;
+                std::copy(number.begin(), number.end(), this->stack[depth].begin());
+                ++depth;
+                break;
+            }
+            case ExprOp::Negate:
+                for (double &value : this->stack[depth - 1]) {
+                    value = -value;
+                }
+                break;
+            default: {
+                std::vector<double> &lhs = this->stack[depth - 2];
+                const std::vector<double> &rhs = this->stack[depth - 1];
+                switch (step.op) {
+                    case ExprOp::Add: combine(lhs, rhs, this->lanes, [](double a, double b) { return a + b; }); break;
+                    case ExprOp::Sub: combine(lhs, rhs, this->lanes, [](double a, double b) { return a - b; }); break;
+                    case ExprOp::Mul: combine(lhs, rhs, this->lanes, [](double a, double b) { return a * b; }); break;
+                    case ExprOp::Div: combine(lhs, rhs, this->lanes, [](double a, double b) { return a / b; }); break;
+                    default: {
+                        const ExprOp op = step.op;
+                        combine(lhs, rhs, this->lanes, [op](double a, double b) { return apply(op, a, b); });
+                        break;
+                    }
+                }
+                --depth;
+                break;
+            }
+        }
+    }
+    const std::vector<double> &result = this->stack[0];
+
+    for (std::size_t lane = 0; lane < this->lanes; ++lane) {
+        if (!this->active[lane]) continue;
+
+        const bool fast = std::ranges::all_of(expression.variables, [&](std::int32_t slot) {
+            return this->columns[slot].kind[lane] == Kind::Variable;
+        });
+        if (fast) {
+            this->store(instr.slot, lane, result[lane]);
+            continue;
+        }
+
+        try {
+            this->store(instr.slot, lane, this->evaluate_slow(expression, lane));
+        } catch (const std::exception &e) {
+            this->kill(lane, e.what());
+        }
+    }
+}
+
+void tcomp::vm::LaneMachine::array(const Instr &instr) {
+    const std::vector<std::int32_t> &sources = this->program.array_sources[instr.operand];
+
+    for (std::size_t lane = 0; lane < this->lanes; ++lane) {
+        if (!this->active[lane]) continue;
+
+        SlotColumn &target = this->columns[instr.slot];
+        if (target.kind[lane] == Kind::Variable) {
+            this->kill(lane, wrong_alternative_message());
+            continue;
+        }
+
+        std::vector<Value> elements = target.kind[lane] == Kind::Array ? target.array[lane] : std::vector<Value>{};
+        bool failed = false;
+        for (const std::int32_t source : sources) {
+            SlotColumn &column = this->columns[source];
+            if (column.kind[lane] == Kind::Array) {
+                failed = true;
+                break;
+            }
+            if (column.kind[lane] == Kind::Undefined) {
+                this->set(source, lane, Value{});
+            }
+            elements.push_back(column.value[lane]);
+        }
+
+        if (failed) {
+            this->kill(lane, wrong_alternative_message());
+            continue;
+        }
+
+        target.kind[lane] = Kind::Array;
+        target.array[lane] = std::move(elements);
+        target.number[lane] = 0.0;
+    }
+}
+
+void tcomp::vm::LaneMachine::output(const Instr &instr) {
+    for (std::size_t lane = 0; lane < this->lanes; ++lane) {
+        if (!this->active[lane]) continue;
+
+        SlotColumn &column = this->columns[instr.slot];
+        std::string &out = this->results[lane].output;
+
+        if (column.kind[lane] == Kind::Undefined) {
+            this->set(instr.slot, lane, Value{});
+        }
+
+        if (column.kind[lane] == Kind::Variable) {
+            const Value &value = column.value[lane];
+            out += instr.as_number ? std::to_string(this->program.signed_value(value)) : this->program.bits(value);
+            out += '\n';
+            this->flush(lane);
+            continue;
+        }
+
+        for (const Value &value : column.array[lane]) {
+            if (instr.as_number) {
+                out += std::to_string(this->program.signed_value(value)) + " ";
+            } else if (this->program.width(value) == 8) {
+                // elements that are not exactly 8 bits are skipped, as in the tree walker
+                out += sem_analysis::binary_to_char(this->program.bits(value));
+            }
+        }
+        out += '\n';
+        this->flush(lane);
+    }
+}
+
+void tcomp::vm::LaneMachine::copy(const Instr &instr) {
+    SlotColumn &target = this->columns[instr.slot];
+    const SlotColumn &source = this->columns[instr.operand];
+    for (std::size_t lane = 0; lane < this->lanes; ++lane) {
+        if (!this->active[lane]) continue;
+
+        target.kind[lane] = source.kind[lane];
+        target.value[lane] = source.value[lane];
+        target.number[lane] = source.number[lane];
+        target.array[lane] = source.array[lane];
+    }
+}
+
+void tcomp::vm::LaneMachine::loop_enter(const Instr &instr) {
+    const SlotColumn &column = this->columns[instr.slot];
+    for (std::size_t lane = 0; lane < this->lanes; ++lane) {
+        if (!this->active[lane]) continue;
+
+        if (column.kind[lane] == Kind::Undefined) {
+            this->kill(lane, "Variable not found in symbol table: " + this->program.slots[instr.slot]);
+        } else if (column.kind[lane] == Kind::Array) {
+            this->kill(lane, wrong_alternative_message());
+        }
+    }
+    // the saved masks are kept (and reused) after their loop ends, so entering an inner loop on every
+    // iteration of an outer one does not allocate
+    if (this->mask_depth == this->mask_stack.size()) {
+        this->mask_stack.emplace_back();
+    }
+    this->mask_stack[this->mask_depth++].assign(this->active.begin(), this->active.end());
+}
+
+bool tcomp::vm::LaneMachine::loop_head(const Instr &instr) {
+    const SlotColumn &column = this->columns[instr.slot];
+    bool any = false;
+
+    for (std::size_t lane = 0; lane < this->lanes; ++lane) {
+        if (!this->active[lane]) continue;
+
+        const std::int64_t count = this->program.unsigned_value(column.value[lane]);
+        if (count <= 0) {
+            // this lane is done with the loop and idles until every other lane is too
+            this->active[lane] = 0;
+            continue;
+        }
+        this->set(instr.slot, lane, Value{count - 1});
+        any = true;
+    }
+
+    if (any) {
+        return true;
+    }
+
+    const std::vector<std::uint8_t> &outer = this->mask_stack[--this->mask_depth];
+    for (std::size_t lane = 0; lane < this->lanes; ++lane) {
+        this->active[lane] = outer[lane] & this->alive[lane];
+    }
+    return false;
+}
+
+int tcomp::vm::run_sweep(const Options &options, std::ostream &out) {
+    std::vector<Sweep> sweeps;
+    std::size_t lanes = 1;
+    try {
+        std::unordered_set<std::string> names;
+        for (const auto &spec : options.sweeps) {
+            Sweep sweep = parse_sweep(spec);
+            if (!names.insert(sweep.name).second) {
+                throw std::invalid_argument(sweep.name + " is swept more than once");
+            }
+            if (sweep.values.size() != 1 && lanes != 1 && sweep.values.size() != lanes) {
+                throw std::invalid_argument("every sweep must have the same number of values, or exactly one");
+            }
+            lanes = std::max(lanes, sweep.values.size());
+            sweeps.push_back(std::move(sweep));
+        }
+    } catch (const std::invalid_argument &e) {
+        out << "Invalid --sweep: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::ifstream file;
+    if (options.input != "-") {
+        file.open(options.input);
+        if (!file.is_open()) {
+            out << "File not found" << std::endl;
+            return 1;
+        }
+    }
+
+    auto script = tcomp::compile(options.input == "-" ? std::cin : file, options.input, options.max_error_count);
+    if (!script->error_pack.errors.empty()) {
+        return tcomp::run(*script, options.input, out);
+    }
+
+    std::vector<std::string> names;
+    for (const auto &sweep : sweeps) {
+        names.push_back(sweep.name);
+    }
+
+    Program program;
+    try {
+        program = ir::optimize(vm::compile(script->program, names), options.opt_level);
+    } catch (const std::invalid_argument &e) {
+        out << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // parameter values in the order the compiled program binds them, broadcasting single values
+    std::vector<const Sweep *> bound;
+    for (const auto &name : program.parameters) {
+        bound.push_back(&*std::ranges::find(sweeps, name, &Sweep::name));
+    }
+
+    std::vector<LaneResult> results(lanes);
+    {
+        ThreadPool pool(options.jobs != 0 ? options.jobs : std::thread::hardware_concurrency());
+
+        for (std::size_t first = 0; first < lanes; first += LaneMachine::BLOCK_SIZE) {
+            pool.submit([&, first] {
+                const std::size_t count = std::min(LaneMachine::BLOCK_SIZE, lanes - first);
+
+                std::vector<std::vector<std::int64_t>> parameters;
+                for (const Sweep *sweep : bound) {
+                    auto &values = parameters.emplace_back(count);
+                    for (std::size_t lane = 0; lane < count; ++lane) {
+                        values[lane] = sweep->values.size() == 1 ? sweep->values[0] : sweep->values[first + lane];
+                    }
+                }
+
+                try {
+                    LaneMachine machine(program, count, std::move(parameters));
+                    std::ranges::move(machine.run(), results.begin() + static_cast<std::ptrdiff_t>(first));
+                } catch (const std::exception &e) {
+                    for (std::size_t lane = first; lane < first + count; ++lane) {
+                        results[lane] = LaneResult{"Error: " + std::string(e.what()) + "\n", false};
+                    }
+                }
+            });
+        }
+    }
+
+    int status = 0;
+    for (std::size_t lane = 0; lane < lanes; ++lane) {
+        out << "==> ";
+        for (std::size_t s = 0; s < sweeps.size(); ++s) {
+            const auto &values = sweeps[s].values;
+            out << (s ? ", " : "") << sweeps[s].name << "=" << (values.size() == 1 ? values[0] : values[lane]);
+        }
+        if (!results[lane].ok) {
+            out << " (exit 1)";
+            status = 1;
+        }
+        out << " <==\n" << results[lane].output;
+    }
+    out << std::flush;
+
+    return status;
+}
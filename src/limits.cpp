@@ -0,0 +1,124 @@
+#include <string>
+#include <sstream>
+#include <limits>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <charconv>
+#include <cmath>
+#include <string_view>
+#include <optional>
+
+#include "headers/limits.h"
+
+tcomp::limits::Budget::Budget(std::uint64_t max_steps, double timeout_seconds)
+    : initial(max_steps == 0 ? std::numeric_limits<std::int64_t>::max()
+                             : static_cast<std::int64_t>(std::min<std::uint64_t>(max_steps, std::numeric_limits<std::int64_t>::max()))),
+      remaining(initial), timeout_seconds(timeout_seconds) {
+    if (timeout_seconds <= 0) {
+        return;
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(timeout_seconds));
+    this->watchdog = std::thread([this, deadline] {
+        std::unique_lock lock(this->mutex);
+        if (!this->cancelled.wait_until(lock, deadline, [this] { return this->finished; })) {
+            this->expired.store(true, std::memory_order_relaxed);
+        }
+    });
+}
+
+tcomp::limits::Budget::~Budget() {
+    if (this->watchdog.joinable()) {
+        {
+            std::lock_guard lock(this->mutex);
+            this->finished = true;
+        }
+        this->cancelled.notify_all();
+        this->watchdog.join();
+    }
+}
+
+std::int64_t tcomp::limits::Budget::claim(std::int64_t wanted) {
+    std::int64_t available = this->remaining.load(std::memory_order_relaxed);
+    std::int64_t granted = 0;
+    do {
+        granted = std::min(available, wanted);
+        if (granted <= 0) {
+            this->fail(Reason::Steps);
+        }
+    } while (!this->remaining.compare_exchange_weak(available, available - granted, std::memory_order_relaxed));
+    return granted;
+}
+
+std::uint64_t tcomp::limits::Budget::G_steps() const {
+    return static_cast<std::uint64_t>(this->initial - this->remaining.load(std::memory_order_relaxed));
+}
+
+void tcomp::limits::Budget::fail(Reason reason) const {
+    std::ostringstream message;
+    if (reason == Reason::Timeout) {
+        message << "time limit of " << this->timeout_seconds << " s reached";
+    } else {
+        message << "step limit of " << this->initial << " loop iterations reached";
+    }
+    throw LimitExceeded(reason, message.str());
+}
+
+// charge() compares against the cap as a signed count, which every cap parse_size accepts fits in
+tcomp::limits::MemoryArena::MemoryArena(std::uint64_t max_bytes)
+    : max_bytes(std::min<std::uint64_t>(max_bytes, std::numeric_limits<std::int64_t>::max())) {}
+
+std::uint64_t tcomp::limits::parse_size(const std::string &text) {
+    const char *end = text.data() + text.size();
+    auto scale_of = [&](const char *suffix) -> std::optional<std::uint64_t> {
+        const std::string_view unit(suffix, static_cast<std::size_t>(end - suffix));
+        if (unit.empty()) return 1;
+        if (unit == "K" || unit == "k") return std::uint64_t{1} << 10;
+        if (unit == "M" || unit == "m") return std::uint64_t{1} << 20;
+        if (unit == "G" || unit == "g") return std::uint64_t{1} << 30;
+        return std::nullopt;
+    };
+    constexpr auto max_size = static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max());
+    const std::string too_large = "size " + text + " is larger than " + std::to_string(max_size) + " bytes";
+
+    // whole numbers are taken exactly, so every cap up to the largest one is accepted as written
+    std::uint64_t whole = 0;
+    if (const auto [consumed, error] = std::from_chars(text.data(), end, whole); error == std::errc{}) {
+        if (const auto scale = scale_of(consumed)) {
+            std::uint64_t bytes = 0;
+            if (__builtin_mul_overflow(whole, *scale, &bytes) || bytes > max_size) {
+                throw std::invalid_argument(too_large);
+            }
+            return bytes;
+        }
+    }
+
+    double value = 0;
+    const auto [consumed, error] = std::from_chars(text.data(), end, value);
+    if (error != std::errc{} && error != std::errc::result_out_of_range) {
+        throw std::invalid_argument("expected a size, got '" + text + "'");
+    }
+    const auto scale = scale_of(consumed);
+    if (!scale) {
+        throw std::invalid_argument("unknown size suffix in " + text);
+    }
+    if (std::isnan(value)) {
+        throw std::invalid_argument("expected a size, got '" + text + "'");
+    }
+    if (value < 0) {
+        throw std::invalid_argument("negative size " + text);
+    }
+    // 2^63 is the first double above the largest cap; infinity and values out of a double's range end up here too
+    const double bytes = value * static_cast<double>(*scale);
+    if (error == std::errc::result_out_of_range || !(bytes < 9223372036854775808.0)) {
+        throw std::invalid_argument(too_large);
+    }
+    return static_cast<std::uint64_t>(bytes);
+}
@@ -74,16 +74,35 @@ void Parser::S_handle_errors(bool handle_errors) {
 
 
 std::vector<Token> Parser::subarray_creator_from_scope(int &pos) {
+        const int size = static_cast<int>(this->tokens.size());
+        auto syntax_error = [&](const std::string &message, const Token &token) {
+            this->error_pack.augment(tcomp::Error{
+                .filepath = this->filename,
+                .type = tcomp::ErrorType::SYNTAX_ERROR,
+                .Xmessage = message,
+                .line = token.line,
+                .column = token.column
+            });
+        };
+        if (pos >= size || this->tokens[pos].value != parser_constants::TOKEN_LEFT_BRACE) {
+            syntax_error("Expected '{'", this->tokens[std::min(pos, size - 1)]);
+            return {};
+        }
+
         int amount = 0;
         const int initialPos = pos;
         do {
-            if (this->tokens[pos].value == "{") {
+            if (this->tokens[pos].value == parser_constants::TOKEN_LEFT_BRACE) {
                 ++amount;
-            } else if (this->tokens[pos].value == "}") {
+            } else if (this->tokens[pos].value == parser_constants::TOKEN_RIGHT_BRACE) {
                 --amount;
             }
             ++pos;
-        } while (amount != 0 && pos < static_cast<int>(this->tokens.size()));
+        } while (amount != 0 && pos < size);
+        if (amount != 0) {
+            syntax_error("Expected '}'", this->tokens[size - 1]);
+            return {};
+        }
         return {this->tokens.begin() + (initialPos+1), this->tokens.begin() + (pos-1)};
 }
 
@@ -187,6 +206,7 @@ void Parser::parse_variable(int &pos) {
     std::vector<bool> bits;
 
     while (pos < static_cast<int>(tokens.size())) {
+        const int iteration_start = pos;
         if (IsDigit::predicate(tokens[pos])) {
             int num = std::stoi(tokens[pos].value); pos++;
 
@@ -220,7 +240,19 @@ void Parser::parse_variable(int &pos) {
             continue;
         } if (right_bracket()) {
             break;
+        } if (pos != iteration_start) {
+            continue;
         }
+
+        // nothing was consumed, so this would spin here forever, e.g. an unterminated `[++ => x`
+        this->error_pack.augment(tcomp::Error{
+            .filepath = this->filename,
+            .type = tcomp::ErrorType::SYNTAX_ERROR,
+            .Xmessage = "Expected ']'",
+            .line = tokens[pos].line,
+            .column = tokens[pos].column
+        });
+        break;
     }
 
     // TODO make a critical_consume function that would instantly terminate on error if the consumed parser threw an error
@@ -327,15 +359,25 @@ void Parser::parse_loop(int &pos) {
 
     std::string iteration_count_variable = this->identifier_parser(pos);
 
+    auto loopNode = std::make_shared<StmtLoopNode>();
+
+    // `(:n | sum total, max best ${ ... })` declares a parallel loop
+    if (tokens[pos].value == parser_constants::TOKEN_OR) {
+        ++pos;
+        loopNode->parallel = true;
+        this->parse_reductions(pos, loopNode->reductions);
+    }
+
     this->consume(dollar);
 
     // TODO add all operations inside the loop as a child of the loop node
 
-    auto loopNode = std::make_shared<StmtLoopNode>();
-
     std::vector<Token> sub_tokens = this->subarray_creator_from_scope(pos);
 
-    Parser sub_parser(this->filename, sub_tokens, this->unfilteredTokens, this->unfilteredLines, this->error_pack, false);
+    // The sub parser starts with an empty pack and leaves reporting to us, otherwise errors are duplicated on merge
+    // and a bad loop body terminates the process before the enclosing program's errors are collected.
+    Parser sub_parser(this->filename, sub_tokens, this->unfilteredTokens, this->unfilteredLines, ErrorPack{}, this->allowed_errors);
+    sub_parser.S_handle_errors(false);
     sub_parser.parse();
     std::shared_ptr<ProgramNode> sub_program = sub_parser.G_program();
     this->error_pack.merge(sub_parser.G_error_pack());
@@ -352,6 +394,41 @@ void Parser::parse_loop(int &pos) {
     this->currentNode->addChild(loopNode);
 }
 
+void Parser::parse_reductions(int &pos, std::vector<std::pair<std::string, std::string>> &reductions) {
+    while (pos < static_cast<int>(tokens.size()) && tokens[pos].value != parser_constants::TOKEN_DOLLAR && tokens[pos].type != TokenType::eof) {
+        if (tokens[pos].type != TokenType::IDENTIFIER || !parser_constants::REDUCTION_OPERATORS.contains(tokens[pos].value)) {
+            this->error_pack.augment(tcomp::Error{
+                .filepath = this->filename,
+                .type = tcomp::ErrorType::SYNTAX_ERROR,
+                .Xmessage = "Expected a reduction (sum, product, min, max or xor)",
+                .line = tokens[pos].line,
+                .column = tokens[pos].column
+            });
+            // skip the rest of this declaration
+            while (pos < static_cast<int>(tokens.size()) && tokens[pos].value != parser_constants::TOKEN_COMMA
+                   && tokens[pos].value != parser_constants::TOKEN_DOLLAR && tokens[pos].type != TokenType::eof) {
+                ++pos;
+            }
+            if (pos < static_cast<int>(tokens.size()) && tokens[pos].value == parser_constants::TOKEN_COMMA) {
+                ++pos;
+            }
+            continue;
+        }
+
+        std::string reduction_operator = tokens[pos].value;
+        ++pos;
+
+        std::string name = this->identifier_parser(pos);
+        if (!name.empty()) {
+            reductions.emplace_back(reduction_operator, name);
+        }
+
+        if (tokens[pos].value == parser_constants::TOKEN_COMMA) {
+            ++pos;
+        }
+    }
+}
+
 void Parser::parse_expression(int &pos) {
     Generic_pc<parser_constants::TOKEN_NOT> exclamation(pos, tokens);
     Generic_pc<parser_constants::TOKEN_LEFT_BRACE> left_brace(pos, tokens);
@@ -395,9 +472,23 @@ void Parser::parse_expression(int &pos) {
 }
 
 
+void Parser::unexpected_token(int &pos) {
+    // Statements we cannot parse yet are reported and skipped; leaving `pos` untouched would never terminate
+    this->error_pack.augment(tcomp::Error{
+        .filepath = this->filename,
+        .type = tcomp::ErrorType::SYNTAX_ERROR,
+        .Xmessage = "Unexpected token '" + tokens[pos].value + "'",
+        .line = tokens[pos].line,
+        .column = tokens[pos].column
+    });
+    ++pos;
+}
+
 void Parser::parse() {
     for (int pos = 0; pos < static_cast<int>(tokens.size());) {
         const auto &token = tokens[pos];
+        const std::size_t statement_count = this->currentNode->getChildren().size();
+
         if (token.type == TokenType::SYMBOL) {
             if (token.value == "[")
                 parse_variable(pos);
@@ -411,16 +502,26 @@ void Parser::parse() {
                 parse_loop(pos);
             else if (token.value == "!")
                 parse_expression(pos);
+            else
+                unexpected_token(pos);
 
         } else if (token.type == TokenType::KEYWORD) {
             // Handle identifier
+            unexpected_token(pos);
         } else if (token.type == TokenType::eof) {
             break;
+        } else {
+            unexpected_token(pos);
+        }
+
+        // statements remember where they started so runtime tools can point back at the source
+        if (this->currentNode->getChildren().size() > statement_count) {
+            this->currentNode->getChildren().back()->setLocation(token.line, token.column);
         }
 
         if (this->more_than_allowed_errors()) {
-            std::cout << "Too many errors, stopping parsing." << std::endl;
-            // TODO:  output collected errors
+            // reported with the errors, so it reaches whichever stream the caller reports them to
+            this->error_pack.stopped_early = true;
             break;
         }
     }
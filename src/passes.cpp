@@ -0,0 +1,1197 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <optional>
+#include <variant>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <stdexcept>
+#include <cstdint>
+#include <cmath>
+#include <numeric>
+
+#include "headers/lexer.h"
+#include "headers/error.h"
+#include "headers/parser.h"
+#include "headers/semantic_analysis.h"
+#include "headers/driver.h"
+#include "headers/bytecode.h"
+#include "headers/lanes.h"
+#include "headers/ir.h"
+#include "headers/passes.h"
+
+namespace {
+    using tcomp::ir::Function;
+    using tcomp::ir::Instr;
+    using tcomp::ir::NONE;
+    using tcomp::ir::Opcode;
+    using tcomp::ir::Type;
+    using tcomp::ir::ValueId;
+
+    /// The blocks still reachable from the program, outer blocks first
+    std::vector<std::int32_t> reachable(const Function &function) {
+        std::vector<std::int32_t> blocks = {0};
+        for (std::size_t i = 0; i < blocks.size(); ++i) {
+            for (const ValueId value : function.blocks[blocks[i]].code) {
+                if (function[value].op == Opcode::Loop) blocks.push_back(function[value].body);
+            }
+        }
+        return blocks;
+    }
+
+    /// What `!{...}` reads from a state that is known before the program runs
+    std::optional<double> known_number(const Function &function, ValueId state) {
+        const Instr &instr = function[state];
+        const bool fresh = !instr.operands.empty() && function[instr.operands[0]].op == Opcode::Undefined;
+        switch (instr.op) {
+            case Opcode::Produce:
+                if (function[instr.operands[0]].op == Opcode::Integer) {
+                    return static_cast<double>(tcomp::vm::produced_signed(function[instr.operands[0]].integer));
+                }
+                return std::nullopt;
+            case Opcode::Assign:
+                if (fresh) return function.G_source().literals[instr.index].number;
+                return std::nullopt;
+            case Opcode::Define:
+                if (fresh) return 0.0;
+                return std::nullopt;
+            default:
+                return std::nullopt;
+        }
+    }
+
+    /// How many times a loop over a known state runs
+    std::optional<std::int64_t> known_count(const Function &function, ValueId state) {
+        const Instr &instr = function[state];
+        const bool fresh = !instr.operands.empty() && function[instr.operands[0]].op == Opcode::Undefined;
+        if (instr.op == Opcode::Produce && function[instr.operands[0]].op == Opcode::Integer) {
+            return tcomp::vm::produced_unsigned(function[instr.operands[0]].integer);
+        }
+        if (instr.op == Opcode::Assign && fresh) {
+            return function.G_source().literals[instr.index].unsigned_value;
+        }
+        return std::nullopt;
+    }
+
+    /// static_cast<std::int64_t> as x86-64 does it: out-of-range values and NaN become INT64_MIN
+    std::int64_t truncate(double value) {
+        return value >= -0x1p63 && value < 0x1p63 ? static_cast<std::int64_t>(value) : INT64_MIN;
+    }
+
+    /**
+     * @class ConstantFolding
+     * @brief Computes what is known before the program runs.
+     *
+     * Arithmetic on constants is done with exprtk's semantics, so a folded chain of assignments goes through
+     * the same int_to_binary round trips the interpreter's would. `x * 1`, `x / 1` and `x - 0` are x exactly;
+     * `x + 0` is not (it turns -0 into 0), so it stays. Opaque expressions whose inputs turn out to be defined
+     * are opened up, literals and defines of defined names disappear, and loops over a count of 0 go away.
+     */
+    class ConstantFolding final : public tcomp::ir::Pass {
+    public:
+        [[nodiscard]] const char *name() const override { return "fold"; }
+
+        bool run(Function &function) override {
+            bool changed = false;
+            for (const std::int32_t block : reachable(function)) {
+                std::vector<ValueId> code;
+                for (const ValueId value : function.blocks[block].code) {
+                    changed |= this->visit(function, value, code);
+                }
+                function.blocks[block].code = std::move(code);
+            }
+            return changed;
+        }
+
+    private:
+        /// Folds one instruction, adding what stays of it to `code`
+        static bool visit(Function &function, ValueId value, std::vector<ValueId> &code) {
+            Instr &instr = function[value];
+            const std::vector<ValueId> operands = instr.operands;
+            auto constant = [&](ValueId operand) -> std::optional<double> {
+                if (function[operand].op == Opcode::Constant) return function[operand].constant;
+                return std::nullopt;
+            };
+            auto become = [&](Instr folded) {
+                folded.origin = function[value].origin;
+                function[value] = std::move(folded);
+                code.push_back(value);
+                return true;
+            };
+            auto forward = [&](ValueId to) {
+                function.replace_uses(value, to);
+                return true;
+            };
+
+            switch (instr.op) {
+                case Opcode::Number:
+                    if (const auto number = known_number(function, operands[0])) {
+                        return become(Instr{.op = Opcode::Constant, .type = Type::Number, .constant = *number});
+                    }
+                    break;
+                case Opcode::Negate:
+                    if (const auto operand = constant(operands[0])) {
+                        return become(Instr{.op = Opcode::Constant, .type = Type::Number, .constant = -*operand});
+                    }
+                    break;
+                case Opcode::Add: case Opcode::Sub: case Opcode::Mul: case Opcode::Div: case Opcode::Mod:
+                case Opcode::Lt: case Opcode::Le: case Opcode::Gt: case Opcode::Ge: case Opcode::Eq: case Opcode::Ne:
+                case Opcode::And: case Opcode::Or: {
+                    const auto lhs = constant(operands[0]), rhs = constant(operands[1]);
+                    if (lhs && rhs) {
+                        return become(Instr{.op = Opcode::Constant, .type = Type::Number, .constant = tcomp::ir::apply(instr.op, *lhs, *rhs)});
+                    }
+                    const bool one = rhs == 1.0, zero = rhs == 0.0;
+                    if (((instr.op == Opcode::Mul || instr.op == Opcode::Div) && one) || (instr.op == Opcode::Sub && zero)) {
+                        return forward(operands[0]);
+                    }
+                    if (instr.op == Opcode::Mul && lhs == 1.0) {
+                        return forward(operands[1]);
+                    }
+                    break;
+                }
+                case Opcode::Truncate:
+                    if (const auto operand = constant(operands[0])) {
+                        return become(Instr{.op = Opcode::Integer, .type = Type::Integer, .integer = truncate(*operand)});
+                    }
+                    break;
+                case Opcode::Assign:
+                case Opcode::Define:
+                    if (function.defined(operands[0])) {
+                        return forward(operands[0]);
+                    }
+                    break;
+                case Opcode::Evaluate: {
+                    const tcomp::vm::Expression &expression = function.G_source().expressions[instr.index];
+                    if (!expression.native() || !std::ranges::all_of(operands, [&](ValueId v) { return function.defined(v); })) {
+                        break;
+                    }
+                    // every input is a number now, so it cannot fail and exprtk is not needed
+                    const std::shared_ptr<AST> origin = instr.origin;
+                    const ValueId number = tcomp::ir::expand(function, expression, operands, origin, code);
+                    const ValueId integer = function.add(Instr{.op = Opcode::Truncate, .type = Type::Integer, .operands = {number}, .origin = origin});
+                    code.push_back(integer);
+                    Instr &produce = function[value];
+                    produce.op = Opcode::Produce;
+                    produce.operands = {integer};
+                    produce.index = -1;
+                    code.push_back(value);
+                    return true;
+                }
+                case Opcode::Loop: {
+                    const auto count = known_count(function, operands[instr.index]);
+                    if (!count || *count > 0) break;
+                    const std::vector<ValueId> results = instr.results;
+                    for (std::size_t i = 0; i < results.size(); ++i) {
+                        function.replace_uses(results[i], operands[i]);
+                    }
+                    return true;
+                }
+                default:
+                    break;
+            }
+            code.push_back(value);
+            return false;
+        }
+    };
+
+    /**
+     * @class DeadCodeElimination
+     * @brief Deletes instructions nothing observable depends on.
+     *
+     * Output, loops and opaque expressions (which may stop the program with a runtime error) are kept; every
+     * other instruction lives only if one of them, the loop control or the final content of a name needs it.
+     * Names a loop carries but nobody reads after any iteration stop being carried.
+     */
+    class DeadCodeElimination final : public tcomp::ir::Pass {
+    public:
+        [[nodiscard]] const char *name() const override { return "dce"; }
+
+        bool run(Function &function) override {
+            const std::vector<std::int32_t> blocks = reachable(function);
+            std::vector<bool> live(function.size(), false);
+            std::vector<ValueId> work;
+            auto mark = [&](ValueId value) {
+                if (!live[value]) {
+                    live[value] = true;
+                    work.push_back(value);
+                }
+            };
+            // a carried position is needed when its Phi or Exit is: then so are its initial and next values
+            auto carried = [&](ValueId loop, std::int32_t index) {
+                mark(function[loop].operands[index]);
+                mark(function.blocks[function[loop].body].yields[index]);
+                mark(function.blocks[function[loop].body].params[index]);
+            };
+
+            for (const ValueId exit : function.exits) mark(exit);
+            for (const std::int32_t block : blocks) {
+                for (const ValueId value : function.blocks[block].code) {
+                    if (!tcomp::ir::pure(function[value].op)) mark(value);
+                }
+            }
+            while (!work.empty()) {
+                const ValueId value = work.back();
+                work.pop_back();
+                const Instr &instr = function[value];
+                for (const ValueId operand : instr.operands) {
+                    if (instr.op != Opcode::Loop && instr.op != Opcode::Exit) mark(operand);
+                }
+                switch (instr.op) {
+                    case Opcode::Loop:
+                        carried(value, instr.index);
+                        break;
+                    case Opcode::Phi:
+                        carried(function.blocks[instr.body].loop, instr.index);
+                        break;
+                    case Opcode::Exit:
+                        mark(instr.operands[0]);
+                        carried(instr.operands[0], instr.index);
+                        break;
+                    default:
+                        break;
+                }
+            }
+
+            bool changed = false;
+            for (const std::int32_t block : blocks) {
+                std::vector<ValueId> &code = function.blocks[block].code;
+                const std::size_t before = code.size();
+                std::erase_if(code, [&](ValueId value) { return !live[value]; });
+                changed |= code.size() != before;
+
+                for (const ValueId value : code) {
+                    if (function[value].op == Opcode::Loop) changed |= this->uncarry(function, value, live);
+                }
+            }
+            return changed;
+        }
+
+    private:
+        /// Drops the carried positions of a loop whose Phi is dead
+        static bool uncarry(Function &function, ValueId loop, const std::vector<bool> &live) {
+            Instr &instr = function[loop];
+            tcomp::ir::Block &body = function.blocks[instr.body];
+            std::vector<std::size_t> keep;
+            for (std::size_t i = 0; i < body.params.size(); ++i) {
+                if (live[body.params[i]]) keep.push_back(i);
+            }
+            if (keep.size() == body.params.size()) return false;
+
+            auto select = [&](std::vector<ValueId> &values) {
+                std::vector<ValueId> kept;
+                for (const std::size_t i : keep) kept.push_back(values[i]);
+                values = std::move(kept);
+            };
+            instr.index = static_cast<std::int32_t>(std::ranges::find(keep, static_cast<std::size_t>(instr.index)) - keep.begin());
+            select(instr.operands);
+            select(instr.results);
+            select(body.params);
+            select(body.yields);
+            for (std::size_t i = 0; i < keep.size(); ++i) {
+                function[body.params[i]].index = static_cast<std::int32_t>(i);
+                function[instr.results[i]].index = static_cast<std::int32_t>(i);
+            }
+            return true;
+        }
+    };
+
+    /**
+     * @class LoopInvariantCodeMotion
+     * @brief Moves `!{...}` computations whose inputs a loop does not change out of the loop.
+     *
+     * A computed state (and the expression tree it is computed from) whose leaves are all defined outside the
+     * loop is the same in every iteration, so it is computed once before the loop instead; the loop carries it
+     * into the name it is assigned to with a copy. Inner loops are done first, so a computation that only
+     * depends on an outer loop's names moves out of every loop in between. Such computations cannot fail, so
+     * computing them when the loop then runs zero times changes nothing. Opaque expressions are left where
+     * they are, since they may stop the program with a runtime error.
+     */
+    class LoopInvariantCodeMotion final : public tcomp::ir::Pass {
+    public:
+        [[nodiscard]] const char *name() const override { return "licm"; }
+
+        bool run(Function &function) override {
+            const std::vector<std::int32_t> blocks = reachable(function);
+            std::vector<std::int32_t> block_of(function.size(), 0), parent(function.blocks.size(), -1);
+            for (const std::int32_t block : blocks) {
+                for (const ValueId value : function.blocks[block].code) {
+                    block_of[value] = block;
+                    const Instr &instr = function[value];
+                    if (instr.op != Opcode::Loop) continue;
+                    parent[instr.body] = block;
+                    for (const ValueId phi : function.blocks[instr.body].params) block_of[phi] = instr.body;
+                    for (const ValueId result : instr.results) block_of[result] = block;
+                }
+            }
+
+            bool changed = false;
+            // reachable() lists every body after the block its loop is in, so going backwards does inner loops first
+            for (auto block = blocks.rbegin(); block != blocks.rend() && *block != 0; ++block) {
+                auto inside = [&](ValueId value) {
+                    for (std::int32_t b = block_of[value]; b != -1; b = parent[b]) {
+                        if (b == *block) return true;
+                    }
+                    return false;
+                };
+
+                std::vector<ValueId> hoisted, kept;
+                for (const ValueId value : function.blocks[*block].code) {
+                    const Instr &instr = function[value];
+                    if (movable(instr.op) && std::ranges::none_of(instr.operands, inside)) {
+                        hoisted.push_back(value);
+                        block_of[value] = parent[*block];
+                    } else {
+                        kept.push_back(value);
+                    }
+                }
+                if (hoisted.empty()) continue;
+
+                function.blocks[*block].code = std::move(kept);
+                std::vector<ValueId> &outer = function.blocks[parent[*block]].code;
+                outer.insert(std::ranges::find(outer, function.blocks[*block].loop), hoisted.begin(), hoisted.end());
+                changed = true;
+            }
+            return changed;
+        }
+
+    private:
+        static bool movable(Opcode op) {
+            switch (op) {
+                case Opcode::Produce:
+                case Opcode::Number: case Opcode::Constant: case Opcode::Negate:
+                case Opcode::Add: case Opcode::Sub: case Opcode::Mul: case Opcode::Div: case Opcode::Mod:
+                case Opcode::Lt: case Opcode::Le: case Opcode::Gt: case Opcode::Ge: case Opcode::Eq: case Opcode::Ne:
+                case Opcode::And: case Opcode::Or:
+                case Opcode::Truncate: case Opcode::Integer:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+    };
+
+    // #[Closed forms]
+
+    constexpr std::int64_t EXACT = std::int64_t{1} << 53;    // doubles hold every integer up to here
+    constexpr std::int64_t STORED = std::int64_t{1} << 32;   // int_to_binary keeps 32 bits of magnitude
+
+    /// Whether a loop body only computes `!{...}`: no output, appends, opaque expressions or inner loops
+    bool effect_free(const Function &function, std::int32_t body) {
+        return std::ranges::all_of(function.blocks[body].code, [&](ValueId value) {
+            switch (function[value].op) {
+                case Opcode::Produce: case Opcode::Number: case Opcode::Constant: case Opcode::Negate:
+                case Opcode::Add: case Opcode::Sub: case Opcode::Mul: case Opcode::Div: case Opcode::Mod:
+                case Opcode::Lt: case Opcode::Le: case Opcode::Gt: case Opcode::Ge: case Opcode::Eq: case Opcode::Ne:
+                case Opcode::And: case Opcode::Or: case Opcode::Truncate: case Opcode::Integer:
+                    return true;
+                default:
+                    return false;
+            }
+        });
+    }
+
+    /**
+     * Replaces `loop`, which runs at least once, by what it leaves behind, adding the replacement to `code`.
+     * Carried names with a value in `finals` are assigned it; the others keep their yield, which is either their
+     * own Phi (so they keep their initial value) or a value from outside the loop.
+     */
+    void replace_loop(Function &function, ValueId loop, const std::vector<std::optional<std::int64_t>> &finals,
+                      std::vector<ValueId> &code) {
+        // copies, since adding instructions moves them
+        const Instr instr = function[loop];
+        const tcomp::ir::Block body = function.blocks[instr.body];
+        std::vector<std::pair<ValueId, ValueId>> replacements;
+        for (std::size_t i = 0; i < body.params.size(); ++i) {
+            if (!finals[i]) {
+                replacements.emplace_back(instr.results[i], body.yields[i] == body.params[i] ? instr.operands[i] : body.yields[i]);
+                continue;
+            }
+            const std::int32_t slot = function[body.params[i]].slot;
+            const ValueId integer = function.add(Instr{.op = Opcode::Integer, .type = Type::Integer, .integer = *finals[i], .origin = instr.origin});
+            const ValueId produce = function.add(Instr{
+                .op = Opcode::Produce, .type = Type::State, .operands = {integer}, .slot = slot, .origin = instr.origin
+            });
+            code.push_back(integer);
+            code.push_back(produce);
+            replacements.emplace_back(instr.results[i], produce);
+        }
+        for (const auto &[result, replacement] : replacements) {
+            function.replace_uses(result, replacement);
+        }
+    }
+
+    /**
+     * @class Polynomial
+     * @brief An integer-valued polynomial in the iteration number k, as its coefficients in the binomial basis.
+     *
+     * p(k) = c[0] + c[1] * C(k, 1) + c[2] * C(k, 2) + ..., so the coefficients are p's forward differences at 0
+     * and stay integers, and the sum of p over the iterations before k is the same list shifted by one. All
+     * arithmetic is checked; anything that would overflow an int64 is reported as nothing.
+     */
+    class Polynomial {
+    public:
+        static constexpr std::size_t MAX_DEGREE = 3;
+
+        Polynomial() = default;
+        explicit Polynomial(std::int64_t constant) : coefficients{constant} {}
+
+        /// k itself counting down from `first`: the loop counter
+        static Polynomial countdown(std::int64_t first) {
+            Polynomial result;
+            result.coefficients = {first, -1};
+            return result;
+        }
+
+        [[nodiscard]] std::size_t degree() const { return this->coefficients.size() - 1; }
+
+        /// p(k)
+        [[nodiscard]] std::optional<std::int64_t> at(std::int64_t k) const {
+            std::int64_t value = 0, binomial = 1;
+            for (std::size_t j = 0; j < this->coefficients.size(); ++j) {
+                if (j > 0) {
+                    // C(k, j) = C(k, j - 1) * (k - j + 1) / j, which divides exactly
+                    if (__builtin_mul_overflow(binomial, k - static_cast<std::int64_t>(j) + 1, &binomial)) return std::nullopt;
+                    binomial /= static_cast<std::int64_t>(j);
+                }
+                std::int64_t term;
+                if (__builtin_mul_overflow(this->coefficients[j], binomial, &term) || __builtin_add_overflow(value, term, &value)) {
+                    return std::nullopt;
+                }
+            }
+            return value;
+        }
+
+        /// The least and greatest of p(0), ..., p(last)
+        [[nodiscard]] std::optional<std::pair<std::int64_t, std::int64_t>> bounds(std::int64_t last) const {
+            // between two critical points p is monotonic, so its extremes on the integers are at the ends or next to them
+            std::vector<std::int64_t> candidates = {0, last};
+            const long double c1 = this->coefficient(1), c2 = this->coefficient(2), c3 = this->coefficient(3);
+            // p'(k) = a1 + 2 a2 k + 3 a3 k^2 once the binomials are multiplied out
+            const long double a1 = c1 - c2 / 2 + c3 / 3, a2 = c2 / 2 - c3 / 2, a3 = c3 / 6;
+            std::vector<long double> roots;
+            if (a3 != 0) {
+                const long double discriminant = 4 * a2 * a2 - 12 * a3 * a1;
+                if (discriminant >= 0) {
+                    roots.push_back((-2 * a2 + std::sqrt(discriminant)) / (6 * a3));
+                    roots.push_back((-2 * a2 - std::sqrt(discriminant)) / (6 * a3));
+                }
+            } else if (a2 != 0) {
+                roots.push_back(-a1 / (2 * a2));
+            }
+            for (const long double root : roots) {
+                if (!(root > -2) || !(root < static_cast<long double>(last) + 2)) continue;
+                const auto near = static_cast<std::int64_t>(std::floor(root));
+                for (std::int64_t k = near - 1; k <= near + 2; ++k) {
+                    if (k >= 0 && k <= last) candidates.push_back(k);
+                }
+            }
+
+            std::pair<std::int64_t, std::int64_t> result = {INT64_MAX, INT64_MIN};
+            for (const std::int64_t k : candidates) {
+                const auto value = this->at(k);
+                if (!value) return std::nullopt;
+                result = {std::min(result.first, *value), std::max(result.second, *value)};
+            }
+            return result;
+        }
+
+        [[nodiscard]] static std::optional<Polynomial> add(const Polynomial &lhs, const Polynomial &rhs, std::int64_t sign = 1) {
+            Polynomial result;
+            result.coefficients.assign(std::max(lhs.coefficients.size(), rhs.coefficients.size()), 0);
+            for (std::size_t j = 0; j < result.coefficients.size(); ++j) {
+                std::int64_t term;
+                if (__builtin_mul_overflow(rhs.coefficient(j), sign, &term) ||
+                    __builtin_add_overflow(lhs.coefficient(j), term, &result.coefficients[j])) {
+                    return std::nullopt;
+                }
+            }
+            return result;
+        }
+
+        [[nodiscard]] static std::optional<Polynomial> multiply(const Polynomial &lhs, const Polynomial &rhs) {
+            const std::size_t degree = lhs.degree() + rhs.degree();
+            if (degree > MAX_DEGREE) return std::nullopt;
+
+            // multiply the values at 0..degree, then take their forward differences
+            std::vector<std::int64_t> values;
+            for (std::size_t k = 0; k <= degree; ++k) {
+                const auto a = lhs.at(static_cast<std::int64_t>(k)), b = rhs.at(static_cast<std::int64_t>(k));
+                std::int64_t product;
+                if (!a || !b || __builtin_mul_overflow(*a, *b, &product)) return std::nullopt;
+                values.push_back(product);
+            }
+            Polynomial result;
+            result.coefficients.clear();
+            for (std::size_t j = 0; j <= degree; ++j) {
+                result.coefficients.push_back(values[0]);
+                for (std::size_t k = 0; k + 1 < values.size(); ++k) {
+                    if (__builtin_sub_overflow(values[k + 1], values[k], &values[k])) return std::nullopt;
+                }
+                values.pop_back();
+            }
+            return result;
+        }
+
+        /// `start` plus the sum of p over the iterations before k
+        [[nodiscard]] std::optional<Polynomial> accumulate(std::int64_t start) const {
+            if (this->degree() + 1 > MAX_DEGREE) return std::nullopt;
+            Polynomial result;
+            result.coefficients = {start};
+            result.coefficients.insert(result.coefficients.end(), this->coefficients.begin(), this->coefficients.end());
+            return result;
+        }
+
+    private:
+        [[nodiscard]] std::int64_t coefficient(std::size_t j) const {
+            return j < this->coefficients.size() ? this->coefficients[j] : 0;
+        }
+
+        std::vector<std::int64_t> coefficients{0};
+    };
+
+    /**
+     * @class ClosedFormLoops
+     * @brief Replaces counting and accumulation loops by the values they leave behind.
+     *
+     * A loop qualifies when its trip count is known, its body only computes `!{...}` with +, - and * (no
+     * output, appends, opaque expressions or inner loops) and leaves the counter alone. Every name it carries
+     * is then either unchanged, or an induction variable whose next value is its current value plus something
+     * already solved (`!{i + 1} => i`, `!{sum + i} => sum`, `!{sum + n} => sum` over the counter n). Induction
+     * variables are polynomials in the iteration number of degree at most Polynomial::MAX_DEGREE.
+     *
+     * The result has to be exactly the interpreter's. Every double the body computes must stay an integer
+     * within 2^53, so the arithmetic is exact, and every value it stores must stay within [0, 2^32), so reading
+     * it back through int_to_binary gives the same number; both are checked over all iterations before the
+     * loop is replaced. The one exception is an accumulator that only adds a non-negative increment to itself
+     * and is read by nothing else: int_to_binary keeps its sum modulo 2^32, which is computed directly (see
+     * wrapping_final). Trip counts that are only known at run time are left to the loop.
+     */
+    class ClosedFormLoops final : public tcomp::ir::Pass {
+    public:
+        /// Longest loop that is summarised, which keeps C(k, MAX_DEGREE) within an int64
+        static constexpr std::int64_t MAX_ITERATIONS = std::int64_t{1} << 40;
+
+        [[nodiscard]] const char *name() const override { return "closed-form"; }
+
+        bool run(Function &function) override {
+            bool changed = false;
+            for (const std::int32_t block : reachable(function)) {
+                std::vector<ValueId> code;
+                for (const ValueId value : function.blocks[block].code) {
+                    if (function[value].op == Opcode::Loop && this->summarise(function, value, code)) {
+                        changed = true;
+                        continue;
+                    }
+                    code.push_back(value);
+                }
+                function.blocks[block].code = std::move(code);
+            }
+            return changed;
+        }
+
+    private:
+        struct Analysis {
+            const Function &function;
+            std::int64_t last;                            // the last iteration number, trip count - 1
+            std::unordered_set<ValueId> inside;           // the body's values and Phis
+            std::unordered_map<ValueId, Polynomial> phis; // the carried values solved so far
+        };
+
+        /// The value of `value` in iteration k, or nothing when it is not a polynomial this pass can prove exact
+        static std::optional<Polynomial> evaluate(Analysis &analysis, ValueId value) {
+            const Function &function = analysis.function;
+            const Instr &instr = function[value];
+            auto within = [&](const std::optional<Polynomial> &polynomial, std::int64_t low, std::int64_t high) -> std::optional<Polynomial> {
+                if (!polynomial) return std::nullopt;
+                const auto range = polynomial->bounds(analysis.last);
+                if (!range || range->first < low || range->second > high) return std::nullopt;
+                return polynomial;
+            };
+
+            if (!analysis.inside.contains(value) && (instr.type == Type::State || instr.type == Type::Array)) {
+                const auto number = known_number(function, value);
+                if (!number || *number != std::floor(*number) || std::abs(*number) > static_cast<double>(EXACT)) return std::nullopt;
+                return Polynomial(static_cast<std::int64_t>(*number));
+            }
+
+            switch (instr.op) {
+                case Opcode::Phi:
+                    if (const auto solved = analysis.phis.find(value); solved != analysis.phis.end()) return solved->second;
+                    return std::nullopt;
+                case Opcode::Constant:
+                    if (instr.constant != std::floor(instr.constant) || std::abs(instr.constant) > static_cast<double>(EXACT)) return std::nullopt;
+                    return Polynomial(static_cast<std::int64_t>(instr.constant));
+                case Opcode::Integer:
+                    return Polynomial(instr.integer);
+                case Opcode::Number:
+                case Opcode::Truncate:
+                    // integers within 2^53 survive both conversions unchanged
+                    return evaluate(analysis, instr.operands[0]);
+                case Opcode::Produce:
+                    return within(evaluate(analysis, instr.operands[0]), 0, STORED - 1);
+                case Opcode::Negate:
+                    if (const auto operand = evaluate(analysis, instr.operands[0])) return Polynomial::add(Polynomial(0), *operand, -1);
+                    return std::nullopt;
+                case Opcode::Add:
+                case Opcode::Sub:
+                case Opcode::Mul: {
+                    const auto lhs = evaluate(analysis, instr.operands[0]), rhs = evaluate(analysis, instr.operands[1]);
+                    if (!lhs || !rhs) return std::nullopt;
+                    return within(instr.op == Opcode::Mul ? Polynomial::multiply(*lhs, *rhs)
+                                                          : Polynomial::add(*lhs, *rhs, instr.op == Opcode::Add ? 1 : -1),
+                                  -EXACT, EXACT);
+                }
+                default:
+                    return std::nullopt;
+            }
+        }
+
+        /// `value` as a * phi + D(k) with D not reading `phi`, for a Number tree or a state read by one
+        static std::optional<std::pair<std::int64_t, Polynomial>> linear(Analysis &analysis, ValueId value, ValueId phi) {
+            const Function &function = analysis.function;
+            const Instr &instr = function[value];
+            if (instr.op == Opcode::Number && instr.operands[0] == phi) {
+                return std::pair{std::int64_t{1}, Polynomial(0)};
+            }
+
+            using Form = std::pair<std::int64_t, Polynomial>;
+            auto combine = [](const Form &lhs, const Form &rhs, std::int64_t sign) -> std::optional<Form> {
+                const auto sum = Polynomial::add(lhs.second, rhs.second, sign);
+                std::int64_t coefficient;
+                if (!sum || __builtin_mul_overflow(rhs.first, sign, &coefficient) || __builtin_add_overflow(lhs.first, coefficient, &coefficient)) {
+                    return std::nullopt;
+                }
+                return Form{coefficient, *sum};
+            };
+
+            switch (instr.op) {
+                case Opcode::Negate:
+                    if (const auto operand = linear(analysis, instr.operands[0], phi)) return combine(Form{0, Polynomial(0)}, *operand, -1);
+                    return std::nullopt;
+                case Opcode::Add:
+                case Opcode::Sub:
+                    if (const auto lhs = linear(analysis, instr.operands[0], phi), rhs = linear(analysis, instr.operands[1], phi); lhs && rhs) {
+                        return combine(*lhs, *rhs, instr.op == Opcode::Add ? 1 : -1);
+                    }
+                    return std::nullopt;
+                case Opcode::Mul: {
+                    auto lhs = linear(analysis, instr.operands[0], phi), rhs = linear(analysis, instr.operands[1], phi);
+                    if (!lhs || !rhs) return std::nullopt;
+                    if (lhs->first == 0) std::swap(lhs, rhs);
+                    // (a * phi + D) * E stays linear in phi only when E is a constant
+                    if (rhs->first != 0 || (lhs->first != 0 && rhs->second.degree() != 0)) return std::nullopt;
+                    const auto product = Polynomial::multiply(lhs->second, rhs->second);
+                    std::int64_t coefficient;
+                    if (!product || __builtin_mul_overflow(lhs->first, rhs->second.at(0).value_or(0), &coefficient)) return std::nullopt;
+                    return Form{coefficient, *product};
+                }
+                default:
+                    if (const auto polynomial = evaluate(analysis, value)) return Form{0, *polynomial};
+                    return std::nullopt;
+            }
+        }
+
+        /// The increment D when `yield` is `!{...}` computing phi + D, with D not reading `phi`
+        static std::optional<Polynomial> increment(Analysis &analysis, ValueId yield, ValueId phi) {
+            const Function &function = analysis.function;
+            if (function[yield].op != Opcode::Produce) return std::nullopt;
+            const Instr &truncate = function[function[yield].operands[0]];
+            if (truncate.op != Opcode::Truncate) return std::nullopt;
+
+            const auto form = linear(analysis, truncate.operands[0], phi);
+            if (!form || form->first != 1) return std::nullopt;
+            return form->second;
+        }
+
+        /**
+         * What an accumulator leaves behind when `yield` is `!{phi + D}` and its values outgrow 32 bits, or nothing.
+         * A non-negative value is stored modulo 2^32, so with `start` and every D(k) non-negative and D(k) small
+         * enough that phi + D stays an exact double, each store holds the exact sum modulo 2^32. `phi` must already
+         * be out of analysis.phis, so that any other read of the wrapped values fails to evaluate.
+         */
+        static std::optional<std::int64_t> wrapping_final(Analysis &analysis, ValueId yield, ValueId phi, ValueId start) {
+            const Function &function = analysis.function;
+            if (function[yield].op != Opcode::Produce) return std::nullopt;
+            const Instr &truncate = function[function[yield].operands[0]];
+            if (truncate.op != Opcode::Truncate || function[truncate.operands[0]].op != Opcode::Add) return std::nullopt;
+
+            const Instr &sum = function[truncate.operands[0]];
+            auto reads_phi = [&](ValueId value) { return function[value].op == Opcode::Number && function[value].operands[0] == phi; };
+            if (!reads_phi(sum.operands[0]) && !reads_phi(sum.operands[1])) return std::nullopt;
+            const auto delta = evaluate(analysis, sum.operands[reads_phi(sum.operands[0]) ? 1 : 0]);
+            const auto range = delta ? delta->bounds(analysis.last) : std::nullopt;
+            if (!range || range->first < 0 || range->second > EXACT - STORED) return std::nullopt;
+
+            const auto initial = evaluate(analysis, start);
+            const auto first = initial ? initial->at(0) : std::nullopt;
+            if (!first || *first < 0 || *first >= STORED) return std::nullopt;
+
+            const auto total = delta->accumulate(*first);
+            const auto final = total ? total->at(analysis.last + 1) : std::nullopt;
+            if (!final) return std::nullopt;
+            return *final % STORED;
+        }
+
+        /// Replaces `loop` by what it leaves behind, adding the replacement to `code`; false if it does not qualify
+        bool summarise(Function &function, ValueId loop, std::vector<ValueId> &code) const {
+            const Instr &instr = function[loop];
+            const tcomp::ir::Block &body = function.blocks[instr.body];
+            const auto count = known_count(function, instr.operands[instr.index]);
+            if (!count || *count <= 0 || *count > MAX_ITERATIONS || !effect_free(function, instr.body) ||
+                body.yields[instr.index] != body.params[instr.index]) {
+                return false;
+            }
+
+            Analysis analysis{.function = function, .last = *count - 1, .inside = {}, .phis = {}};
+            analysis.inside.insert(body.code.begin(), body.code.end());
+            analysis.inside.insert(body.params.begin(), body.params.end());
+            // the counter reads count - 1, ..., 0, which int_to_binary keeps exactly while it fits in 32 bits
+            if (*count <= STORED) {
+                analysis.phis.emplace(body.params[instr.index], Polynomial::countdown(*count - 1));
+            }
+
+            // solve the carried names in dependency order: a name whose increment reads an unsolved one waits for it
+            std::vector<std::size_t> pending;
+            for (std::size_t i = 0; i < body.params.size(); ++i) {
+                if (static_cast<std::int32_t>(i) == instr.index) continue;
+                if (body.yields[i] == body.params[i]) {
+                    if (const auto start = evaluate(analysis, instr.operands[i])) analysis.phis.emplace(body.params[i], *start);
+                    continue;
+                }
+                pending.push_back(i);
+            }
+            for (bool progress = true; progress;) {
+                progress = false;
+                for (auto i = pending.begin(); i != pending.end();) {
+                    const auto start = evaluate(analysis, instr.operands[*i]);
+                    const auto delta = start ? increment(analysis, body.yields[*i], body.params[*i]) : std::nullopt;
+                    const auto solution = delta ? delta->accumulate(start->at(0).value_or(0)) : std::nullopt;
+                    if (!solution) {
+                        ++i;
+                        continue;
+                    }
+                    analysis.phis.emplace(body.params[*i], *solution);
+                    i = pending.erase(i);
+                    progress = true;
+                }
+            }
+
+            // accumulators whose sums leave 32 bits wrap; they are taken out of the solved names first, so that the
+            // loop stays when anything else reads their wrapped values
+            std::vector<std::size_t> wrapping;
+            for (std::size_t i = 0; i < body.params.size(); ++i) {
+                const auto solved = analysis.phis.find(body.params[i]);
+                if (static_cast<std::int32_t>(i) == instr.index || body.yields[i] == body.params[i] || solved == analysis.phis.end()) continue;
+                const auto range = solved->second.bounds(analysis.last + 1);
+                if (!range || range->first < 0 || range->second >= STORED) wrapping.push_back(i);
+            }
+            for (const std::size_t i : wrapping) {
+                analysis.phis.erase(body.params[i]);
+            }
+
+            // what each name holds after the last iteration; evaluating the yields also checks every value they depend on
+            std::vector<std::optional<std::int64_t>> finals(body.params.size());
+            for (std::size_t i = 0; i < body.params.size(); ++i) {
+                const ValueId yield = body.yields[i];
+                if (static_cast<std::int32_t>(i) == instr.index) {
+                    finals[i] = 0;
+                } else if (std::ranges::find(wrapping, i) != wrapping.end()) {
+                    finals[i] = wrapping_final(analysis, yield, body.params[i], instr.operands[i]);
+                    if (!finals[i]) return false;
+                } else if (yield != body.params[i] && analysis.inside.contains(yield)) {
+                    const auto polynomial = evaluate(analysis, yield);
+                    finals[i] = polynomial ? polynomial->at(analysis.last) : std::nullopt;
+                    if (!finals[i]) return false;
+                }
+            }
+            replace_loop(function, loop, finals, code);
+            return true;
+        }
+    };
+
+    /**
+     * @class LinearRecurrences
+     * @brief Computes loops whose names are updated by linear combinations of each other (`!{a + b} => next`,
+     * `!{b} => a`, `!{next} => b`) with O(log n) matrix products instead of n iterations.
+     *
+     * A loop qualifies when its trip count is known and its body only computes `!{...}` with +, - and
+     * multiplication by constants (no output, appends, opaque expressions or inner loops), without reading or
+     * changing the counter. The names it carries are then a state vector x, with a last component that is
+     * always 1 for the constants, and an iteration is x' = M x. T = [[M, 0], [I, I]] takes (x, s) to
+     * (M x, s + x), so T^n (x0, 0) holds both what the names are left with and the sum of every state the loop
+     * went through.
+     *
+     * The interpreter keeps 32 bits of a stored value, so a recurrence that outgrows them wraps around, which
+     * no matrix describes, and such loops stay. To know that no value leaves the exact range without running
+     * the loop, every coefficient and initial value must be non-negative: each value computed in an iteration
+     * is then at most its combination of the summed states, which is checked against 2^53 for doubles and
+     * against 2^32 for stored values. Matrix entries saturate at SATURATED, beyond both bounds, so powers that
+     * grow out of range only matter when they meet a non-zero state.
+     */
+    class LinearRecurrences final : public tcomp::ir::Pass {
+    public:
+        /// Most names a loop may carry besides its counter, which bounds a product at (2 * 33)^3 multiplications
+        static constexpr std::size_t MAX_CARRIED = 32;
+
+        [[nodiscard]] const char *name() const override { return "linear-recurrence"; }
+
+        bool run(Function &function) override {
+            bool changed = false;
+            for (const std::int32_t block : reachable(function)) {
+                std::vector<ValueId> code;
+                for (const ValueId value : function.blocks[block].code) {
+                    if (function[value].op == Opcode::Loop && this->accelerate(function, value, code)) {
+                        changed = true;
+                        continue;
+                    }
+                    code.push_back(value);
+                }
+                function.blocks[block].code = std::move(code);
+            }
+            return changed;
+        }
+
+    private:
+        static constexpr std::int64_t SATURATED = std::int64_t{1} << 61;
+
+        using Vector = std::vector<std::int64_t>;
+        using Matrix = std::vector<Vector>;
+
+        struct Recurrence {
+            const Function &function;
+            std::size_t size;                                  // components of the state, the last one being 1
+            std::unordered_map<ValueId, std::size_t> carried;  // Phi -> its component
+            std::unordered_set<ValueId> inside;                // the body's values and Phis
+            std::unordered_map<ValueId, Vector> forms;         // the values seen so far, as combinations of the state
+        };
+
+        // #[Saturating arithmetic] on non-negative integers: min(SATURATED, the exact result)
+        static std::int64_t add(std::int64_t lhs, std::int64_t rhs) { return std::min(SATURATED, lhs + rhs); }
+
+        static std::int64_t multiply(std::int64_t lhs, std::int64_t rhs) {
+            if (lhs == 0 || rhs == 0) return 0;
+            return lhs > SATURATED / rhs ? SATURATED : lhs * rhs;
+        }
+
+        static std::int64_t dot(const Vector &lhs, const Vector &rhs) {
+            std::int64_t result = 0;
+            for (std::size_t i = 0; i < lhs.size(); ++i) result = add(result, multiply(lhs[i], rhs[i]));
+            return result;
+        }
+
+        static Vector apply(const Matrix &matrix, const Vector &vector) {
+            Vector result;
+            for (const Vector &row : matrix) result.push_back(dot(row, vector));
+            return result;
+        }
+
+        static Matrix square(const Matrix &matrix) {
+            Matrix result(matrix.size(), Vector(matrix.size(), 0));
+            for (std::size_t i = 0; i < matrix.size(); ++i) {
+                for (std::size_t k = 0; k < matrix.size(); ++k) {
+                    if (matrix[i][k] == 0) continue;
+                    for (std::size_t j = 0; j < matrix.size(); ++j) {
+                        result[i][j] = add(result[i][j], multiply(matrix[i][k], matrix[k][j]));
+                    }
+                }
+            }
+            return result;
+        }
+
+        /// `value` as a combination of the state at the top of the iteration, or nothing when it is not one with
+        /// non-negative integer coefficients
+        static std::optional<Vector> form(Recurrence &recurrence, ValueId value) {
+            if (const auto seen = recurrence.forms.find(value); seen != recurrence.forms.end()) return seen->second;
+            const Function &function = recurrence.function;
+            const Instr &instr = function[value];
+            auto constant = [&](double number) -> std::optional<Vector> {
+                if (number != std::floor(number) || number < 0 || number > static_cast<double>(EXACT)) return std::nullopt;
+                Vector result(recurrence.size, 0);
+                result.back() = static_cast<std::int64_t>(number);
+                return result;
+            };
+            auto combine = [](const Vector &lhs, const Vector &rhs, std::int64_t sign) -> std::optional<Vector> {
+                Vector result = lhs;
+                for (std::size_t i = 0; i < result.size(); ++i) {
+                    std::int64_t term;
+                    if (__builtin_mul_overflow(rhs[i], sign, &term) || __builtin_add_overflow(result[i], term, &result[i])) {
+                        return std::nullopt;
+                    }
+                }
+                return result;
+            };
+
+            std::optional<Vector> result;
+            if (!recurrence.inside.contains(value) && instr.type == Type::State) {
+                if (const auto number = known_number(function, value)) result = constant(*number);
+            } else {
+                switch (instr.op) {
+                    case Opcode::Phi:
+                        if (const auto component = recurrence.carried.find(value); component != recurrence.carried.end()) {
+                            result = Vector(recurrence.size, 0);
+                            (*result)[component->second] = 1;
+                        }
+                        break;
+                    case Opcode::Constant:
+                        result = constant(instr.constant);
+                        break;
+                    case Opcode::Integer:
+                        result = constant(static_cast<double>(instr.integer));
+                        break;
+                    case Opcode::Number:
+                    case Opcode::Truncate:
+                    case Opcode::Produce:
+                        // integers within 2^53 survive every conversion unchanged
+                        result = form(recurrence, instr.operands[0]);
+                        break;
+                    case Opcode::Negate:
+                        if (const auto operand = form(recurrence, instr.operands[0])) {
+                            result = combine(Vector(recurrence.size, 0), *operand, -1);
+                        }
+                        break;
+                    case Opcode::Add:
+                    case Opcode::Sub:
+                        if (const auto lhs = form(recurrence, instr.operands[0]), rhs = form(recurrence, instr.operands[1]); lhs && rhs) {
+                            result = combine(*lhs, *rhs, instr.op == Opcode::Add ? 1 : -1);
+                        }
+                        break;
+                    case Opcode::Mul: {
+                        auto lhs = form(recurrence, instr.operands[0]), rhs = form(recurrence, instr.operands[1]);
+                        if (!lhs || !rhs) break;
+                        auto scalar = [](const Vector &vector) {
+                            return std::all_of(vector.begin(), vector.end() - 1, [](std::int64_t c) { return c == 0; });
+                        };
+                        if (!scalar(*rhs)) std::swap(lhs, rhs);
+                        // a combination stays linear only when multiplied by a constant
+                        if (!scalar(*rhs)) break;
+                        result = Vector(recurrence.size, 0);
+                        for (std::size_t i = 0; i < result->size(); ++i) {
+                            if (__builtin_mul_overflow((*lhs)[i], rhs->back(), &(*result)[i])) return std::nullopt;
+                        }
+                        break;
+                    }
+                    default:
+                        break;
+                }
+            }
+            if (!result || std::ranges::any_of(*result, [](std::int64_t c) { return c < 0; })) return std::nullopt;
+            recurrence.forms.emplace(value, *result);
+            return result;
+        }
+
+        /// Replaces `loop` by what it leaves behind, adding the replacement to `code`; false if it does not qualify
+        static bool accelerate(Function &function, ValueId loop, std::vector<ValueId> &code) {
+            const Instr &instr = function[loop];
+            const tcomp::ir::Block &body = function.blocks[instr.body];
+            const auto count = known_count(function, instr.operands[instr.index]);
+            if (!count || *count <= 0 || body.params.size() > MAX_CARRIED + 1 || !effect_free(function, instr.body) ||
+                body.yields[instr.index] != body.params[instr.index]) {
+                return false;
+            }
+
+            // every carried name but the counter is a component; the counter's Phi has none, so reading it fails
+            Recurrence recurrence{.function = function, .size = 0, .carried = {}, .inside = {}, .forms = {}};
+            recurrence.inside.insert(body.code.begin(), body.code.end());
+            recurrence.inside.insert(body.params.begin(), body.params.end());
+            std::vector<std::size_t> positions;
+            for (std::size_t i = 0; i < body.params.size(); ++i) {
+                if (static_cast<std::int32_t>(i) == instr.index) continue;
+                recurrence.carried.emplace(body.params[i], positions.size());
+                positions.push_back(i);
+            }
+            const std::size_t size = recurrence.size = positions.size() + 1;
+
+            // the initial state and one iteration, M; a component that is not known must never be read
+            Vector initial(size, 0);
+            Matrix step(size, Vector(size, 0));
+            std::vector<bool> unknown(size, false);
+            initial.back() = 1;
+            step.back().back() = 1;
+            for (std::size_t c = 0; c < positions.size(); ++c) {
+                const std::size_t i = positions[c];
+                const auto start = form(recurrence, instr.operands[i]);
+                if (start) initial[c] = start->back();
+                unknown[c] = !start;
+
+                const ValueId yield = body.yields[i];
+                if (yield == body.params[i]) {
+                    step[c][c] = 1;
+                } else if (const auto next = form(recurrence, yield)) {
+                    step[c] = *next;
+                } else if (recurrence.inside.contains(yield)) {
+                    return false;
+                } else {
+                    unknown[c] = true;
+                }
+            }
+            for (const auto &[value, combination] : recurrence.forms) {
+                for (std::size_t c = 0; c < size; ++c) {
+                    if (unknown[c] && combination[c] != 0) return false;
+                }
+            }
+
+            // T^count (x0, 0) by repeated squaring; powers of T commute, so applying them in any order is the same
+            Matrix both(2 * size, Vector(2 * size, 0));
+            for (std::size_t c = 0; c < size; ++c) {
+                std::copy(step[c].begin(), step[c].end(), both[c].begin());
+                both[size + c][c] = 1;
+                both[size + c][size + c] = 1;
+            }
+            Vector state(2 * size, 0);
+            std::copy(initial.begin(), initial.end(), state.begin());
+            for (std::int64_t n = *count; n > 0; n >>= 1) {
+                if (n & 1) state = apply(both, state);
+                if (n > 1) both = square(both);
+            }
+            const Vector last(state.begin(), state.begin() + static_cast<std::ptrdiff_t>(size));
+
+            // what each component is at most in any iteration: the sum of its states, or for one that is a constant
+            // from the first or the second iteration on, the larger of the two
+            Vector highest(state.begin() + static_cast<std::ptrdiff_t>(size), state.end());
+            for (std::size_t c = 0; c < size; ++c) {
+                const bool constant = std::all_of(step[c].begin(), step[c].end() - 1, [](std::int64_t e) { return e == 0; });
+                if (step[c][c] == 1 && std::accumulate(step[c].begin(), step[c].end(), std::int64_t{0}) == 1) {
+                    highest[c] = initial[c];
+                } else if (constant) {
+                    highest[c] = std::max(initial[c], step[c].back());
+                }
+            }
+
+            // so every value of every iteration is at most its combination of those
+            for (const auto &[value, combination] : recurrence.forms) {
+                if (!recurrence.inside.contains(value)) continue;
+                const std::int64_t bound = dot(combination, highest);
+                if (bound > EXACT || (function[value].op == Opcode::Produce && bound >= STORED)) return false;
+            }
+
+            std::vector<std::optional<std::int64_t>> finals(body.params.size());
+            finals[instr.index] = 0;
+            for (std::size_t c = 0; c < positions.size(); ++c) {
+                const std::size_t i = positions[c];
+                if (body.yields[i] != body.params[i] && recurrence.inside.contains(body.yields[i])) finals[i] = last[c];
+            }
+            replace_loop(function, loop, finals, code);
+            return true;
+        }
+    };
+}
+
+tcomp::ir::PassManager::PassManager(int level) {
+    if (level >= 1) {
+        this->add(constant_folding());
+    }
+    if (level >= 2) {
+        this->add(loop_invariant_code_motion());
+    }
+    if (level >= 3) {
+        this->add(closed_form_loops());
+        this->add(linear_recurrences());
+    }
+    if (level >= 1) {
+        this->add(dead_code_elimination());
+    }
+}
+
+void tcomp::ir::PassManager::add(std::unique_ptr<Pass> pass) {
+    this->passes.push_back(std::move(pass));
+}
+
+void tcomp::ir::PassManager::run(Function &function) const {
+    for (int round = 0; round < MAX_ROUNDS; ++round) {
+        bool changed = false;
+        for (const auto &pass : this->passes) {
+            changed |= pass->run(function);
+        }
+        if (!changed) return;
+    }
+}
+
+std::unique_ptr<tcomp::ir::Pass> tcomp::ir::constant_folding() {
+    return std::make_unique<ConstantFolding>();
+}
+
+std::unique_ptr<tcomp::ir::Pass> tcomp::ir::loop_invariant_code_motion() {
+    return std::make_unique<LoopInvariantCodeMotion>();
+}
+
+std::unique_ptr<tcomp::ir::Pass> tcomp::ir::closed_form_loops() {
+    return std::make_unique<ClosedFormLoops>();
+}
+
+std::unique_ptr<tcomp::ir::Pass> tcomp::ir::linear_recurrences() {
+    return std::make_unique<LinearRecurrences>();
+}
+
+std::unique_ptr<tcomp::ir::Pass> tcomp::ir::dead_code_elimination() {
+    return std::make_unique<DeadCodeElimination>();
+}
+
+tcomp::vm::Program tcomp::ir::optimize(const vm::Program &program, int level) {
+    if (level <= 0) {
+        return program;
+    }
+    try {
+        Function function = build(program);
+        PassManager(level).run(function);
+        return lower(function);
+    } catch (const std::invalid_argument &) {
+        return program;
+    }
+}
+
+std::optional<int> tcomp::ir::run(const CompiledScript &script, int level, std::ostream &out) {
+    if (!script.error_pack.errors.empty()) {
+        return std::nullopt;
+    }
+
+    vm::Program program;
+    try {
+        program = optimize(vm::compile(script.program), level);
+    } catch (const std::logic_error &) {
+        return std::nullopt;  // collections and anything else the compiler does not take
+    }
+
+    // the lane machine reports runtime errors with the tree walker's messages, so a failing run ends here as well
+    vm::LaneMachine machine(program, 1, {});
+    machine.S_output(out);
+    const std::vector<vm::LaneResult> results = machine.run();
+    out << std::flush;
+    return results[0].ok ? 0 : 1;
+}
+
+int tcomp::ir::dump(const Options &options, std::ostream &out) {
+    std::ifstream file;
+    if (options.input != "-") {
+        file.open(options.input);
+        if (!file.is_open()) {
+            out << "File not found" << std::endl;
+            return 1;
+        }
+    }
+
+    auto script = tcomp::compile(options.input == "-" ? std::cin : file, options.input, options.max_error_count);
+    if (!script->error_pack.errors.empty()) {
+        return tcomp::run(*script, options.input, out);
+    }
+
+    try {
+        Function function = build(vm::compile(script->program));
+        const PassManager passes(options.opt_level);
+        passes.run(function);
+
+        out << "; " << options.input << " at -O" << options.opt_level;
+        for (const auto &pass : passes.G_passes()) out << ' ' << pass->name();
+        out << '\n';
+        print(function, out);
+    } catch (const std::logic_error &e) {
+        out << "Cannot build the IR of " << options.input << ": " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,194 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <unordered_map>
+
+#include "headers/ast.h"
+#include "headers/tools.h"
+#include "headers/stats.h"
+#include "headers/profile.h"
+
+tcomp::profile::Profiler::Profiler() {
+    this->entries.emplace_back();  // the root, which only collects its children's time
+}
+
+void tcomp::profile::Profiler::enter(AST *node) {
+    const std::size_t parent = this->stack.empty() ? 0 : this->stack.back().entry;
+
+    std::size_t entry;
+    if (auto it = this->entries[parent].children.find(node); it != this->entries[parent].children.end()) {
+        entry = it->second;
+    } else {
+        entry = this->entries.size();
+        this->entries[parent].children.emplace(node, entry);
+        Entry &created = this->entries.emplace_back();
+        created.node = node;
+        created.parent = parent;
+    }
+
+    this->stack.push_back(Frame{entry, std::chrono::steady_clock::now(), 0, tcomp::stats::thread_allocations(), 0});
+}
+
+void tcomp::profile::Profiler::leave() {
+    const Frame frame = this->stack.back();
+    this->stack.pop_back();
+
+    const auto elapsed = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - frame.start).count());
+    const std::uint64_t allocations = tcomp::stats::thread_allocations() - frame.allocations_start;
+
+    Entry &entry = this->entries[frame.entry];
+    ++entry.count;
+    entry.inclusive_ns += elapsed;
+    entry.exclusive_ns += elapsed - std::min(elapsed, frame.children_ns);
+    entry.inclusive_allocations += allocations;
+    entry.exclusive_allocations += allocations - std::min(allocations, frame.children_allocations);
+
+    if (!this->stack.empty()) {
+        this->stack.back().children_ns += elapsed;
+        this->stack.back().children_allocations += allocations;
+    } else {
+        this->entries[0].inclusive_ns += elapsed;
+        this->entries[0].inclusive_allocations += allocations;
+    }
+}
+
+void tcomp::profile::Profiler::write_hotspots(std::ostream &out, std::size_t limit) const {
+    struct Statement {
+        AST *node;
+        std::uint64_t count = 0;
+        std::uint64_t inclusive_ns = 0;
+        std::uint64_t exclusive_ns = 0;
+        std::uint64_t exclusive_allocations = 0;
+    };
+
+    // a statement can only appear once on a path (there is no recursion), so summing paths never double counts
+    std::unordered_map<AST *, Statement> statements;
+    for (std::size_t i = 1; i < this->entries.size(); ++i) {
+        const Entry &entry = this->entries[i];
+        Statement &statement = statements.try_emplace(entry.node, Statement{entry.node}).first->second;
+        statement.count += entry.count;
+        statement.inclusive_ns += entry.inclusive_ns;
+        statement.exclusive_ns += entry.exclusive_ns;
+        statement.exclusive_allocations += entry.exclusive_allocations;
+    }
+
+    std::vector<Statement> sorted;
+    sorted.reserve(statements.size());
+    for (const auto &[node, statement] : statements) {
+        sorted.push_back(statement);
+    }
+    std::ranges::sort(sorted, [](const Statement &a, const Statement &b) {
+        if (a.exclusive_ns != b.exclusive_ns) return a.exclusive_ns > b.exclusive_ns;
+        if (a.node->getLine() != b.node->getLine()) return a.node->getLine() < b.node->getLine();
+        return a.node->getColumn() < b.node->getColumn();
+    });
+
+    const double total_ns = static_cast<double>(std::max<std::uint64_t>(this->entries[0].inclusive_ns, 1));
+
+    std::ostringstream table;
+    table << std::fixed << std::setprecision(3);
+    table << std::right << std::setw(8) << "excl %" << std::setw(12) << "excl ms" << std::setw(12) << "incl ms"
+          << std::setw(12) << "count";
+    if (tcomp::stats::tracks_allocations()) {
+        table << std::setw(12) << "allocs/run";
+    }
+    table << "  " << std::left << std::setw(10) << "line:col" << "statement\n";
+
+    for (std::size_t i = 0; i < sorted.size() && i < limit; ++i) {
+        const Statement &statement = sorted[i];
+        const std::string location = std::to_string(statement.node->getLine()) + ":" + std::to_string(statement.node->getColumn());
+
+        table << std::right << std::setprecision(1) << std::setw(8) << 100.0 * static_cast<double>(statement.exclusive_ns) / total_ns
+              << std::setprecision(3) << std::setw(12) << static_cast<double>(statement.exclusive_ns) / 1e6
+              << std::setw(12) << static_cast<double>(statement.inclusive_ns) / 1e6
+              << std::setw(12) << statement.count;
+        if (tcomp::stats::tracks_allocations()) {
+            table << std::setprecision(1) << std::setw(12)
+                  << static_cast<double>(statement.exclusive_allocations) / static_cast<double>(std::max<std::uint64_t>(statement.count, 1))
+                  << std::setprecision(3);
+        }
+        table << "  " << std::left << std::setw(10) << location << describe(statement.node) << '\n';
+    }
+
+    out << table.str() << std::flush;
+}
+
+void tcomp::profile::Profiler::write_collapsed(std::ostream &out, const std::string &root) const {
+    // frames are separated by ';' and the count by the last space, so neither may appear inside a frame name
+    auto frame_name = [](std::string name) {
+        std::ranges::replace(name, ';', ',');
+        std::ranges::replace(name, ' ', '_');
+        return name;
+    };
+
+    std::vector<std::string> paths(this->entries.size());
+    paths[0] = frame_name(root);
+
+    std::ostringstream folded;
+    // entries are created after their parent, so one forward pass sees every parent's path first
+    for (std::size_t i = 1; i < this->entries.size(); ++i) {
+        const Entry &entry = this->entries[i];
+        paths[i] = paths[entry.parent] + ";" + frame_name(
+            describe(entry.node) + "@" + std::to_string(entry.node->getLine()) + ":" + std::to_string(entry.node->getColumn()));
+
+        if (entry.exclusive_ns > 0) {
+            folded << paths[i] << ' ' << entry.exclusive_ns << '\n';
+        }
+    }
+
+    out << folded.str() << std::flush;
+}
+
+std::string tcomp::profile::describe(AST *node) {
+    WhichVisitor which_visitor;
+    node->accept(&which_visitor);
+    const std::string &kind = which_visitor.visitor_type_name;
+
+    if (kind == "ExprVariableNode") {
+        VariableValueGetterVisitor visitor("", tc_Bitset("0"));
+        node->accept(&visitor);
+        std::string bits = visitor.getValue().get_bits();
+        std::ranges::replace(bits, '1', '+');
+        std::ranges::replace(bits, '0', '-');
+        return "[" + bits + "] => " + visitor.getName();
+    }
+    if (kind == "StmtOutputNode") {
+        OutputGetterVisitor visitor;
+        node->accept(&visitor);
+        return (visitor.getOutputAsNormal() ? "<<@ " : "<< ") + visitor.getName();
+    }
+    if (kind == "StmtArrayNode") {
+        ArrayNameManagementVisitor visitor;
+        node->accept(&visitor);
+
+        std::string sources;
+        for (const auto &child : node->getChildren()) {
+            IdentifierNameGetterVisitor source_visitor;
+            child->accept(&source_visitor);
+            sources += (sources.empty() ? "" : ", ") + source_visitor.getName();
+        }
+        return "<" + sources + "> => " + visitor.getName();
+    }
+    if (kind == "StmtLoopNode") {
+        LoopIterationCountGetterVisitor visitor;
+        node->accept(&visitor);
+        return "(:" + visitor.getName() + " ${...})";
+    }
+    if (kind == "ExprEvaluateNode") {
+        EvaluateNodeExpressionGetterVisitor visitor;
+        node->accept(&visitor);
+
+        IdentifierNameGetterVisitor target_visitor;
+        if (!node->getChildren().empty()) {
+            node->getChildren()[0]->accept(&target_visitor);
+        }
+        return "!{" + asmfmt::rformat(visitor.getExpression(), visitor.getVariables()) + "} => " + target_visitor.getName();
+    }
+    return kind;
+}
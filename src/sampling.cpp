@@ -0,0 +1,202 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include <functional>
+#include <cerrno>
+
+#if !defined(_WIN32)
+    #include <csignal>
+    #include <sys/time.h>
+#endif
+
+#include "headers/ast.h"
+#include "headers/profile.h"
+#include "headers/sampling.h"
+
+tcomp::sampling::Published tcomp::sampling::published;
+
+namespace {
+    std::atomic<tcomp::sampling::Sampler *> active_sampler{nullptr};
+
+#if !defined(_WIN32)
+    struct sigaction previous_action{};
+
+    void on_sample(int) {
+        const int saved_errno = errno;
+        if (tcomp::sampling::Sampler *sampler = active_sampler.load(std::memory_order_relaxed)) {
+            sampler->record();
+        }
+        errno = saved_errno;
+    }
+#endif
+}
+
+tcomp::sampling::Sampler::Sampler(const std::shared_ptr<ProgramNode> &program, unsigned frequency) : frequency(std::max(frequency, 1u)) {
+    // every statement is a child of the program or of a loop
+    std::function<void(const std::shared_ptr<AST> &)> collect = [&](const std::shared_ptr<AST> &node) {
+        for (const auto &child : node->getChildren()) {
+            this->statements.push_back(child.get());
+            WhichVisitor which_visitor;
+            child->accept(&which_visitor);
+            if (which_visitor.visitor_type_name == "StmtLoopNode") {
+                collect(child);
+            }
+        }
+    };
+    collect(program);
+    std::ranges::sort(this->statements);
+
+    this->hits = std::make_unique<std::atomic<std::uint64_t>[]>(this->statements.size());
+    this->loop_hits = std::make_unique<std::atomic<std::uint64_t>[]>(this->statements.size());
+}
+
+tcomp::sampling::Sampler::~Sampler() {
+    this->stop();
+}
+
+std::ptrdiff_t tcomp::sampling::Sampler::find(const AST *node) const noexcept {
+    const auto it = std::lower_bound(this->statements.begin(), this->statements.end(), node);
+    return it != this->statements.end() && *it == node ? it - this->statements.begin() : -1;
+}
+
+void tcomp::sampling::Sampler::record() noexcept {
+    this->total.fetch_add(1, std::memory_order_relaxed);
+
+    const std::ptrdiff_t current = this->find(published.statement.load(std::memory_order_relaxed));
+    if (current < 0) {
+        this->outside.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    this->hits[current].fetch_add(1, std::memory_order_relaxed);
+
+    const std::uint32_t depth = std::min<std::uint32_t>(published.depth.load(std::memory_order_relaxed), MAX_LOOP_DEPTH);
+    std::atomic_signal_fence(std::memory_order_acquire);
+    for (std::uint32_t i = 0; i < depth; ++i) {
+        if (const std::ptrdiff_t loop = this->find(published.loops[i].load(std::memory_order_relaxed)); loop >= 0) {
+            this->loop_hits[loop].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+#if !defined(_WIN32)
+
+bool tcomp::sampling::Sampler::start() {
+    Sampler *expected = nullptr;
+    if (!active_sampler.compare_exchange_strong(expected, this)) {
+        return false;
+    }
+
+    struct sigaction action{};
+    action.sa_handler = on_sample;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    const long interval_us = std::max(1000000L / static_cast<long>(this->frequency), 1L);
+    itimerval timer{};
+    timer.it_interval.tv_sec = interval_us / 1000000;
+    timer.it_interval.tv_usec = interval_us % 1000000;
+    timer.it_value = timer.it_interval;
+
+    if (sigaction(SIGPROF, &action, &previous_action) != 0) {
+        active_sampler.store(nullptr);
+        return false;
+    }
+    if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+        sigaction(SIGPROF, &previous_action, nullptr);
+        active_sampler.store(nullptr);
+        return false;
+    }
+
+    this->running = true;
+    return true;
+}
+
+void tcomp::sampling::Sampler::stop() {
+    if (!this->running) {
+        return;
+    }
+
+    itimerval disarm{};
+    setitimer(ITIMER_PROF, &disarm, nullptr);
+    sigaction(SIGPROF, &previous_action, nullptr);
+    active_sampler.store(nullptr);
+    this->running = false;
+}
+
+#else
+
+bool tcomp::sampling::Sampler::start() {
+    return false;
+}
+
+void tcomp::sampling::Sampler::stop() {}
+
+#endif
+
+void tcomp::sampling::Sampler::write_report(std::ostream &out) const {
+    const std::uint64_t total = this->total.load();
+    const double percent = total ? 100.0 / static_cast<double>(total) : 0.0;
+
+    std::ostringstream report;
+    report << std::fixed << std::setprecision(1);
+    report << total << " samples at " << this->frequency << " Hz";
+    if (const std::uint64_t outside = this->outside.load()) {
+        report << " (" << outside << " outside the program)";
+    }
+    report << "\n\n";
+
+    // #[Per line]
+    struct Line {
+        std::uint64_t samples = 0;
+        std::vector<std::string> statements;
+    };
+    std::map<int, Line> lines;
+    for (std::size_t i = 0; i < this->statements.size(); ++i) {
+        if (const std::uint64_t samples = this->hits[i].load()) {
+            Line &line = lines[this->statements[i]->getLine()];
+            line.samples += samples;
+            line.statements.push_back(tcomp::profile::describe(this->statements[i]));
+        }
+    }
+
+    std::vector<std::pair<int, const Line *>> by_samples;
+    for (const auto &[number, line] : lines) {
+        by_samples.emplace_back(number, &line);
+    }
+    std::ranges::stable_sort(by_samples, [](const auto &a, const auto &b) { return a.second->samples > b.second->samples; });
+
+    report << std::right << std::setw(6) << "line" << std::setw(10) << "samples" << std::setw(8) << "%" << "  statements\n";
+    for (const auto &[number, line] : by_samples) {
+        report << std::setw(6) << number << std::setw(10) << line->samples << std::setw(8) << static_cast<double>(line->samples) * percent << "  ";
+        for (std::size_t i = 0; i < line->statements.size(); ++i) {
+            report << (i ? "  " : "") << line->statements[i];
+        }
+        report << '\n';
+    }
+
+    // #[Per loop]
+    std::vector<std::size_t> loops;
+    for (std::size_t i = 0; i < this->statements.size(); ++i) {
+        if (this->loop_hits[i].load()) {
+            loops.push_back(i);
+        }
+    }
+    std::ranges::stable_sort(loops, [&](std::size_t a, std::size_t b) { return this->loop_hits[a].load() > this->loop_hits[b].load(); });
+
+    if (!loops.empty()) {
+        report << '\n' << std::setw(6) << "loop" << std::setw(10) << "samples" << std::setw(8) << "%" << "  (inclusive)\n";
+        for (const std::size_t i : loops) {
+            const std::uint64_t samples = this->loop_hits[i].load();
+            report << std::setw(6) << this->statements[i]->getLine() << std::setw(10) << samples << std::setw(8) << static_cast<double>(samples) * percent
+                   << "  " << tcomp::profile::describe(this->statements[i]) << '\n';
+        }
+    }
+
+    out << report.str() << std::flush;
+}
@@ -10,6 +10,15 @@
 #include <variant>
 #include <unordered_set>
 #include <vector>
+#include <sstream>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <algorithm>
+#include <optional>
+#include <climits>
+#include <cstdint>
 
 
 
@@ -19,6 +28,15 @@
 #include "headers/error.h"
 #include "headers/semantic_analysis.h"
 #include "headers/tools.h"
+#include "headers/bytecode.h"
+#include "headers/stats.h"
+#include "headers/profile.h"
+#include "headers/sampling.h"
+#include "headers/trace.h"
+#include "headers/limits.h"
+#include "headers/jit.h"
+#include "headers/dataflow.h"
+#include "headers/thread_pool.h"
 
 
 // NOTICE ================ MSB needs to be considered for all bit to int conversions
@@ -77,14 +95,727 @@
 }
 
 
+[[nodiscard]] double sem_analysis::evaluate_expression(const std::string &expression) {
+    exprtk::expression<double> expr;
+    exprtk::parser<double> parser;
+
+    tcomp::stats::counters().expression_compilations.fetch_add(1, std::memory_order_relaxed);
+    parser.compile(expression, expr);
+
+    return expr.value();
+}
+
+
+namespace {
+    /// Loops shorter than this are not worth handing to the worker pool
+    constexpr int64_t PARALLEL_LOOP_MIN_ITERATIONS = 64;
+
+    /// A loop is cut into at most this many chunks per worker, so uneven iterations still balance out
+    constexpr std::size_t CHUNKS_PER_WORKER = 4;
+
+    /// The double exprtk reads back from the decimal spelling the interpreter substitutes for `value`
+    double substituted_number(int64_t value) {
+        constexpr int64_t exact_limit = int64_t{1} << 53;
+        if (value > -exact_limit && value < exact_limit) {
+            return static_cast<double>(value);
+        }
+        return sem_analysis::evaluate_expression(std::to_string(value));
+    }
+
+    /// Trace span names
+    std::string loop_label(AST *loop) {
+        return tcomp::profile::describe(loop) + " @" + std::to_string(loop->getLine()) + ":" + std::to_string(loop->getColumn());
+    }
+
+    std::string chunk_label(std::size_t begin, std::size_t end) {
+        return "iterations " + std::to_string(begin) + ".." + std::to_string(end);
+    }
+
+    std::int64_t string_heap_bytes(const std::string &text) {
+        static const std::size_t inline_capacity = std::string().capacity();
+        return text.capacity() > inline_capacity ? static_cast<std::int64_t>(text.capacity() + 1) : 0;
+    }
+
+    /// Memory one symbol table entry occupies: the hash node (approximated as the entry plus two pointers) and
+    /// whatever its name and value keep on the heap
+    std::int64_t footprint(const std::string &name, const SymbolInfo &info) {
+        auto bytes = static_cast<std::int64_t>(sizeof(std::pair<const std::string, SymbolInfo>) + 2 * sizeof(void *))
+                   + string_heap_bytes(name);
+        if (const auto *variable = std::get_if<Variable>(&info)) {
+            bytes += string_heap_bytes(variable->name) + static_cast<std::int64_t>(variable->bitset.heap_bytes());
+        } else if (const auto *array = std::get_if<Array>(&info)) {
+            bytes += static_cast<std::int64_t>(array->variables.capacity() * sizeof(tc_Bitset));
+            for (const tc_Bitset &element : array->variables) {
+                bytes += static_cast<std::int64_t>(element.heap_bytes());
+            }
+        }
+        return bytes;
+    }
+
+    std::int64_t footprint(const std::unordered_map<std::string, SymbolInfo> &symbol_table, const std::string &name) {
+        auto it = symbol_table.find(name);
+        return it == symbol_table.end() ? 0 : footprint(it->first, it->second);
+    }
+}
+
 sem_analysis::SemanticAnalyser::SemanticAnalyser(std::shared_ptr<ProgramNode> program, std::string filename) : program_(std::move(program)), filename(std::move(filename)) {}
 sem_analysis::SemanticAnalyser::SemanticAnalyser(std::shared_ptr<ProgramNode> program, std::unordered_map<std::string, SymbolInfo> symbol_table, std::string filename) : symbol_table(std::move(symbol_table)), program_(std::move(program)), filename(std::move(filename)) {}
 
-sem_analysis::SemanticAnalyser::~SemanticAnalyser() = default;
+sem_analysis::SemanticAnalyser::~SemanticAnalyser() {
+    // workers are analysers too, so publishing here covers every thread's share
+    tcomp::stats::Counters &counters = tcomp::stats::counters();
+    counters.statements.fetch_add(this->executed_statements, std::memory_order_relaxed);
+    counters.loop_iterations.fetch_add(this->executed_iterations, std::memory_order_relaxed);
+
+    if (this->arena) {
+        this->arena->charge(-this->held_bytes);
+    }
+    if (this->budget) {
+        this->allowance.release(*this->budget);
+    }
+}
+
+tcomp::ThreadPool &sem_analysis::SemanticAnalyser::workers() {
+    if (!this->pool) {
+        this->pool = std::make_unique<tcomp::ThreadPool>(this->jobs);
+    }
+    return *this->pool;
+}
+
+const std::unordered_map<std::string, SymbolInfo> &sem_analysis::SemanticAnalyser::G_symbol_table() const {
+    return this->symbol_table;
+}
+
+void sem_analysis::SemanticAnalyser::S_output(std::ostream &out) {
+    this->out = &out;
+}
+
+void sem_analysis::SemanticAnalyser::S_jobs(unsigned jobs) {
+    this->jobs = std::max(jobs, 1u);
+}
+
+void sem_analysis::SemanticAnalyser::S_profiler(tcomp::profile::Profiler *profiler) {
+    this->profiler = profiler;
+}
+
+void sem_analysis::SemanticAnalyser::S_sampling(bool sampling) {
+    this->sampling = sampling;
+}
+
+void sem_analysis::SemanticAnalyser::S_tracer(tcomp::trace::Tracer *tracer) {
+    this->tracer = tracer;
+}
+
+void sem_analysis::SemanticAnalyser::S_budget(tcomp::limits::Budget *budget) {
+    this->budget = budget;
+}
+
+void sem_analysis::SemanticAnalyser::S_jit(tcomp::jit::Cache *jit) {
+    this->jit = jit;
+}
+
+void sem_analysis::SemanticAnalyser::S_arena(tcomp::limits::MemoryArena *arena) {
+    if (this->arena) {
+        this->arena->charge(-this->held_bytes);
+    }
+    this->arena = arena;
+    this->held_bytes = 0;
+    if (arena) {
+        // a worker's copies count too; whether they fit is checked by the first statement that stores anything
+        for (const auto &[name, info] : this->symbol_table) {
+            this->held_bytes += footprint(name, info);
+        }
+        arena->charge(this->held_bytes);
+    }
+}
+
+void sem_analysis::SemanticAnalyser::account(std::int64_t bytes, const AST *node) {
+    if (!this->arena) {
+        return;
+    }
+    this->held_bytes += bytes;
+    if (!this->arena->charge(bytes)) {
+        throw tcomp::limits::LimitExceeded(tcomp::limits::Reason::Memory,
+            "memory limit of " + std::to_string(this->arena->G_max_bytes()) + " bytes exceeded",
+            node ? node->getLine() : 0, node ? node->getColumn() : 0);
+    }
+}
+
+void sem_analysis::SemanticAnalyser::recount(const AST *node) {
+    if (!this->arena) {
+        return;
+    }
+    std::int64_t bytes = 0;
+    for (const auto &[name, info] : this->symbol_table) {
+        bytes += footprint(name, info);
+    }
+    this->account(bytes - this->held_bytes, node);
+}
 
 void sem_analysis::SemanticAnalyser::analyze() {
     // perform semantic analysis on the constructed tree
-    for (std::shared_ptr node : this->program_->getChildren()) {
+    if (this->jobs > 1 && this->execute_parallel(this->program_->getChildren())) {
+        return;
+    }
+    this->execute(this->program_->getChildren());
+}
+
+bool sem_analysis::SemanticAnalyser::execute_parallel(const std::vector<std::shared_ptr<AST>> &nodes) {
+    // workers claim their own steps, so the ones this analyser holds go back first
+    if (this->budget) this->allowance.release(*this->budget);
+
+    const std::vector<Region> regions = build_regions(nodes);
+    if (!has_parallel_loops(regions)) {
+        return false;
+    }
+
+    struct RegionState {
+        std::ostringstream out;
+        std::exception_ptr error;
+        std::size_t pending = 0;
+        bool done = false;
+    };
+
+    std::vector<RegionState> states(regions.size());
+    std::vector<std::vector<std::size_t>> successors(regions.size());
+    for (std::size_t j = 0; j < regions.size(); ++j) {
+        states[j].pending = regions[j].dependencies.size();
+        for (const std::size_t i : regions[j].dependencies) {
+            successors[i].push_back(j);
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::size_t first_failure = regions.size();
+    std::function<void(std::size_t)> launch;
+
+    tcomp::ThreadPool &pool = this->workers();
+
+    launch = [&](std::size_t index) {
+        pool.submit([&, index] {
+            const Region &region = regions[index];
+            RegionState &state = states[index];
+
+            // conflicting regions never run at the same time, so a region can take the symbols it writes
+            // out of the shared table and only needs copies of the ones it merely reads
+            std::unordered_map<std::string, SymbolInfo> symbols;
+            {
+                std::lock_guard lock(mutex);
+                if (index > first_failure) {
+                    state.done = true;
+                    finished.notify_all();
+                    return;
+                }
+                for (const auto &name : region.effects.writes) {
+                    if (auto handle = this->symbol_table.extract(name)) {
+                        symbols.insert(std::move(handle));
+                    }
+                }
+                for (const auto &name : region.effects.reads) {
+                    if (auto it = this->symbol_table.find(name); it != this->symbol_table.end()) {
+                        symbols.emplace(name, it->second);
+                    }
+                }
+            }
+
+            SemanticAnalyser worker(this->program_, std::move(symbols), this->filename);
+            worker.S_output(state.out);
+            worker.S_tracer(this->tracer);
+            worker.S_budget(this->budget);
+            worker.S_arena(this->arena);
+            worker.S_jit(this->jit);
+            try {
+                tcomp::trace::Span region_span(this->tracer, this->tracer ? "region " + std::to_string(index) : std::string(), "region");
+                worker.execute({nodes.begin() + static_cast<std::ptrdiff_t>(region.begin), nodes.begin() + static_cast<std::ptrdiff_t>(region.end)});
+            } catch (...) {
+                state.error = std::current_exception();
+            }
+
+            std::vector<std::size_t> ready;
+            {
+                std::lock_guard lock(mutex);
+                for (const auto &name : region.effects.writes) {
+                    if (auto handle = worker.symbol_table.extract(name)) {
+                        this->symbol_table.insert_or_assign(name, std::move(handle.mapped()));
+                    }
+                }
+                state.done = true;
+                if (state.error) {
+                    // nothing after a failing statement may run, just as in sequential execution
+                    first_failure = std::min(first_failure, index);
+                } else {
+                    for (const std::size_t next : successors[index]) {
+                        if (--states[next].pending == 0) ready.push_back(next);
+                    }
+                }
+            }
+            finished.notify_all();
+
+            for (const std::size_t next : ready) {
+                launch(next);
+            }
+        });
+    };
+
+    for (std::size_t i = 0; i < regions.size(); ++i) {
+        if (states[i].pending == 0) launch(i);
+    }
+
+    // print in program order; every region before a failure has completed by the time the failure is reached
+    for (std::size_t i = 0; i < regions.size(); ++i) {
+        std::unique_lock lock(mutex);
+        finished.wait(lock, [&] { return states[i].done; });
+        *this->out << states[i].out.str() << std::flush;
+
+        if (states[i].error) {
+            lock.unlock();
+            pool.wait();
+            std::rethrow_exception(states[i].error);
+        }
+    }
+
+    pool.wait();
+    this->recount(nullptr);
+    return true;
+}
+
+bool sem_analysis::SemanticAnalyser::execute_parallel_loop(const std::shared_ptr<AST> &loop, const std::string &counter, int64_t iteration_count) {
+    // workers claim their own steps, so the ones this analyser holds go back first
+    if (this->budget) this->allowance.release(*this->budget);
+
+    // counters past 32 bits wrap through int_to_binary, keep those loops sequential
+    if (iteration_count > INT32_MAX) {
+        return false;
+    }
+
+    std::unordered_set<std::string> defined;
+    for (const auto &[name, symbol] : this->symbol_table) {
+        defined.insert(name);
+    }
+
+    const std::optional<LoopPlan> plan = plan_parallel_loop(loop, defined);
+    if (!plan) {
+        return false;
+    }
+
+    auto holds_variable = [this](const std::string &name) {
+        auto it = this->symbol_table.find(name);
+        return it != this->symbol_table.end() && std::holds_alternative<Variable>(it->second);
+    };
+    for (const auto &name : plan->privates) {
+        if (this->symbol_table.contains(name) && !holds_variable(name)) return false;
+    }
+
+    std::vector<tcomp::vm::Expression> folds;
+    std::unordered_map<const AST *, std::size_t> deferred_reductions;
+    for (const auto &reduction : plan->reductions) {
+        for (const auto &input : reduction.inputs) {
+            if (input != counter && !plan->privates.contains(input) && !holds_variable(input)) return false;
+        }
+
+        EvaluateNodeExpressionGetterVisitor visitor;
+        reduction.statement->accept(&visitor);
+        tcomp::vm::Expression &fold = folds.emplace_back();
+        fold.text = visitor.getExpression();
+        tcomp::vm::compile_expression(fold);
+
+        deferred_reductions.emplace(reduction.statement, folds.size() - 1);
+    }
+
+    const auto iterations = static_cast<std::size_t>(iteration_count);
+    const std::size_t chunk_count = std::min<std::size_t>(this->jobs * CHUNKS_PER_WORKER, iterations);
+
+    struct Chunk {
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        std::ostringstream out;
+        std::exception_ptr error;
+        std::vector<std::pair<std::size_t, std::vector<int64_t>>> reduction_inputs;
+        std::unordered_map<std::string, SymbolInfo> privates;
+    };
+
+    std::vector<Chunk> chunks(chunk_count);
+    tcomp::ThreadPool &pool = this->workers();
+
+    for (std::size_t c = 0; c < chunk_count; ++c) {
+        chunks[c].begin = iterations * c / chunk_count;
+        chunks[c].end = iterations * (c + 1) / chunk_count;
+
+        pool.submit([&, c] {
+            Chunk &chunk = chunks[c];
+
+            // nothing writes the shared table while the chunks run, so reading it concurrently is safe
+            std::unordered_map<std::string, SymbolInfo> symbols;
+            for (const auto &name : plan->touched) {
+                if (auto it = this->symbol_table.find(name); it != this->symbol_table.end()) {
+                    symbols.emplace(name, it->second);
+                }
+            }
+
+            SemanticAnalyser worker(this->program_, std::move(symbols), this->filename);
+            worker.S_output(chunk.out);
+            worker.S_tracer(this->tracer);
+            worker.S_budget(this->budget);
+            worker.S_arena(this->arena);
+            worker.S_jit(this->jit);
+            worker.deferred = deferred_reductions;
+
+            try {
+                tcomp::trace::Span chunk_span(this->tracer, this->tracer ? chunk_label(chunk.begin, chunk.end) : std::string(), "chunk");
+                for (std::size_t k = chunk.begin; k < chunk.end; ++k) {
+                    // iteration k sees the counter already decremented, as in the sequential loop
+                    const auto remaining = static_cast<int64_t>(iterations - 1 - k);
+                    worker.symbol_table[counter] = SymbolInfo(Variable(counter, tc_Bitset(int_to_binary(remaining))));
+                    if (worker.budget) worker.allowance.step(*worker.budget);
+                    ++worker.executed_iterations;
+                    worker.execute(loop->getChildren());
+                }
+            } catch (...) {
+                chunk.error = std::current_exception();
+            }
+
+            chunk.reduction_inputs = std::move(worker.deferred_inputs);
+            if (c + 1 == chunk_count) {
+                for (const auto &name : plan->privates) {
+                    if (auto handle = worker.symbol_table.extract(name)) {
+                        chunk.privates.insert(std::move(handle));
+                    }
+                }
+            }
+        });
+    }
+    pool.wait();
+
+    // output in iteration order; a failing iteration ends the loop (and the program) exactly where it would have
+    for (Chunk &chunk : chunks) {
+        *this->out << chunk.out.str();
+        if (chunk.error) {
+            *this->out << std::flush;
+            std::rethrow_exception(chunk.error);
+        }
+    }
+
+    // fold each reduction's recorded updates in iteration order, through the same value round trips as the
+    // sequential loop, so non-associative updates (32-bit truncation, rounding) come out identical
+    std::vector<int64_t> accumulators;
+    std::vector<std::optional<int64_t>> produced(plan->reductions.size());
+    for (const auto &reduction : plan->reductions) {
+        accumulators.push_back(binary_to_int64_t(std::get<Variable>(this->symbol_table[reduction.accumulator]).bitset.get_bits(), true));
+    }
+
+    std::vector<double> values;
+    for (const Chunk &chunk : chunks) {
+        for (const auto &[index, inputs] : chunk.reduction_inputs) {
+            const LoopPlan::Reduction &reduction = plan->reductions[index];
+
+            values.assign(inputs.size(), 0.0);
+            for (std::size_t i = 0; i < inputs.size(); ++i) {
+                values[i] = substituted_number(reduction.inputs[i] == reduction.accumulator ? accumulators[index] : inputs[i]);
+            }
+
+            const auto result = static_cast<int64_t>(tcomp::vm::evaluate_native(folds[index], values));
+            produced[index] = result;
+            accumulators[index] = tcomp::vm::produced_signed(result);
+        }
+    }
+
+    for (std::size_t r = 0; r < plan->reductions.size(); ++r) {
+        if (produced[r]) {
+            const std::string &name = plan->reductions[r].accumulator;
+            this->symbol_table[name] = SymbolInfo(Variable(name, tc_Bitset(int_to_binary(*produced[r]))));
+        }
+    }
+    for (auto &[name, symbol] : chunks.back().privates) {
+        this->symbol_table.insert_or_assign(name, std::move(symbol));
+    }
+    this->symbol_table[counter] = SymbolInfo(Variable(counter, tc_Bitset(int_to_binary(0))));
+    this->recount(loop.get());
+
+    return true;
+}
+
+void sem_analysis::SemanticAnalyser::execute_declared_parallel_loop(const std::shared_ptr<AST> &loop, const std::string &counter, int64_t iteration_count) {
+    // workers claim their own steps, so the ones this analyser holds go back first
+    if (this->budget) this->allowance.release(*this->budget);
+
+    ParallelLoopGetterVisitor parallel_visitor;
+    loop->accept(&parallel_visitor);
+
+    struct Reduction {
+        std::string op;
+        std::string name;
+        int64_t value = 0;
+    };
+
+    // integer reductions wrap instead of overflowing, so partial results combine the same way in any grouping
+    auto combine = [](const std::string &op, int64_t a, int64_t b) -> int64_t {
+        if (op == "sum") return static_cast<int64_t>(static_cast<uint64_t>(a) + static_cast<uint64_t>(b));
+        if (op == "product") return static_cast<int64_t>(static_cast<uint64_t>(a) * static_cast<uint64_t>(b));
+        if (op == "min") return std::min(a, b);
+        if (op == "max") return std::max(a, b);
+        return a ^ b;
+    };
+    // min and max are idempotent, so each iteration may start from the variable's own value; the others start from their identity
+    auto starting_bits = [](const std::string &op, const tc_Bitset &current) {
+        if (op == "sum" || op == "xor") return tc_Bitset("0");
+        if (op == "product") return tc_Bitset(int_to_binary(1));
+        return current;
+    };
+
+    std::vector<Reduction> reductions;
+    for (const auto &[op, name] : parallel_visitor.getReductions()) {
+        auto it = this->symbol_table.find(name);
+        if (it == this->symbol_table.end() || !std::holds_alternative<Variable>(it->second)) {
+            throw std::runtime_error("Reduction variable " + name + " of the loop at " + std::to_string(loop->getLine()) + ":"
+                + std::to_string(loop->getColumn()) + " is not a variable defined before the loop");
+        }
+        reductions.push_back(Reduction{op, name, binary_to_int64_t(std::get<Variable>(it->second).bitset.get_bits(), true)});
+    }
+
+    // counters past 32 bits wrap through int_to_binary; the number of iterations is fixed when the loop starts
+    const auto iterations = static_cast<std::size_t>(std::min<int64_t>(iteration_count, UINT32_MAX));
+    if (iterations == 0) {
+        return;
+    }
+
+    std::unordered_set<std::string> defined;
+    for (const auto &[name, symbol] : this->symbol_table) {
+        defined.insert(name);
+    }
+    const Effects effects = statement_effects(loop, defined);
+    const std::unordered_set<std::string> arrays = array_targets(loop->getChildren());
+
+    std::unordered_map<std::string, SymbolInfo> base;
+    for (const auto *names : {&effects.reads, &effects.writes}) {
+        for (const auto &name : *names) {
+            if (auto it = this->symbol_table.find(name); it != this->symbol_table.end()) {
+                base.emplace(name, it->second);
+            }
+        }
+    }
+    for (const auto &reduction : reductions) {
+        base.emplace(reduction.name, this->symbol_table.at(reduction.name));
+        auto &variable = std::get<Variable>(base.at(reduction.name));
+        variable.bitset = starting_bits(reduction.op, variable.bitset);
+    }
+
+    std::unordered_map<std::string, std::size_t> entry_lengths;
+    for (const auto &name : arrays) {
+        auto it = base.find(name);
+        entry_lengths[name] = it != base.end() && std::holds_alternative<Array>(it->second) ? std::get<Array>(it->second).variables.size() : 0;
+    }
+
+    struct Chunk {
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        std::ostringstream out;
+        std::exception_ptr error;
+        std::vector<std::optional<int64_t>> reductions;
+        std::unordered_map<std::string, std::vector<tc_Bitset>> appended;
+        std::unordered_map<std::string, SymbolInfo> last;  // the final iteration's symbols
+    };
+
+    const std::size_t chunk_count = std::min<std::size_t>(this->jobs * CHUNKS_PER_WORKER, iterations);
+    std::vector<Chunk> chunks(chunk_count);
+
+    auto run_chunk = [&](std::size_t c) {
+        Chunk &chunk = chunks[c];
+        chunk.reductions.assign(reductions.size(), std::nullopt);
+
+        SemanticAnalyser worker(this->program_, {}, this->filename);
+        worker.S_output(chunk.out);
+        worker.S_tracer(this->tracer);
+        worker.S_budget(this->budget);
+        worker.S_arena(this->arena);
+        worker.S_jit(this->jit);
+
+        try {
+            tcomp::trace::Span chunk_span(this->tracer, this->tracer ? chunk_label(chunk.begin, chunk.end) : std::string(), "chunk");
+            for (std::size_t k = chunk.begin; k < chunk.end; ++k) {
+                worker.symbol_table = base;
+                worker.symbol_table[counter] = SymbolInfo(Variable(counter, tc_Bitset(int_to_binary(static_cast<int64_t>(iterations - 1 - k)))));
+                if (worker.budget) worker.allowance.step(*worker.budget);
+                ++worker.executed_iterations;
+                worker.execute(loop->getChildren());
+
+                for (std::size_t r = 0; r < reductions.size(); ++r) {
+                    const int64_t value = binary_to_int64_t(std::get<Variable>(worker.symbol_table.at(reductions[r].name)).bitset.get_bits(), true);
+                    chunk.reductions[r] = chunk.reductions[r] ? combine(reductions[r].op, *chunk.reductions[r], value) : value;
+                }
+
+                for (const auto &name : arrays) {
+                    auto it = worker.symbol_table.find(name);
+                    if (it == worker.symbol_table.end() || !std::holds_alternative<Array>(it->second)) continue;
+
+                    const auto &elements = std::get<Array>(it->second).variables;
+                    auto &appended = chunk.appended[name];
+                    appended.insert(appended.end(), elements.begin() + static_cast<std::ptrdiff_t>(entry_lengths[name]), elements.end());
+                }
+            }
+        } catch (...) {
+            chunk.error = std::current_exception();
+        }
+
+        if (c + 1 == chunk_count) {
+            chunk.last = std::move(worker.symbol_table);
+        }
+    };
+
+    for (std::size_t c = 0; c < chunk_count; ++c) {
+        chunks[c].begin = iterations * c / chunk_count;
+        chunks[c].end = iterations * (c + 1) / chunk_count;
+    }
+
+    if (chunk_count == 1) {
+        run_chunk(0);
+    } else {
+        tcomp::ThreadPool &pool = this->workers();
+        for (std::size_t c = 0; c < chunk_count; ++c) {
+            pool.submit([&, c] { run_chunk(c); });
+        }
+        pool.wait();
+    }
+
+    for (Chunk &chunk : chunks) {
+        *this->out << chunk.out.str();
+        if (chunk.error) {
+            *this->out << std::flush;
+            std::rethrow_exception(chunk.error);
+        }
+    }
+
+    // the last iteration's values for everything it wrote, then reductions and arrays on top
+    for (const auto &name : effects.writes) {
+        if (auto it = chunks.back().last.find(name); it != chunks.back().last.end()) {
+            this->symbol_table.insert_or_assign(name, std::move(it->second));
+        }
+    }
+
+    for (std::size_t r = 0; r < reductions.size(); ++r) {
+        int64_t value = reductions[r].value;
+        for (const Chunk &chunk : chunks) {
+            if (chunk.reductions[r]) value = combine(reductions[r].op, value, *chunk.reductions[r]);
+        }
+        this->symbol_table[reductions[r].name] = SymbolInfo(Variable(reductions[r].name, tc_Bitset(int_to_binary(value))));
+    }
+
+    for (const auto &name : arrays) {
+        Array arr;
+        bool exists = false;
+        if (auto it = base.find(name); it != base.end() && std::holds_alternative<Array>(it->second)) {
+            arr = std::get<Array>(it->second);
+            exists = true;
+        }
+        for (const Chunk &chunk : chunks) {
+            if (auto it = chunk.appended.find(name); it != chunk.appended.end()) {
+                arr.variables.insert(arr.variables.end(), it->second.begin(), it->second.end());
+                exists = true;
+            }
+        }
+        if (exists) {
+            this->symbol_table[name] = SymbolInfo(arr);
+        }
+    }
+
+    this->symbol_table[counter] = SymbolInfo(Variable(counter, tc_Bitset(int_to_binary(0))));
+    this->recount(loop.get());
+}
+
+bool sem_analysis::SemanticAnalyser::execute_native_loop(const tcomp::jit::Loop &native) {
+    const tcomp::vm::Program &program = native.G_program();
+    const std::vector<std::uint8_t> &roles = native.G_roles();
+    tcomp::jit::Frame frame(program.slots.size());
+
+    // everything the loop reads must be a number the generated code holds exactly; anything else stays with the
+    // interpreter, which reports or throws the way it always does
+    for (std::size_t slot = 0; slot < program.slots.size(); ++slot) {
+        auto it = this->symbol_table.find(program.slots[slot]);
+        if (roles[slot] & tcomp::jit::Appended) {
+            if (it != this->symbol_table.end() && !std::holds_alternative<Array>(it->second)) return false;
+            continue;
+        }
+        if (it == this->symbol_table.end()) {
+            if ((roles[slot] & tcomp::jit::Read) && !(roles[slot] & tcomp::jit::Assigned)) return false;
+            continue;
+        }
+        const auto *variable = std::get_if<Variable>(&it->second);
+        if (!variable) {
+            return false;
+        }
+        if (!(roles[slot] & tcomp::jit::Read)) {
+            continue;
+        }
+
+        const std::string &bits = variable->bitset.get_bits();
+        if (bits.empty() || bits.size() > 62) {
+            return false;
+        }
+        constexpr int64_t exact_limit = int64_t{1} << 53;
+        const int64_t value = binary_to_int64_t(bits, true);
+        if (value <= -exact_limit || value >= exact_limit) {
+            return false;
+        }
+        frame.S_number(slot, static_cast<double>(value));
+        if (roles[slot] & tcomp::jit::Counter) {
+            frame.S_count(slot, binary_to_int64_t(bits));
+        }
+    }
+
+    // outputs and array appends run here, after the values they read are written back
+    class Statements final : public tcomp::jit::Runtime {
+    public:
+        Statements(SemanticAnalyser &analyser, const tcomp::vm::Program &program, const tcomp::jit::Frame &frame)
+            : analyser(analyser), program(program), frame(frame) {}
+
+        void write_back(std::int32_t slot) {
+            if (this->frame.dirty(static_cast<std::size_t>(slot))) {
+                const std::string &name = this->program.slots[slot];
+                this->analyser.symbol_table[name] = SymbolInfo(Variable(name, tc_Bitset(int_to_binary(this->frame.produced(static_cast<std::size_t>(slot))))));
+            }
+        }
+
+        void statement(std::int32_t instr) override {
+            const tcomp::vm::Instr &code = this->program.code[instr];
+            if (code.op == tcomp::vm::Op::Output) {
+                this->write_back(code.slot);
+            } else {
+                for (const std::int32_t source : this->program.array_sources[code.operand]) {
+                    this->write_back(source);
+                }
+            }
+            this->analyser.execute({this->program.origins[instr]});
+        }
+
+    private:
+        SemanticAnalyser &analyser;
+        const tcomp::vm::Program &program;
+        const tcomp::jit::Frame &frame;
+    };
+
+    Statements statements(*this, program, frame);
+    native.run(frame, statements);
+
+    for (std::size_t slot = 0; slot < program.slots.size(); ++slot) {
+        statements.write_back(static_cast<std::int32_t>(slot));
+    }
+    this->executed_iterations += frame.G_iterations();
+    this->executed_statements += frame.G_statements();
+
+    if (frame.G_error()) {
+        std::rethrow_exception(frame.G_error());
+    }
+    return true;
+}
+
+void sem_analysis::SemanticAnalyser::execute(const std::vector<std::shared_ptr<AST>> &nodes) {
+    for (const std::shared_ptr<AST> &node : nodes) {
+        ++this->executed_statements;
+        tcomp::profile::Scope profile_scope(this->profiler, node.get());
+        if (this->sampling) {
+            tcomp::sampling::publish_statement(node.get());
+        }
+
         WhichVisitor which_visitor;
         node->accept(&which_visitor);
         if (which_visitor.visitor_type_name == "ExprVariableNode") {
@@ -95,7 +826,9 @@ void sem_analysis::SemanticAnalyser::analyze() {
             tc_Bitset value = visitor.getValue();
 
             Variable var = {name, value};
-            this->symbol_table.emplace(name, SymbolInfo(var));
+            if (auto [it, inserted] = this->symbol_table.emplace(name, SymbolInfo(var)); inserted && this->arena) {
+                this->account(footprint(it->first, it->second), node.get());
+            }
         } else if (which_visitor.visitor_type_name == "StmtOutputNode") {
             OutputGetterVisitor visitor;
             node->accept(&visitor);
@@ -106,9 +839,9 @@ void sem_analysis::SemanticAnalyser::analyze() {
                 Variable var = std::get<Variable>(this->symbol_table[name]);
 
                 if (visitor.getOutputAsNormal()) {
-                    std::cout << binary_to_int64_t(var.bitset.get_bits(), true) << std::endl;
+                    *this->out << binary_to_int64_t(var.bitset.get_bits(), true) << std::endl;
                 } else {
-                    std::cout << var.bitset.get_bits() << std::endl;
+                    *this->out << var.bitset.get_bits() << std::endl;
                 }
 
             } else if (std::holds_alternative<Array>(this->symbol_table[name])) {
@@ -136,7 +869,7 @@ void sem_analysis::SemanticAnalyser::analyze() {
                         constructed_string += binary_to_char(val.get_bits());
                     }
                 }
-                std::cout << constructed_string << '\n';
+                *this->out << constructed_string << '\n';
 
             }
         } else if (which_visitor.visitor_type_name == "StmtArrayNode") {
@@ -168,7 +901,11 @@ void sem_analysis::SemanticAnalyser::analyze() {
              *
              * If we did have the reference, we would not need to overwrite the existing key-value pair
              */
+            const std::int64_t before = this->arena ? footprint(this->symbol_table, name) : 0;
             this->symbol_table[name] = SymbolInfo(arr);
+            if (this->arena) {
+                this->account(footprint(this->symbol_table, name) - before, node.get());
+            }
         } else if (which_visitor.getVisitorTypeName() == "StmtLoopNode")  {
             LoopIterationCountGetterVisitor visitor;
             node->accept(&visitor);
@@ -189,13 +926,39 @@ void sem_analysis::SemanticAnalyser::analyze() {
                 });
             }
 
-            std::shared_ptr<ProgramNode> sub_program = std::make_shared<ProgramNode>();
-            for (auto node_children : node->getChildren()) {
-                sub_program->addChild(node_children);
+            tcomp::sampling::LoopScope sampling_scope(this->sampling, node.get());
+            tcomp::trace::Span loop_span(this->tracer, this->tracer ? loop_label(node.get()) : std::string(), "loop",
+                                         this->tracer ? "\"iterations\":" + std::to_string(iteration_count) : std::string());
+
+            ParallelLoopGetterVisitor parallel_visitor;
+            node->accept(&parallel_visitor);
+            if (parallel_visitor.isParallel()) {
+                this->execute_declared_parallel_loop(node, visitor.getName(), iteration_count);
+                continue;
+            }
+
+            // Tiers: hot loops run as native code; observers and limits watch every iteration, so only unobserved
+            // runs count hotness at all. A loop that is not hot yet is interpreted and counts its back-edges.
+            const bool tiered = this->jit && this->deferred.empty() && !this->profiler && !this->sampling && !this->tracer
+                                && !this->budget && !this->arena;
+            std::uint64_t cold_for = UINT64_MAX;
+            if (tiered) {
+                if (const tcomp::jit::Loop *native = this->jit->enter(node, cold_for); native && this->execute_native_loop(*native)) {
+                    continue;
+                }
             }
 
-            SemanticAnalyser sub_analyser(sub_program, this->symbol_table, this->filename);
-            // Instead of the for loop, use a while loop that refreshes the iteration count.
+            // loops that may still be compiled are left to the back-edge below, where they can switch tiers
+            if (this->jobs > 1 && iteration_count >= PARALLEL_LOOP_MIN_ITERATIONS && (!tiered || cold_for == UINT64_MAX)
+                && this->execute_parallel_loop(node, visitor.getName(), iteration_count)) {
+                continue;
+            }
+
+            // The body runs in place against this symbol table and never modifies the AST, so other threads may
+            // run the same program concurrently.
+            std::uint64_t iteration = 0;
+            std::uint64_t heated = 0;  // back-edges already added to the loop's hotness
+            bool replaced = false;
             while (true) {
                 // Retrieve the iteration count from the symbol table at the beginning of each iteration.
                 auto it = this->symbol_table.find(visitor.getName());
@@ -207,21 +970,62 @@ void sem_analysis::SemanticAnalyser::analyze() {
                 if (iteration_count <= 0) {
                     break;
                 }
+
+                // On-stack replacement: at a back-edge the symbol table is the loop's whole state, so once the loop
+                // turns hot the rest of it runs in the optimised tier, native code or (if it cannot be compiled)
+                // the parallel loop
+                if (iteration == cold_for) {
+                    const tcomp::jit::Loop *native = this->jit->heat(node, iteration - heated);
+                    heated = iteration;
+                    if (native && this->execute_native_loop(*native)) {
+                        replaced = true;
+                    } else if (!native && this->jobs > 1 && iteration_count >= PARALLEL_LOOP_MIN_ITERATIONS
+                               && this->execute_parallel_loop(node, visitor.getName(), iteration_count)) {
+                        replaced = true;
+                    }
+                    if (replaced) {
+                        tcomp::stats::counters().loop_replacements.fetch_add(1, std::memory_order_relaxed);
+                        break;
+                    }
+                    // compiled but holding values native code cannot take yet: look again later
+                    cold_for = native ? iteration + this->jit->G_hot_back_edges() : UINT64_MAX;
+                }
                 iteration_count--;
 
                 // set
-                this->symbol_table[visitor.getName()] = SymbolInfo(Variable(visitor.getName(), tc_Bitset(int_to_binary(iteration_count))));
-                sub_analyser.symbol_table = this->symbol_table;
+                const std::int64_t before = this->arena ? footprint(it->first, it->second) : 0;
+                it->second = SymbolInfo(Variable(visitor.getName(), tc_Bitset(int_to_binary(iteration_count))));
+                if (this->arena) {
+                    this->account(footprint(it->first, it->second) - before, node.get());
+                }
 
-                sub_analyser.analyze();
+                if (this->budget) this->allowance.step(*this->budget);
+                ++this->executed_iterations;
+                const bool traced = this->tracer && this->tracer->trace_iteration(iteration);
+                tcomp::trace::Span iteration_span(traced ? this->tracer : nullptr, traced ? "iteration " + std::to_string(iteration) : std::string(), "iteration");
+                ++iteration;
 
-                this->symbol_table = sub_analyser.symbol_table; // TODO make it take the reference instead of reassigning here
-                this->error_pack.merge(sub_analyser.error_pack);
+                this->execute(node->getChildren());
+            }
+            if (tiered && !replaced && iteration > heated) {
+                (void) this->jit->heat(node, iteration - heated);
             }
 
         } else if (which_visitor.getVisitorTypeName() == "ExprEvaluateNode") {
             EvaluateNodeExpressionGetterVisitor visitor;
             node->accept(&visitor);
+
+            if (!this->deferred.empty()) {
+                if (auto it = this->deferred.find(node.get()); it != this->deferred.end()) {
+                    std::vector<int64_t> inputs;
+                    for (const auto &var : visitor.getVariables()) {
+                        inputs.push_back(binary_to_int64_t(std::get<Variable>(this->symbol_table.at(var)).bitset.get_bits(), true));
+                    }
+                    this->deferred_inputs.emplace_back(it->second, std::move(inputs));
+                    continue;
+                }
+            }
+
             std::string expression = visitor.getExpression();
             auto variables = visitor.getVariables();
             std::vector<std::string> variable_values;
@@ -242,10 +1046,7 @@ void sem_analysis::SemanticAnalyser::analyze() {
 
             expression = asmfmt::rformat(expression, variable_values);
 
-            exprtk::expression<double> expr;
-            exprtk::parser<double> parser;
-
-            parser.compile(expression, expr);
+            const double value = evaluate_expression(expression);
 
             std::shared_ptr<AST> assignToNode = node->getChildren()[0]; // TODO add multi assignment in the future
 
@@ -253,14 +1054,18 @@ void sem_analysis::SemanticAnalyser::analyze() {
             assignToNode->accept(&assignToVisitor);
             std::string assignToName = assignToVisitor.getName();
 
+            const std::int64_t before = this->arena ? footprint(this->symbol_table, assignToName) : 0;
             if (this->symbol_table.contains(assignToName)) {
                 Variable var = std::get<Variable>(this->symbol_table[assignToName]);
-                var.bitset = tc_Bitset(int_to_binary(static_cast<int64_t>(expr.value())));
+                var.bitset = tc_Bitset(int_to_binary(static_cast<int64_t>(value)));
                 this->symbol_table[assignToName] = SymbolInfo(var);
             } else {
-                Variable new_var(assignToName, tc_Bitset(int_to_binary(static_cast<int64_t>(expr.value()))));
+                Variable new_var(assignToName, tc_Bitset(int_to_binary(static_cast<int64_t>(value))));
                 this->symbol_table[assignToName] = SymbolInfo(new_var);
             }
+            if (this->arena) {
+                this->account(footprint(this->symbol_table, assignToName) - before, node.get());
+            }
         }
     }
 }
\ No newline at end of file
@@ -0,0 +1,359 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <new>
+#include <ctime>
+#include <cstdlib>
+#include <chrono>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#if !defined(_WIN32)
+    #include <sys/resource.h>
+#endif
+
+#if defined(__linux__)
+    #include <linux/perf_event.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+#include "headers/ast.h"
+#include "headers/stats.h"
+
+// #[Allocation counting]
+// Replacing the global allocation functions is the portable way to see every allocation the interpreter
+// (and exprtk) makes; the counters are relaxed atomics and cost a few cycles per allocation. Nothing in the
+// tree calls malloc directly, so operator new sees all of them.
+
+namespace {
+    // trivially constructed, so it is safe to touch from allocations made while a thread starts up
+    thread_local constinit std::uint64_t allocations_on_this_thread = 0;
+}
+
+#if defined(TURINGCOMPLETE_ALLOCATION_TRACKING)
+
+void *operator new(std::size_t size) {
+    ++allocations_on_this_thread;
+    tcomp::stats::counters().allocations.fetch_add(1, std::memory_order_relaxed);
+    tcomp::stats::counters().allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    try {
+        return ::operator new(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    return ::operator new(size, std::nothrow);
+}
+
+void operator delete(void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+#endif
+
+tcomp::stats::Counters &tcomp::stats::counters() {
+    // constant-initialised, so it is usable by allocations that happen before main
+    static constinit Counters instance;
+    return instance;
+}
+
+std::uint64_t tcomp::stats::thread_allocations() {
+    return allocations_on_this_thread;
+}
+
+double tcomp::stats::cpu_seconds() {
+#if !defined(_WIN32)
+    timespec now{};
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now) == 0) {
+        return static_cast<double>(now.tv_sec) + static_cast<double>(now.tv_nsec) / 1e9;
+    }
+#endif
+    return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+}
+
+std::uint64_t tcomp::stats::peak_rss_bytes() {
+#if !defined(_WIN32)
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    #if defined(__APPLE__)
+        return static_cast<std::uint64_t>(usage.ru_maxrss);          // bytes
+    #else
+        return static_cast<std::uint64_t>(usage.ru_maxrss) * 1024;   // kilobytes
+    #endif
+    }
+#endif
+    return 0;
+}
+
+std::size_t tcomp::stats::count_nodes(const std::shared_ptr<AST> &node) {
+    std::size_t count = 1;
+    for (const auto &child : node->getChildren()) {
+        count += count_nodes(child);
+    }
+    return count;
+}
+
+// #[Hardware counters]
+
+tcomp::stats::HardwareCounters::~HardwareCounters() {
+#if defined(__linux__)
+    for (const Event &event : this->events) {
+        ::close(event.fd);
+    }
+#endif
+}
+
+std::string tcomp::stats::HardwareCounters::open() {
+#if defined(__linux__)
+    struct Kind {
+        const char *name;
+        std::uint64_t config;
+    };
+    static constexpr Kind kinds[] = {
+        {"cycles", PERF_COUNT_HW_CPU_CYCLES},
+        {"instructions", PERF_COUNT_HW_INSTRUCTIONS},
+        {"branch_misses", PERF_COUNT_HW_BRANCH_MISSES},
+        {"cache_misses", PERF_COUNT_HW_CACHE_MISSES},
+    };
+
+    int error = 0;
+    for (const Kind &kind : kinds) {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = kind.config;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        // user space only, which an unprivileged process may count at the default perf_event_paranoid of 2
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        // threads started later (the parallel workers) count too; grouped reads cannot be combined with this
+        attr.inherit = 1;
+
+        const long fd = ::syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+        if (fd < 0) {
+            error = error != 0 ? error : errno;
+            continue;
+        }
+        this->events.push_back(Event{kind.name, static_cast<int>(fd)});
+    }
+
+    if (this->events.empty()) {
+        std::string reason = std::string("perf_event_open: ") + std::strerror(error);
+        if (error == EACCES || error == EPERM) {
+            reason += " (see /proc/sys/kernel/perf_event_paranoid)";
+        } else if (error == ENOENT || error == EOPNOTSUPP) {
+            reason += " (no hardware PMU, which is common in virtual machines)";
+        }
+        return reason;
+    }
+    return "";
+#else
+    return "hardware counters need Linux perf_event_open";
+#endif
+}
+
+bool tcomp::stats::HardwareCounters::available() const {
+    return !this->events.empty();
+}
+
+std::vector<std::pair<std::string, std::uint64_t>> tcomp::stats::HardwareCounters::read() const {
+    std::vector<std::pair<std::string, std::uint64_t>> values;
+#if defined(__linux__)
+    for (const Event &event : this->events) {
+        std::uint64_t data[3] = {};  // value, time enabled, time running
+        if (::read(event.fd, data, sizeof(data)) != static_cast<ssize_t>(sizeof(data))) {
+            continue;
+        }
+        std::uint64_t value = data[0];
+        if (data[2] == 0) {
+            value = 0;
+        } else if (data[2] < data[1]) {
+            value = static_cast<std::uint64_t>(static_cast<long double>(value) * data[1] / data[2]);
+        }
+        values.emplace_back(event.name, value);
+    }
+#endif
+    return values;
+}
+
+// #[Report]
+
+void tcomp::stats::Report::enable_hardware_counters() {
+    this->hardware_requested = true;
+    this->hardware_error = this->hardware.open();
+}
+
+void tcomp::stats::Report::begin_phase(std::string name) {
+    Phase phase;
+    phase.name = std::move(name);
+    this->phases.push_back(std::move(phase));
+    this->phase_hardware_start = this->hardware.read();
+    this->phase_wall_start = std::chrono::steady_clock::now();
+    this->phase_cpu_start = cpu_seconds();
+    this->phase_allocations_start = counters().allocations.load(std::memory_order_relaxed);
+    this->phase_bytes_start = counters().allocated_bytes.load(std::memory_order_relaxed);
+}
+
+void tcomp::stats::Report::end_phase() {
+    Phase &phase = this->phases.back();
+    phase.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - this->phase_wall_start).count();
+    phase.cpu_seconds = cpu_seconds() - this->phase_cpu_start;
+    phase.allocations = counters().allocations.load(std::memory_order_relaxed) - this->phase_allocations_start;
+    phase.allocated_bytes = counters().allocated_bytes.load(std::memory_order_relaxed) - this->phase_bytes_start;
+
+    for (const auto &[name, value] : this->hardware.read()) {
+        for (const auto &[start_name, start] : this->phase_hardware_start) {
+            if (start_name == name) {
+                phase.hardware.emplace_back(name, value - start);
+            }
+        }
+    }
+}
+
+void tcomp::stats::Report::set(const std::string &name, std::uint64_t value) {
+    for (auto &[key, existing] : this->values) {
+        if (key == name) {
+            existing = value;
+            return;
+        }
+    }
+    this->values.emplace_back(name, value);
+}
+
+const std::vector<tcomp::stats::Phase> &tcomp::stats::Report::G_phases() const {
+    return this->phases;
+}
+
+std::vector<std::pair<std::string, std::uint64_t>> tcomp::stats::Report::totals() const {
+    const Counters &c = counters();
+
+    std::vector<std::pair<std::string, std::uint64_t>> totals = this->values;
+    totals.emplace_back("statements", c.statements.load(std::memory_order_relaxed));
+    totals.emplace_back("loop_iterations", c.loop_iterations.load(std::memory_order_relaxed));
+    totals.emplace_back("expression_compilations", c.expression_compilations.load(std::memory_order_relaxed));
+    totals.emplace_back("native_loops", c.native_loops.load(std::memory_order_relaxed));
+    totals.emplace_back("loop_replacements", c.loop_replacements.load(std::memory_order_relaxed));
+    if (tracks_allocations()) {
+        totals.emplace_back("allocations", c.allocations.load(std::memory_order_relaxed));
+        totals.emplace_back("allocated_bytes", c.allocated_bytes.load(std::memory_order_relaxed));
+    }
+    totals.emplace_back("peak_rss_bytes", peak_rss_bytes());
+    return totals;
+}
+
+void tcomp::stats::Report::write_text(std::ostream &out) const {
+    std::ostringstream table;
+    table << std::fixed << std::setprecision(3);
+
+    table << std::left << std::setw(12) << "phase" << std::right
+          << std::setw(12) << "wall ms" << std::setw(12) << "cpu ms";
+    if (tracks_allocations()) {
+        table << std::setw(12) << "allocs" << std::setw(14) << "alloc bytes";
+    }
+    table << '\n';
+    for (const Phase &phase : this->phases) {
+        table << std::left << std::setw(12) << phase.name << std::right
+              << std::setw(12) << phase.wall_seconds * 1e3 << std::setw(12) << phase.cpu_seconds * 1e3;
+        if (tracks_allocations()) {
+            table << std::setw(12) << phase.allocations << std::setw(14) << phase.allocated_bytes;
+        }
+        table << '\n';
+    }
+
+    if (!this->phases.empty() && !this->phases.front().hardware.empty()) {
+        table << '\n' << std::left << std::setw(12) << "phase" << std::right;
+        for (const auto &[name, value] : this->phases.front().hardware) {
+            table << std::setw(16) << name;
+        }
+        table << std::setw(8) << "IPC" << '\n';
+
+        for (const Phase &phase : this->phases) {
+            std::uint64_t cycles = 0, instructions = 0;
+            table << std::left << std::setw(12) << phase.name << std::right;
+            for (const auto &[name, value] : phase.hardware) {
+                table << std::setw(16) << value;
+                cycles = name == "cycles" ? value : cycles;
+                instructions = name == "instructions" ? value : instructions;
+            }
+            table << std::setprecision(2) << std::setw(8);
+            if (cycles != 0 && instructions != 0) {
+                table << static_cast<double>(instructions) / static_cast<double>(cycles);
+            } else {
+                table << "-";
+            }
+            table << std::setprecision(3) << '\n';
+        }
+    } else if (this->hardware_requested) {
+        table << "\nhardware counters unavailable: " << this->hardware_error << '\n';
+    }
+
+    table << '\n';
+    for (const auto &[name, value] : this->totals()) {
+        table << std::left << std::setw(26) << name << std::right << std::setw(16) << value << '\n';
+    }
+
+    out << table.str() << std::flush;
+}
+
+void tcomp::stats::Report::write_json(std::ostream &out) const {
+    std::ostringstream json;
+    json << std::setprecision(9);
+
+    json << "{\"phases\":[";
+    for (std::size_t i = 0; i < this->phases.size(); ++i) {
+        const Phase &phase = this->phases[i];
+        json << (i ? "," : "") << "{\"name\":\"" << phase.name << "\""
+             << ",\"wall_ms\":" << phase.wall_seconds * 1e3
+             << ",\"cpu_ms\":" << phase.cpu_seconds * 1e3;
+        if (tracks_allocations()) {
+            json << ",\"allocations\":" << phase.allocations << ",\"allocated_bytes\":" << phase.allocated_bytes;
+        }
+        for (const auto &[name, value] : phase.hardware) {
+            json << ",\"" << name << "\":" << value;
+        }
+        json << "}";
+    }
+    json << "]";
+
+    if (this->hardware_requested && !this->hardware.available()) {
+        json << ",\"hardware_counters_error\":\"" << this->hardware_error << "\"";
+    }
+
+    for (const auto &[name, value] : this->totals()) {
+        json << ",\"" << name << "\":" << value;
+    }
+    json << "}\n";
+
+    out << json.str() << std::flush;
+}
@@ -0,0 +1,115 @@
+#include <algorithm>
+
+#include "headers/thread_pool.h"
+
+namespace {
+    // lets submit() recognise calls coming from one of the pool's own workers
+    thread_local const tcomp::ThreadPool *current_pool = nullptr;
+    thread_local std::size_t current_index = 0;
+}
+
+tcomp::ThreadPool::ThreadPool(unsigned workers) {
+    workers = std::max(1u, workers);
+    for (unsigned i = 0; i < workers; ++i) {
+        this->queues.push_back(std::make_unique<WorkQueue>());
+    }
+    for (unsigned i = 0; i < workers; ++i) {
+        this->workers.emplace_back([this, i] { this->worker_loop(i); });
+    }
+}
+
+tcomp::ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(this->mutex);
+        this->stopping = true;
+    }
+    this->task_available.notify_all();
+    for (auto &worker : this->workers) {
+        worker.join();
+    }
+}
+
+void tcomp::ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard lock(this->mutex);
+        ++this->in_flight;
+    }
+
+    const std::size_t index = current_pool == this
+        ? current_index
+        : this->next_queue.fetch_add(1, std::memory_order_relaxed) % this->queues.size();
+    {
+        std::lock_guard lock(this->queues[index]->mutex);
+        this->queues[index]->tasks.push_back(std::move(task));
+    }
+
+    {
+        std::lock_guard lock(this->mutex);
+        ++this->queued;
+    }
+    this->task_available.notify_one();
+}
+
+void tcomp::ThreadPool::wait() {
+    std::unique_lock lock(this->mutex);
+    this->all_done.wait(lock, [this] { return this->in_flight <= 0; });
+}
+
+unsigned tcomp::ThreadPool::G_size() const {
+    return static_cast<unsigned>(this->workers.size());
+}
+
+bool tcomp::ThreadPool::take(std::size_t index, std::function<void()> &task) {
+    {
+        WorkQueue &own = *this->queues[index];
+        std::lock_guard lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    for (std::size_t offset = 1; offset < this->queues.size(); ++offset) {
+        WorkQueue &victim = *this->queues[(index + offset) % this->queues.size()];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void tcomp::ThreadPool::worker_loop(std::size_t index) {
+    current_pool = this;
+    current_index = index;
+
+    while (true) {
+        std::function<void()> task;
+        if (!this->take(index, task)) {
+            std::unique_lock lock(this->mutex);
+            this->task_available.wait(lock, [this] { return this->stopping || this->queued > 0; });
+            if (this->stopping && this->queued <= 0) {
+                return;
+            }
+            continue;
+        }
+
+        {
+            std::lock_guard lock(this->mutex);
+            --this->queued;
+        }
+
+        task();
+
+        {
+            std::lock_guard lock(this->mutex);
+            if (--this->in_flight == 0) {
+                this->all_done.notify_all();
+            }
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "headers/trace.h"
+
+namespace {
+    /// Small, stable per-thread ids; the thread that records first (the main thread) is 0
+    std::uint32_t this_thread_index() {
+        static std::atomic<std::uint32_t> next{0};
+        thread_local const std::uint32_t index = next.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+
+    std::string escape(const std::string &text) {
+        std::string escaped;
+        escaped.reserve(text.size());
+        for (const char c : text) {
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+                escaped += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                escaped += ' ';
+            } else {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+}
+
+tcomp::trace::Tracer::Tracer(std::uint64_t iteration_interval)
+    : origin(std::chrono::steady_clock::now()), iteration_interval(iteration_interval) {}
+
+void tcomp::trace::Tracer::record(std::string name, const char *category, std::chrono::steady_clock::time_point start, std::string args) {
+    const auto end = this->now();
+    const std::uint32_t thread = this_thread_index();
+
+    std::lock_guard lock(this->mutex);
+    this->events.push_back(Event{
+        .name = std::move(name),
+        .category = category,
+        .start_us = std::chrono::duration_cast<std::chrono::microseconds>(start - this->origin).count(),
+        .duration_us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count(),
+        .thread = thread,
+        .args = std::move(args)
+    });
+    while (this->thread_names.size() <= thread) {
+        this->thread_names.push_back(this->thread_names.empty() ? "main" : "worker " + std::to_string(this->thread_names.size()));
+    }
+}
+
+void tcomp::trace::Tracer::write(std::ostream &out) const {
+    std::lock_guard lock(this->mutex);
+
+    std::ostringstream json;
+    json << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    bool first = true;
+    for (std::size_t thread = 0; thread < this->thread_names.size(); ++thread) {
+        json << (first ? "" : ",\n") << R"({"ph":"M","name":"thread_name","pid":1,"tid":)" << thread
+             << R"(,"args":{"name":")" << this->thread_names[thread] << "\"}}";
+        first = false;
+    }
+
+    for (const Event &event : this->events) {
+        json << (first ? "" : ",\n") << R"({"ph":"X","name":")" << escape(event.name) << R"(","cat":")" << event.category
+             << R"(","ts":)" << event.start_us << R"(,"dur":)" << event.duration_us
+             << R"(,"pid":1,"tid":)" << event.thread;
+        if (!event.args.empty()) {
+            json << ",\"args\":{" << event.args << "}";
+        }
+        json << "}";
+        first = false;
+    }
+
+    json << "\n]}\n";
+    out << json.str() << std::flush;
+}
@@ -0,0 +1,148 @@
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <variant>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+#include <stdexcept>
+
+#include "../src/headers/lexer.h"
+#include "../src/headers/error.h"
+#include "../src/headers/parser.h"
+#include "../src/headers/semantic_analysis.h"
+#include "../src/headers/driver.h"
+#include "../src/headers/bytecode.h"
+#include "../src/headers/lanes.h"
+#include "../src/headers/stats.h"
+
+/**
+ * turingcomplete_allocations: checks that loops of a compiled program run without touching the heap.
+ *
+ * Each program is compiled once (tcomp::vm::compile) with its iteration count `n` as a parameter and run
+ * with n, 2n and 4n iterations. Everything a run allocates outside its loops is the same for all three, so
+ * any difference in the allocation counts comes from the iterations themselves and fails the test. The tree
+ * walker's allocations per iteration are printed alongside for comparison, but not checked.
+ */
+
+namespace {
+    struct Case {
+        std::string name;
+        std::string source;
+        std::size_t lanes = 1;
+    };
+
+    std::vector<Case> cases() {
+        return {
+            {"counting loop",
+             "!{0} => acc\n!{1} => n\n!{n} => i\n"
+             "(:i ${\n    !{(acc + i * 3) % 1000} => acc\n    !{acc > 500} => big\n})\n"
+             "<<@ acc\n", 1},
+            {"nested loops",
+             "!{0} => acc\n!{1} => n\n!{n} => i\n"
+             "(:i ${\n    !{4} => j\n    (:j ${\n        !{acc + j - i} => acc\n    })\n})\n"
+             "<<@ acc\n", 1},
+            {"literals in a loop",
+             "[+--+] => x\n!{1} => n\n!{n} => i\n"
+             "(:i ${\n    [+-+] => y\n    !{x * y + i} => z\n})\n"
+             "<<@ z\n", 1},
+            {"64 lanes",
+             "!{0} => acc\n!{1} => n\n!{n} => i\n"
+             "(:i ${\n    !{(acc * 7 + i) % 65521} => acc\n})\n"
+             "<<@ acc\n", 64},
+        };
+    }
+
+    std::shared_ptr<ProgramNode> parse(const Case &test) {
+        std::istringstream source(test.source);
+        auto script = tcomp::compile(source, test.name);
+        if (!script->error_pack.errors.empty()) {
+            throw std::runtime_error(test.name + " does not parse");
+        }
+        return script->program;
+    }
+
+    /// Allocations made by one run of `program` with `iterations` in every lane (plus the lane's index)
+    std::uint64_t count_vm(const tcomp::vm::Program &program, std::size_t lanes, std::int64_t iterations) {
+        std::vector<std::int64_t> values(lanes);
+        for (std::size_t lane = 0; lane < lanes; ++lane) {
+            values[lane] = iterations + static_cast<std::int64_t>(lane);
+        }
+
+        tcomp::vm::LaneMachine machine(program, lanes, {values});
+        const std::uint64_t before = tcomp::stats::thread_allocations();
+        const std::vector<tcomp::vm::LaneResult> results = machine.run();
+        const std::uint64_t allocations = tcomp::stats::thread_allocations() - before;
+
+        for (const auto &result : results) {
+            if (!result.ok) {
+                throw std::runtime_error("run failed: " + result.output);
+            }
+        }
+        return allocations;
+    }
+
+    std::uint64_t count_tree_walker(const Case &test, std::int64_t iterations) {
+        std::string source = test.source;
+        source.replace(source.find("!{1} => n"), 9, "!{" + std::to_string(iterations) + "} => n");
+        std::istringstream stream(source);
+        auto script = tcomp::compile(stream, test.name);
+
+        std::ostringstream sink;
+        const std::uint64_t before = tcomp::stats::thread_allocations();
+        {
+            sem_analysis::SemanticAnalyser semantic_analyser(script->program, test.name);
+            semantic_analyser.S_output(sink);
+            semantic_analyser.S_jobs(1);
+            semantic_analyser.analyze();
+        }
+        return tcomp::stats::thread_allocations() - before;
+    }
+}
+
+int main() {
+    if (!tcomp::stats::tracks_allocations()) {
+        std::cout << "allocation tracking is not built in (TURINGCOMPLETE_ALLOCATION_TRACKING), nothing to check" << std::endl;
+        return 0;
+    }
+
+    constexpr std::int64_t ITERATIONS = 100;
+
+    std::cout << std::left << std::setw(22) << "program" << std::right << std::setw(10) << "n" << std::setw(10) << "2n"
+              << std::setw(10) << "4n" << std::setw(22) << "tree walker/iter" << "  result" << std::endl;
+
+    int failures = 0;
+    for (const Case &test : cases()) {
+        std::string result = "ok";
+        std::uint64_t counts[3] = {};
+        double tree_walker = 0;
+        try {
+            const tcomp::vm::Program program = tcomp::vm::compile(parse(test), {"n"});
+            for (int i = 0; i < 3; ++i) {
+                counts[i] = count_vm(program, test.lanes, ITERATIONS << i);
+            }
+            if (counts[0] != counts[1] || counts[1] != counts[2]) {
+                result = "FAIL: allocations grow with the number of iterations";
+                ++failures;
+            }
+            tree_walker = static_cast<double>(count_tree_walker(test, 2 * ITERATIONS) - count_tree_walker(test, ITERATIONS))
+                        / static_cast<double>(ITERATIONS);
+        } catch (const std::exception &e) {
+            result = std::string("FAIL: ") + e.what();
+            ++failures;
+        }
+
+        std::cout << std::left << std::setw(22) << test.name << std::right << std::setw(10) << counts[0] << std::setw(10) << counts[1]
+                  << std::setw(10) << counts[2] << std::fixed << std::setprecision(1) << std::setw(22) << tree_walker
+                  << "  " << result << std::endl;
+    }
+
+    std::cout << cases().size() - static_cast<std::size_t>(failures) << "/" << cases().size() << " passed" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,385 @@
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <filesystem>
+#include <chrono>
+#include <regex>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <stdexcept>
+#include <optional>
+#include <iterator>
+
+#if !defined(_WIN32)
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <sys/resource.h>
+    #include <sys/wait.h>
+    #include <unistd.h>
+#endif
+
+/**
+ * turingcomplete_golden: runs every .af program in test/ against its checked-in stdout.
+ *
+ *   turingcomplete_golden --interpreter <turingcomplete> [--tests <dir>] [--expected <dir>]
+ *                         [--repetitions <n>] [--timeout <s>]
+ *                         [--baseline <timings.json>] [--threshold <fraction>] [--write-baseline <timings.json>]
+ *
+ * Each program runs in its own process, started in the program's directory, so crashes and hangs are contained
+ * and file names in diagnostics do not depend on the checkout; its stdout must match <expected>/<name>.out byte
+ * for byte and it must exit with 0, or with the status in <expected>/<name>.status when there is one (a crash
+ * is 128 + the signal). Whitespace-separated flags in <expected>/<name>.args go before the program. Timed runs
+ * use --jobs 1; one more run with the default jobs checks the parallel and native paths against the same
+ * expectations. The fastest of --repetitions runs and the peak RSS are
+ * reported, and with --baseline a program fails when it is slower than its stored time by more than
+ * --threshold (plus a few milliseconds of slack, so tiny programs do not fail on scheduler noise).
+ * A program without an expected <name>.out fails; one without a baseline entry is only reported.
+ */
+
+namespace {
+    constexpr const char USAGE[] = "usage: turingcomplete_golden --interpreter <turingcomplete> [--tests <dir>] [--expected <dir>] "
+                                   "[--repetitions <n>] [--timeout <s>] [--baseline <file>] [--threshold <fraction>] [--write-baseline <file>]";
+
+    struct Settings {
+        bool show_help = false;
+        std::string interpreter;
+        std::filesystem::path tests = "test";
+        std::filesystem::path expected;  // defaults to <tests>/expected
+        int repetitions = 3;
+        double timeout_seconds = 30;
+        std::string baseline;
+        std::string write_baseline;
+        double threshold = 0.25;
+        double slack_ms = 5;
+    };
+
+    struct Run {
+        std::string output;
+        int status = 0;          // exit code, or 128 + signal
+        bool timed_out = false;
+        double ms = 0;
+        long peak_kb = 0;
+    };
+
+#if !defined(_WIN32)
+    Run run_program(const Settings &settings, const std::filesystem::path &program, const std::vector<std::string> &flags, bool sequential) {
+        Run run;
+        const std::string interpreter = std::filesystem::absolute(settings.interpreter).string();
+
+        int pipe_fds[2];
+        if (::pipe(pipe_fds) != 0) {
+            throw std::runtime_error(std::string("pipe: ") + std::strerror(errno));
+        }
+
+        std::vector<std::string> args = {interpreter};
+        // --jobs 1 keeps timings comparable between machines with different core counts
+        if (sequential) {
+            args.insert(args.end(), {"--jobs", "1"});
+        }
+        args.insert(args.end(), flags.begin(), flags.end());
+        args.push_back(program.filename().string());
+        std::vector<char *> argv;
+        for (auto &arg : args) {
+            argv.push_back(arg.data());
+        }
+        argv.push_back(nullptr);
+
+        const auto start = std::chrono::steady_clock::now();
+        const pid_t pid = ::fork();
+        if (pid < 0) {
+            throw std::runtime_error(std::string("fork: ") + std::strerror(errno));
+        }
+
+        if (pid == 0) {
+            ::dup2(pipe_fds[1], STDOUT_FILENO);
+            const int null_fd = ::open("/dev/null", O_RDWR);
+            ::dup2(null_fd, STDIN_FILENO);
+            ::dup2(null_fd, STDERR_FILENO);
+            ::close(pipe_fds[0]);
+            ::close(pipe_fds[1]);
+            if (::chdir(program.parent_path().c_str()) != 0) {
+                ::_exit(127);
+            }
+            ::execv(argv[0], argv.data());
+            ::_exit(127);
+        }
+        ::close(pipe_fds[1]);
+
+        const auto deadline = start + std::chrono::duration<double>(settings.timeout_seconds);
+        char buffer[4096];
+        while (true) {
+            const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            if (remaining <= 0) {
+                run.timed_out = true;
+                ::kill(pid, SIGKILL);
+                break;
+            }
+            pollfd reader{pipe_fds[0], POLLIN, 0};
+            const int ready = ::poll(&reader, 1, static_cast<int>(std::min<long long>(remaining, 1000)));
+            if (ready < 0 && errno != EINTR) {
+                break;
+            }
+            if (ready <= 0) {
+                continue;
+            }
+            const ssize_t got = ::read(pipe_fds[0], buffer, sizeof(buffer));
+            if (got <= 0) {
+                break;
+            }
+            run.output.append(buffer, static_cast<std::size_t>(got));
+        }
+        ::close(pipe_fds[0]);
+
+        int status = 0;
+        rusage usage{};
+        while (::wait4(pid, &status, 0, &usage) < 0 && errno == EINTR) {}
+        run.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        run.status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    #if defined(__APPLE__)
+        run.peak_kb = usage.ru_maxrss / 1024;
+    #else
+        run.peak_kb = usage.ru_maxrss;
+    #endif
+        return run;
+    }
+#else
+    Run run_program(const Settings &, const std::filesystem::path &, const std::vector<std::string> &, bool) {
+        throw std::runtime_error("turingcomplete_golden needs a POSIX system");
+    }
+#endif
+
+    std::string read_file(const std::filesystem::path &path, bool &found) {
+        std::ifstream file(path, std::ios::binary);
+        found = file.is_open();
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        return contents.str();
+    }
+
+    /// The first line where two outputs differ, for the failure message
+    std::string first_difference(const std::string &expected, const std::string &actual) {
+        std::istringstream e(expected), a(actual);
+        std::string expected_line, actual_line;
+        for (int line = 1;; ++line) {
+            const bool has_expected = static_cast<bool>(std::getline(e, expected_line));
+            const bool has_actual = static_cast<bool>(std::getline(a, actual_line));
+            if (!has_expected && !has_actual) {
+                return "outputs differ only in their final newline";
+            }
+            if (!has_expected || !has_actual || expected_line != actual_line) {
+                return "line " + std::to_string(line) + ": expected \"" + (has_expected ? expected_line : "<end>")
+                     + "\", got \"" + (has_actual ? actual_line : "<end>") + "\"";
+            }
+        }
+    }
+
+    /// Why a run does not meet its expectations, or nothing when it does
+    std::optional<std::string> mismatch(const Settings &settings, const Run &run, const std::optional<std::string> &expected,
+                                        int expected_status) {
+        if (run.timed_out) {
+            return "timed out after " + std::to_string(static_cast<int>(settings.timeout_seconds)) + " s";
+        }
+        if (run.status != expected_status) {
+            return "exit " + std::to_string(run.status) + ", expected " + std::to_string(expected_status);
+        }
+        if (expected && *expected != run.output) {
+            return "output differs, " + first_difference(*expected, run.output);
+        }
+        return std::nullopt;
+    }
+
+    // #[Baselines]
+    // A baseline is a flat JSON object of program name to milliseconds, as written by --write-baseline.
+
+    std::map<std::string, double> read_baseline(const std::string &path) {
+        bool found = false;
+        const std::string text = read_file(path, found);
+        if (!found) {
+            throw std::runtime_error("cannot read baseline " + path);
+        }
+
+        std::map<std::string, double> timings;
+        static const std::regex entry(R"re("([^"]+)"\s*:\s*([0-9.eE+-]+))re");
+        for (auto it = std::sregex_iterator(text.begin(), text.end(), entry); it != std::sregex_iterator(); ++it) {
+            timings[(*it)[1].str()] = std::stod((*it)[2].str());
+        }
+        return timings;
+    }
+
+    void write_baseline(const std::string &path, const std::map<std::string, double> &timings) {
+        std::ofstream file(path);
+        if (!file.is_open()) {
+            throw std::runtime_error("cannot write baseline " + path);
+        }
+        file << std::fixed << std::setprecision(3) << "{\n";
+        std::size_t i = 0;
+        for (const auto &[name, ms] : timings) {
+            file << "    \"" << name << "\": " << ms << (++i < timings.size() ? ",\n" : "\n");
+        }
+        file << "}\n";
+    }
+
+    Settings parse_settings(int argc, char *argv[]) {
+        Settings settings;
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            const bool has_value = i + 1 < argc;
+            if (arg == "-h" || arg == "--help") {
+                settings.show_help = true;
+                return settings;
+            } else if (arg == "--interpreter" && has_value) {
+                settings.interpreter = argv[++i];
+            } else if (arg == "--tests" && has_value) {
+                settings.tests = argv[++i];
+            } else if (arg == "--expected" && has_value) {
+                settings.expected = argv[++i];
+            } else if (arg == "--repetitions" && has_value) {
+                settings.repetitions = std::max(std::stoi(argv[++i]), 1);
+            } else if (arg == "--timeout" && has_value) {
+                settings.timeout_seconds = std::stod(argv[++i]);
+            } else if (arg == "--baseline" && has_value) {
+                settings.baseline = argv[++i];
+            } else if (arg == "--threshold" && has_value) {
+                settings.threshold = std::stod(argv[++i]);
+            } else if (arg == "--write-baseline" && has_value) {
+                settings.write_baseline = argv[++i];
+            } else {
+                throw std::invalid_argument("unknown argument: " + arg);
+            }
+        }
+        if (settings.interpreter.empty()) {
+            throw std::invalid_argument("--interpreter is required");
+        }
+        if (settings.expected.empty()) {
+            settings.expected = settings.tests / "expected";
+        }
+        return settings;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    Settings settings;
+    std::map<std::string, double> baseline;
+    try {
+        settings = parse_settings(argc, argv);
+        if (!settings.show_help && !settings.baseline.empty()) {
+            baseline = read_baseline(settings.baseline);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << '\n' << USAGE << std::endl;
+        return 2;
+    }
+    if (settings.show_help) {
+        std::cout << USAGE << "\n\n"
+                  << "  --interpreter <path>         the turingcomplete binary to test\n"
+                  << "  --tests <dir>                where the .af programs are (default test)\n"
+                  << "  --expected <dir>             their .out, .status and .args files (default <tests>/expected)\n"
+                  << "  --repetitions <n>            timed runs of each program; the fastest is reported (default 3)\n"
+                  << "  --timeout <s>                kill a run after this many seconds (default 30)\n"
+                  << "  --baseline <file>            fail programs slower than their time in this file\n"
+                  << "  --threshold <fraction>       allowed slowdown against the baseline (default 0.25)\n"
+                  << "  --write-baseline <file>      write this run's timings there\n"
+                  << "  -h, --help                   print this and exit" << std::endl;
+        return 0;
+    }
+
+    std::vector<std::filesystem::path> programs;
+    std::error_code ec;
+    for (const auto &entry : std::filesystem::directory_iterator(settings.tests, ec)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".af") {
+            programs.push_back(entry.path());
+        }
+    }
+    std::ranges::sort(programs);
+    if (programs.empty()) {
+        std::cerr << "No .af programs in " << settings.tests << std::endl;
+        return 2;
+    }
+
+    std::cout << std::left << std::setw(24) << "program" << std::right << std::setw(10) << "ms" << std::setw(10) << "peak KB"
+              << std::setw(10) << "baseline" << "  result" << std::endl;
+
+    int failures = 0;
+    std::map<std::string, double> timings;
+    for (const auto &program : programs) {
+        const std::string name = program.filename().string();
+
+        bool found = false;
+        std::istringstream flag_file(read_file(settings.expected / (program.stem().string() + ".args"), found));
+        const std::vector<std::string> flags{std::istream_iterator<std::string>(flag_file), std::istream_iterator<std::string>()};
+
+        Run best, parallel;
+        try {
+            for (int r = 0; r < settings.repetitions; ++r) {
+                Run run = run_program(settings, program, flags, true);
+                if (r == 0 || run.ms < best.ms) {
+                    run.peak_kb = std::max(run.peak_kb, best.peak_kb);
+                    best = std::move(run);
+                } else {
+                    best.peak_kb = std::max(best.peak_kb, run.peak_kb);
+                }
+                if (best.timed_out) break;
+            }
+            parallel = run_program(settings, program, flags, false);
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << std::endl;
+            return 2;
+        }
+        timings[name] = best.ms;
+
+        std::optional<std::string> expected = read_file(settings.expected / (program.stem().string() + ".out"), found);
+        if (!found) expected.reset();
+        const std::string status = read_file(settings.expected / (program.stem().string() + ".status"), found);
+        const int expected_status = found ? std::stoi(status) : 0;
+
+        std::string result = "ok";
+        bool failed = false;
+        if (!expected) {
+            result = "FAIL: no expected output, check in " + (settings.expected / (program.stem().string() + ".out")).string();
+            failed = true;
+        } else if (const auto problem = mismatch(settings, best, expected, expected_status)) {
+            result = "FAIL: " + *problem;
+            failed = true;
+        } else if (const auto parallel_problem = mismatch(settings, parallel, expected, expected_status)) {
+            result = "FAIL: with the default jobs, " + *parallel_problem;
+            failed = true;
+        }
+
+        std::ostringstream baseline_column;
+        if (auto it = baseline.find(name); it != baseline.end()) {
+            baseline_column << std::fixed << std::setprecision(1) << it->second;
+            const double limit = it->second * (1 + settings.threshold) + settings.slack_ms;
+            if (!failed && best.ms > limit) {
+                std::ostringstream message;
+                message << std::fixed << std::setprecision(0) << "FAIL: " << 100 * (best.ms / it->second - 1) << "% slower than baseline";
+                result = message.str();
+                failed = true;
+            }
+        } else {
+            baseline_column << "-";
+        }
+
+        failures += failed;
+        std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(10) << best.ms << std::setw(10) << best.peak_kb << std::setw(10) << baseline_column.str()
+                  << "  " << result << std::endl;
+    }
+
+    if (!settings.write_baseline.empty()) {
+        try {
+            write_baseline(settings.write_baseline, timings);
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << std::endl;
+            return 2;
+        }
+    }
+
+    std::cout << programs.size() - static_cast<std::size_t>(failures) << "/" << programs.size() << " passed" << std::endl;
+    return failures == 0 ? 0 : 1;
+}